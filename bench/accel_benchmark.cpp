@@ -0,0 +1,109 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(1024, 1024);
+
+// Every check_stride-th primary ray is checked against the binary BVH
+static const int32 check_stride = 16;
+
+struct TraceResult
+{
+    double rays_per_sec;
+    int32 hits;
+};
+
+static TraceResult TraceClosest(const Intersectable* accel, const std::vector<Ray>& rays)
+{
+    std::atomic<int32> hits;
+
+    double t = Measure([&]() {
+        hits = 0;
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            int32 local_hits = 0;
+            for (int32 i = begin; i < end; ++i)
+            {
+                Intersection isect;
+                local_hits += accel->Intersect(&isect, rays[i], Ray::epsilon, infinity);
+            }
+            hits += local_hits;
+        });
+    });
+
+    return TraceResult{ rays.size() / t, hits.load() };
+}
+
+static TraceResult TraceAny(const Intersectable* accel, const std::vector<Ray>& rays)
+{
+    std::atomic<int32> hits;
+
+    double t = Measure([&]() {
+        hits = 0;
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            int32 local_hits = 0;
+            for (int32 i = begin; i < end; ++i)
+            {
+                local_hits += accel->IntersectAny(rays[i], Ray::epsilon, infinity);
+            }
+            hits += local_hits;
+        });
+    });
+
+    return TraceResult{ rays.size() / t, hits.load() };
+}
+
+template <typename Accel>
+static void Run(const char* name, const Scene& scene, const HitCheck& check)
+{
+    Timer timer;
+    Accel accel(scene.GetPrimitives());
+    timer.Mark();
+    double build_time = timer.Get();
+
+    std::vector<Ray> rays = GeneratePrimaryRays(accel.GetAABB(), resolution);
+
+    TraceResult closest = TraceClosest(&accel, rays);
+    TraceResult any = TraceAny(&accel, rays);
+
+    double bytes_per_primitive = double(accel.GetMemoryUsage()) / scene.GetPrimitives().size();
+    int32 mismatches = CountMismatchedHits(&accel, check);
+
+    std::cout << std::format(
+                     "  {:<13} build {:8.3f}s  {:6.1f} B/prim  closest {:8.2f} Mrays/s ({} hits)  any {:8.2f} Mrays/s ({} hits)  "
+                     "mismatches {}",
+                     name, build_time, bytes_per_primitive, closest.rays_per_sec * 1e-6, closest.hits, any.rays_per_sec * 1e-6,
+                     any.hits, mismatches
+                 )
+              << std::endl;
+
+    if (mismatches > 0)
+    {
+        Benchmark::Fail(std::format("{} differs from the reference in {} of {} rays", name, mismatches, check.rays.size()));
+    }
+}
+
+// Compares the binary BVH with the wide BVHs on primary rays.
+// The hits of all layouts are checked ray by ray against the binary BVH, with random maximum distances
+static void AccelBenchmark()
+{
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        std::cout << bench_scene.name << " (" << scene.GetPrimitives().size() << " primitives)" << std::endl;
+
+        BVH reference(scene.GetPrimitives());
+        HitCheck check = CreateHitCheck(&reference, GeneratePrimaryRays(reference.GetAABB(), resolution), check_stride, 1234);
+
+        Run<BVH>("BVH", scene, check);
+        Run<WideBVH4>("WideBVH4", scene, check);
+        Run<WideBVH8>("WideBVH8", scene, check);
+        Run<CompressedBVH>("CompressedBVH", scene, check);
+    }
+}
+
+static int32 accel_benchmark = Benchmark::Register("accel", AccelBenchmark);
@@ -0,0 +1,80 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(96, 96);
+static const int32 reference_samples = 4096;
+static const int32 max_samples = 1024;
+static const int32 max_bounces = 8;
+
+// Renders with the given sampling options and returns the image and the average number of samples per pixel
+static Image3 Render(
+    const Camera& camera, const Intersectable* accel, const std::vector<Light*>& lights, int32 spp,
+    const AdaptiveSamplingOptions& options, double* time, double* samples_per_pixel
+)
+{
+    IndependentSampler sampler(spp);
+    PathIntegrator integrator(accel, lights, &sampler, max_bounces);
+    integrator.SetAdaptiveSampling(options);
+
+    Timer timer;
+    std::unique_ptr<RenderingProgress> progress = integrator.Render(camera);
+    const Film& film = progress->Wait();
+    timer.Mark();
+    *time = timer.Get();
+
+    double weights = 0;
+    for (Point2i pixel : AABB2i(Point2i(0, 0), resolution))
+    {
+        weights += film.GetWeight(pixel);
+    }
+    *samples_per_pixel = weights / (resolution.x * resolution.y);
+
+    return film.ConvertToImage();
+}
+
+// Relative mean squared error, so that the dark pixels count as much as the bright ones
+static double RelMSE(const Image3& image, const Image3& reference)
+{
+    double sum = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            sum += Sqr(double(image[i][j]) - double(reference[i][j])) / (Sqr(double(reference[i][j])) + 1e-2);
+        }
+    }
+
+    return sum / (resolution.x * resolution.y * 3);
+}
+
+// Compares uniform and adaptive sampling in time to equal error against a high sample count reference
+static void AdaptiveBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+
+    double time, spp;
+    Image3 reference = Render(*camera, &accel, scene.GetLights(), reference_samples, {}, &time, &spp);
+    std::cout << std::format("reference {}x{} {} spp {:.3f}s", resolution.x, resolution.y, reference_samples, time) << std::endl;
+
+    for (int32 samples = 64; samples <= max_samples; samples *= 2)
+    {
+        Image3 image = Render(*camera, &accel, scene.GetLights(), samples, {}, &time, &spp);
+        double relmse = RelMSE(image, reference);
+        std::cout << std::format("  uniform  {:7.1f} spp {:7.3f}s  relmse {:.6f}", spp, time, relmse) << std::endl;
+    }
+
+    for (Float max_error : { 0.08f, 0.04f, 0.02f, 0.01f })
+    {
+        AdaptiveSamplingOptions options;
+        options.max_error = max_error;
+
+        Image3 image = Render(*camera, &accel, scene.GetLights(), max_samples, options, &time, &spp);
+        double relmse = RelMSE(image, reference);
+        std::cout << std::format("  adaptive {:7.1f} spp {:7.3f}s  relmse {:.6f}  (max error {})", spp, time, relmse, max_error)
+                  << std::endl;
+    }
+}
+
+static int32 adaptive_benchmark = Benchmark::Register("adaptive", AdaptiveBenchmark);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "bulbit/bulbit.h"
+
+#include <map>
+
+using namespace bulbit;
+
+struct Benchmark
+{
+    typedef void Func();
+
+    // A number recorded for the regression check, see main.cpp
+    struct Result
+    {
+        double value;
+        bool higher_is_better;
+    };
+
+    static int32 Register(std::string name, Func* func);
+    static bool Run(std::string name);
+
+    // Records a result under the name of the running benchmark, e.g. "throughput/rays/sphere-grid/primary closest"
+    static void Record(const std::string& name, double value, bool higher_is_better = true);
+
+    // Reports a failed correctness check, the run exits with an error after all benchmarks finished
+    static void Fail(const std::string& message);
+
+    static inline std::map<std::string, Func*> benchmarks;
+    static inline int32 count = 0;
+
+    static inline std::string running;
+    static inline std::map<std::string, Result> results;
+    static inline int32 failures = 0;
+};
+
+inline int32 Benchmark::Register(std::string name, Func* func)
+{
+    benchmarks.insert(std::make_pair(name, func));
+
+    return ++count;
+}
+
+inline bool Benchmark::Run(std::string name)
+{
+    if (!benchmarks.contains(name))
+    {
+        return false;
+    }
+
+    std::cout << "[" << name << "]" << std::endl;
+    running = name;
+    benchmarks.at(name)();
+    std::cout << std::endl;
+
+    return true;
+}
+
+inline void Benchmark::Record(const std::string& name, double value, bool higher_is_better)
+{
+    results[running + "/" + name] = Result{ value, higher_is_better };
+}
+
+inline void Benchmark::Fail(const std::string& message)
+{
+    std::cout << "  FAILED: " << message << std::endl;
+    ++failures;
+}
+
+// Runs func repeatedly for at least min_time seconds and returns the average time per run
+template <typename F>
+inline double Measure(F&& func, double min_time = 1.0)
+{
+    Timer timer;
+
+    int32 runs = 0;
+    double elapsed = 0;
+    do
+    {
+        func();
+        ++runs;
+
+        timer.Mark();
+        elapsed += timer.Get();
+    } while (elapsed < min_time);
+
+    return elapsed / runs;
+}
+
+// Fastest of several Measure() calls. Other work on the machine only ever slows a run down,
+// so the fastest run is steadier between invocations than one long measurement
+template <typename F>
+inline double MeasureBest(F&& func, int32 repeats = 5, double min_time = 0.2)
+{
+    double best = infinity;
+    for (int32 i = 0; i < repeats; ++i)
+    {
+        best = std::min(best, Measure(func, min_time));
+    }
+
+    return best;
+}
@@ -0,0 +1,112 @@
+#include "benchmark.h"
+
+static const int32 sample_count = 1 << 16;
+
+// Written with the results so that the sampling cannot be optimized away
+static volatile Float sink;
+
+struct BSDFInput
+{
+    Vec3 wo;
+    Float u0;
+    Point2 u12;
+};
+
+// Creates the BSDF at a fixed surface point and samples it, as the integrators do at every hit.
+// Runs on one thread, the throughput of a single core is the steadier number
+static double SampleBSDFs(const Material* material, const std::vector<BSDFInput>& inputs)
+{
+    Intersection isect;
+    isect.primitive = nullptr;
+    isect.t = 1;
+    isect.point = Point3(0);
+    isect.normal = y_axis;
+    isect.uv = Point2(0.5f, 0.5f);
+    isect.front_face = true;
+    isect.shading.normal = y_axis;
+    isect.shading.tangent = x_axis;
+
+    Float pdf_sum = 0;
+    double t = MeasureBest([&]() {
+        for (const BSDFInput& input : inputs)
+        {
+            int8 mem[max_bxdf_size];
+            Resource res(mem, sizeof(mem));
+            Allocator alloc(&res);
+
+            // Mixtures pick one of their materials as in Intersection::GetBSDF()
+            const Material* m = material;
+            while (m->Is<MixtureMaterial>())
+            {
+                m = ((const MixtureMaterial*)m)->ChooseMaterial(isect, input.wo);
+            }
+
+            BSDF bsdf;
+            if (!m->GetBSDF(&bsdf, isect, input.wo, alloc))
+            {
+                continue;
+            }
+
+            BSDFSample sample;
+            if (bsdf.Sample_f(&sample, input.wo, input.u0, input.u12))
+            {
+                pdf_sum += sample.pdf;
+            }
+        }
+    });
+
+    sink = pdf_sum;
+
+    return inputs.size() / t;
+}
+
+// BSDF creation and sampling throughput of every material type that has a BSDF
+static void BSDFBenchmark()
+{
+    Scene scene;
+    auto constant = [&](Float value) { return scene.CreateTexture<ConstantTexture, Float>(value); };
+    auto color = [&](const Spectrum& value) { return scene.CreateTexture<ConstantTexture, Spectrum>(value); };
+
+    const Material* diffuse = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.7f)));
+    const Material* conductor = scene.CreateMaterial<ConductorMaterial>(color(Spectrum(0.9f)), constant(0.3f), constant(0.3f));
+
+    const std::pair<const char*, const Material*> materials[] = {
+        { "diffuse", diffuse },
+        { "mirror", scene.CreateMaterial<MirrorMaterial>(color(Spectrum(0.9f))) },
+        { "dielectric smooth", scene.CreateMaterial<DielectricMaterial>(1.5f, constant(0), constant(0)) },
+        { "dielectric rough", scene.CreateMaterial<DielectricMaterial>(1.5f, constant(0.3f), constant(0.3f)) },
+        { "thin dielectric", scene.CreateMaterial<ThinDielectricMaterial>(1.5f) },
+        { "conductor rough", conductor },
+        { "unreal", scene.CreateMaterial<UnrealMaterial>(color(Spectrum(0.7f)), constant(0.5f), constant(0.3f), constant(0.3f)) },
+        { "mixture", scene.CreateMaterial<MixtureMaterial>(diffuse, conductor, constant(0.5f)) },
+        { "subsurface diffusion",
+          scene.CreateMaterial<SubsurfaceDiffusionMaterial>(
+              color(Spectrum(0.7f)), Spectrum(0.1f), 1.33f, constant(0.3f), constant(0.3f)
+          ) },
+        { "subsurface random walk",
+          scene.CreateMaterial<SubsurfaceRandomWalkMaterial>(
+              color(Spectrum(0.7f)), Spectrum(0.1f), 1.33f, constant(0.3f), constant(0.3f)
+          ) },
+    };
+
+    // Outgoing directions over the upper hemisphere and the sample dimensions, the same for every material
+    RNG rng(1234);
+    std::vector<BSDFInput> inputs(sample_count);
+    for (BSDFInput& input : inputs)
+    {
+        Vec3 w = SampleUniformHemisphere({ rng.NextFloat(), rng.NextFloat() });
+        input.wo = Vec3(w.x, w.z, w.y);
+        input.u0 = rng.NextFloat();
+        input.u12 = Point2(rng.NextFloat(), rng.NextFloat());
+    }
+
+    for (auto [name, material] : materials)
+    {
+        double samples_per_sec = SampleBSDFs(material, inputs) * 1e-6;
+
+        std::cout << std::format("  {:24} {:8.2f} Msamples/s", name, samples_per_sec) << std::endl;
+        Benchmark::Record(std::format("{} Msamples/s", name), samples_per_sec);
+    }
+}
+
+static int32 bsdf_benchmark = Benchmark::Register("bsdf", BSDFBenchmark);
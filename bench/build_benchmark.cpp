@@ -0,0 +1,63 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+// Builds the BVH with the given number of threads, zero runs the build on the calling thread only
+static double MeasureBuild(const Scene& scene, int32 thread_count)
+{
+    std::unique_ptr<ThreadPool> thread_pool = std::move(ThreadPool::global_thread_pool);
+    if (thread_count > 0)
+    {
+        ThreadPool::global_thread_pool.reset(new ThreadPool(thread_count));
+    }
+
+    double t = Measure([&]() { BVH bvh(scene.GetPrimitives()); }, 0.5);
+
+    ThreadPool::global_thread_pool = std::move(thread_pool);
+    return t;
+}
+
+static void Report(const Scene& scene)
+{
+    const int32 max_threads = int32(std::thread::hardware_concurrency());
+
+    double serial = MeasureBuild(scene, 0);
+    std::cout << std::format("  {:>3} threads {:8.3f}s", 1, serial) << std::endl;
+
+    for (int32 threads = 2; threads <= max_threads; threads *= 2)
+    {
+        double t = MeasureBuild(scene, threads);
+        std::cout << std::format("  {:>3} threads {:8.3f}s  ({:.2f}x)", threads, t, serial / t) << std::endl;
+
+        if (threads < max_threads && threads * 2 > max_threads)
+        {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+// BVH build time and its scaling over the worker count
+static void BuildBenchmark()
+{
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        std::cout << bench_scene.name << " (" << scene.GetPrimitives().size() << " primitives)" << std::endl;
+        Report(scene);
+    }
+
+    // Large enough that the top levels dominate the single threaded part of the build
+    Scene scene;
+    auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+    CreateRandomTriangles(scene, 4000000, 5678, material);
+
+    std::cout << "random-triangles-4M (" << scene.GetPrimitives().size() << " primitives)" << std::endl;
+    Report(scene);
+}
+
+static int32 build_benchmark = Benchmark::Register("build", BuildBenchmark);
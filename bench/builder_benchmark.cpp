@@ -0,0 +1,82 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(1024, 1024);
+
+// Every check_stride-th primary ray is checked against the default SAH build
+static const int32 check_stride = 16;
+
+static double TraceClosest(const Intersectable* accel, const std::vector<Ray>& rays)
+{
+    double t = Measure([&]() {
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            for (int32 i = begin; i < end; ++i)
+            {
+                Intersection isect;
+                accel->Intersect(&isect, rays[i], Ray::epsilon, infinity);
+            }
+        });
+    });
+
+    return rays.size() / t;
+}
+
+static void Run(const char* name, const Scene& scene, const BVHBuildOptions& options, const HitCheck& check)
+{
+    Timer timer;
+    BVH bvh(scene.GetPrimitives(), options);
+    timer.Mark();
+    double build_time = timer.Get();
+
+    std::vector<Ray> rays = GeneratePrimaryRays(bvh.GetAABB(), resolution);
+    double rays_per_sec = TraceClosest(&bvh, rays);
+    int32 mismatches = CountMismatchedHits(&bvh, check);
+
+    std::cout << std::format(
+                     "  {:<6} build {:8.3f}s  SAH cost {:8.2f}  references {:>8}  nodes {:>8}  closest {:8.2f} Mrays/s  "
+                     "mismatches {}",
+                     name, build_time, bvh.GetSAHCost(), bvh.GetPrimitiveCount(), bvh.GetNodeCount(), rays_per_sec * 1e-6,
+                     mismatches
+                 )
+              << std::endl;
+
+    if (mismatches > 0)
+    {
+        Benchmark::Fail(std::format("{} differs from the reference in {} of {} rays", name, mismatches, check.rays.size()));
+    }
+}
+
+// Build time and tree quality of the BVH build methods.
+// The hits of every build are checked ray by ray against the default SAH build, with random maximum distances
+static void BuilderBenchmark()
+{
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        std::cout << bench_scene.name << " (" << scene.GetPrimitives().size() << " primitives)" << std::endl;
+
+        BVH reference(scene.GetPrimitives());
+        HitCheck check = CreateHitCheck(&reference, GeneratePrimaryRays(reference.GetAABB(), resolution), check_stride, 1234);
+
+        BVHBuildOptions options;
+        Run("SAH", scene, options, check);
+
+        options.method = BVHBuildMethod::SBVH;
+        Run("SBVH", scene, options, check);
+
+        options.method = BVHBuildMethod::LBVH;
+        options.treelet_optimization = false;
+        Run("LBVH", scene, options, check);
+
+        options.treelet_optimization = true;
+        Run("LBVH+", scene, options, check);
+    }
+}
+
+static int32 builder_benchmark = Benchmark::Register("builder", BuilderBenchmark);
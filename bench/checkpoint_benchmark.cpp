@@ -0,0 +1,103 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(128, 128);
+static const int32 samples_per_pixel = 64;
+static const int32 max_bounces = 8;
+static const std::filesystem::path filename = "checkpoint_benchmark.bin";
+
+static int32 CountMismatches(const Image3& a, const Image3& b)
+{
+    int32 mismatches = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        mismatches += a[i] != b[i];
+    }
+
+    return mismatches;
+}
+
+// Stops renders at a time budget and resumes them from the checkpoint, the result has to match an uninterrupted render.
+// Also with a reconstruction filter, whose splats reach into the neighbouring tiles
+static void CheckpointBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+
+    IndependentSampler sampler(samples_per_pixel);
+    PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+    GaussianFilter gaussian(0.5f);
+
+    for (auto [filter, adaptive] : { std::pair<const Filter*, bool>{ nullptr, false }, { nullptr, true }, { &gaussian, false },
+                                     { &gaussian, true } })
+    {
+        integrator.SetReconstructionFilter(filter);
+        integrator.SetAdaptiveSampling({ .max_error = adaptive ? 0.05f : 0, .min_samples = 8, .round_samples = 4 });
+        integrator.SetProgressiveRendering({ .pass_samples = 4 });
+        integrator.SetCheckpointing({});
+
+        Timer timer;
+        std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+        Image3 reference = progress->Wait().ConvertToImage();
+        timer.Mark();
+        double reference_time = timer.Get();
+
+        // Checkpoint after every pass, the writes should not slow down the render
+        std::filesystem::remove(filename);
+        integrator.SetCheckpointing({ .filename = filename, .interval = 0 });
+
+        timer.Reset();
+        progress = integrator.Render(*camera);
+        Image3 checkpointed = progress->Wait().ConvertToImage();
+        timer.Mark();
+        double checkpointed_time = timer.Get();
+
+        std::cout << std::format(
+                         "{:8} {:8}  {:3} passes  {:.3f}s  with checkpoints {:.3f}s, differing pixels {}",
+                         adaptive ? "adaptive" : "uniform", filter ? "gaussian" : "", progress->GetNumPassDone(), reference_time,
+                         checkpointed_time, CountMismatches(reference, checkpointed)
+                     )
+                  << std::endl;
+
+        // Stop the render at a time budget and continue from the checkpoint until it is complete
+        std::filesystem::remove(filename);
+        integrator.SetCheckpointing({ .filename = filename, .interval = 0 });
+
+        int32 runs = 0;
+        Image3 resumed;
+        while (true)
+        {
+            integrator.SetProgressiveRendering({ .pass_samples = 4, .time_budget = reference_time / 4 });
+            progress = integrator.Render(*camera);
+            progress->Wait();
+            ++runs;
+
+            // The last run finds every tile done and only loads the checkpoint
+            if (progress->GetNumPassDone() <= 1)
+            {
+                resumed = progress->GetSnapshot().ConvertToImage();
+                break;
+            }
+        }
+
+        int32 mismatches = CountMismatches(reference, resumed);
+        std::cout << std::format("  resumed {} times, differing pixels {}", runs - 1, mismatches) << std::endl;
+    }
+
+    // Checkpointing alone splits the render into passes, so that checkpoints are written before it ends
+    integrator.SetReconstructionFilter(nullptr);
+    integrator.SetAdaptiveSampling({});
+    integrator.SetProgressiveRendering({});
+    std::filesystem::remove(filename);
+    integrator.SetCheckpointing({ .filename = filename, .interval = 0 });
+
+    std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+    progress->Wait();
+    std::cout << std::format("checkpoints only  {} passes", progress->GetNumPassDone()) << std::endl;
+
+    std::filesystem::remove(filename);
+}
+
+static int32 checkpoint_benchmark = Benchmark::Register("checkpoint", CheckpointBenchmark);
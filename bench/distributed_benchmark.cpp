@@ -0,0 +1,105 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(128, 128);
+static const int32 samples_per_pixel = 64;
+static const int32 max_bounces = 8;
+static const int32 part_count = 4;
+
+// Renders the parts to film files, reads them back and merges them as film_merge does
+static Image3 RenderParts(
+    UniDirectionalRayIntegrator& integrator, const Camera& camera, const std::vector<RenderPartitionOptions>& parts, double* time
+)
+{
+    Timer timer;
+
+    std::vector<std::filesystem::path> filenames;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        integrator.SetRenderPartition(parts[i]);
+        std::unique_ptr<RenderingProgress> progress = integrator.Render(camera);
+
+        filenames.push_back(std::format("distributed_benchmark_{}.film", i));
+        WriteFilm(progress->Wait(), filenames.back());
+    }
+
+    Film film(resolution);
+    for (const std::filesystem::path& filename : filenames)
+    {
+        film.Merge(*ReadFilm(filename));
+        std::filesystem::remove(filename);
+    }
+
+    timer.Mark();
+    *time = timer.Get();
+
+    integrator.SetRenderPartition({});
+    return film.ConvertToImage();
+}
+
+static void Compare(const char* name, const Image3& image, const Image3& reference, double time)
+{
+    int32 mismatches = 0;
+    Float max_difference = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            Float d = std::abs(image[i][j] - reference[i][j]) / std::max(reference[i][j], Float(1e-3));
+            max_difference = std::max(max_difference, d);
+            mismatches += d > 0;
+        }
+    }
+
+    std::cout << std::format(
+                     "  {:14} {:.3f}s  differing pixel components {}, max relative difference {:.2e}", name, time, mismatches,
+                     max_difference
+                 )
+              << std::endl;
+}
+
+// Splits a frame into image regions and sample ranges and checks that the merged films match the full render
+static void DistributedBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+
+    IndependentSampler sampler(samples_per_pixel);
+    PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+    Timer timer;
+    std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+    Image3 reference = progress->Wait().ConvertToImage();
+    timer.Mark();
+    double time = timer.Get();
+
+    std::cout << std::format("{}x{} {} spp, full render {:.3f}s", resolution.x, resolution.y, samples_per_pixel, time)
+              << std::endl;
+
+    // Horizontal stripes, every pixel is rendered by exactly one part
+    std::vector<RenderPartitionOptions> regions;
+    for (int32 i = 0; i < part_count; ++i)
+    {
+        Point2i min(0, resolution.y * i / part_count);
+        Point2i max(resolution.x, resolution.y * (i + 1) / part_count);
+        regions.push_back({ .region = AABB2i(min, max) });
+    }
+
+    Image3 image = RenderParts(integrator, *camera, regions, &time);
+    Compare("image regions", image, reference, time);
+
+    // Every part takes a quarter of the samples of all pixels, the sums differ from the full render by rounding only
+    std::vector<RenderPartitionOptions> sample_ranges;
+    for (int32 i = 0; i < part_count; ++i)
+    {
+        int32 begin = samples_per_pixel * i / part_count;
+        int32 end = samples_per_pixel * (i + 1) / part_count;
+        sample_ranges.push_back({ .sample_begin = begin, .sample_end = end });
+    }
+
+    image = RenderParts(integrator, *camera, sample_ranges, &time);
+    Compare("sample ranges", image, reference, time);
+}
+
+static int32 distributed_benchmark = Benchmark::Register("distributed", DistributedBenchmark);
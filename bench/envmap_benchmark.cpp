@@ -0,0 +1,80 @@
+#include "benchmark.h"
+
+static const int32 width = 4096;
+static const int32 height = 2048;
+static const int32 sample_count = 1 << 20;
+
+// Written with the results so that the sampling cannot be optimized away
+static volatile Float sink;
+
+// Environment map of the size of a 4K HDRI, a dim noisy sky with a small bright sun
+static Image3 CreateSky()
+{
+    Image3 image(width, height);
+
+    RNG rng(1234);
+    for (int32 v = 0; v < height; ++v)
+    {
+        for (int32 u = 0; u < width; ++u)
+        {
+            Float d2 = Sqr((u - width / 4) / Float(16)) + Sqr((v - height / 4) / Float(16));
+            Float sun = 10000 * std::exp(-d2);
+            image[u + v * width] = Spectrum(0.3f, 0.5f, 0.8f) * rng.NextFloat() + Spectrum(sun);
+        }
+    }
+
+    return image;
+}
+
+// Construction of ImageInfiniteLight, which builds the 2D distribution over the map, and the throughput of its sampling
+// and pdf evaluation. The sampling and the evaluation run on one thread
+static void EnvmapBenchmark()
+{
+    SpectrumImageTexture l_map(CreateSky(), TexCoordFilter::repeat);
+
+    std::unique_ptr<ImageInfiniteLight> light;
+    double build_time = MeasureBest([&]() { light = std::make_unique<ImageInfiniteLight>(&l_map); }, 3, 0);
+
+    RNG rng(1234);
+    std::vector<Point2> us(sample_count);
+    for (Point2& u : us)
+    {
+        u = Point2(rng.NextFloat(), rng.NextFloat());
+    }
+
+    Intersection ref{ .point = Point3(0), .normal = y_axis };
+
+    Float pdf_sum = 0;
+    std::vector<Ray> rays(sample_count);
+    double sample_time = MeasureBest([&]() {
+        for (int32 i = 0; i < sample_count; ++i)
+        {
+            LightSample light_sample = light->Sample_Li(ref, us[i]);
+            rays[i] = Ray(ref.point, light_sample.wi);
+            pdf_sum += light_sample.pdf;
+        }
+    });
+
+    double pdf_time = MeasureBest([&]() {
+        for (const Ray& ray : rays)
+        {
+            pdf_sum += light->EvaluatePDF(ray);
+        }
+    });
+
+    sink = pdf_sum;
+
+    double samples_per_sec = sample_count / sample_time * 1e-6;
+    double pdfs_per_sec = sample_count / pdf_time * 1e-6;
+
+    std::cout << std::format("{}x{} map", width, height) << std::endl;
+    std::cout << std::format("  {:24} {:8.3f}s", "build", build_time) << std::endl;
+    std::cout << std::format("  {:24} {:8.2f} Msamples/s", "sample", samples_per_sec) << std::endl;
+    std::cout << std::format("  {:24} {:8.2f} Mevaluations/s", "pdf", pdfs_per_sec) << std::endl;
+
+    Benchmark::Record("build seconds", build_time, false);
+    Benchmark::Record("sample Msamples/s", samples_per_sec);
+    Benchmark::Record("pdf Mevaluations/s", pdfs_per_sec);
+}
+
+static int32 envmap_benchmark = Benchmark::Register("envmap", EnvmapBenchmark);
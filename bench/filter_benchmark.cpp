@@ -0,0 +1,98 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(128, 128);
+static const int32 samples_per_pixel = 64;
+static const int32 max_bounces = 8;
+
+static double RMSE(const Image3& image, const Image3& reference)
+{
+    double sum = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            sum += Sqr(double(image[i][j]) - double(reference[i][j]));
+        }
+    }
+
+    return std::sqrt(sum / (resolution.x * resolution.y * 3));
+}
+
+static int32 CountDifferingPixels(const Image3& image, const Image3& reference)
+{
+    int32 count = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        if (image[i].r != reference[i].r || image[i].g != reference[i].g || image[i].b != reference[i].b)
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+// Importance sampling the camera filter against splatting samples with reconstruction filters.
+// The splatted gaussian converges to the same image as the sampled one. Every splatted render is repeated,
+// the filter margins of the tiles are merged in a fixed order so that the repetition is identical
+static void FilterBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+
+    IndependentSampler sampler(samples_per_pixel);
+    PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+    Timer timer;
+    std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+    Image3 reference = progress->Wait().ConvertToImage();
+    timer.Mark();
+
+    std::cout << std::format("{}x{} {} spp", resolution.x, resolution.y, samples_per_pixel) << std::endl;
+    std::cout << std::format("  {:24} {:6.3f}s", "sampled gaussian 0.5", timer.Get()) << std::endl;
+
+    // Noise level, the same filter with other random numbers
+    IndependentSampler other_sampler(samples_per_pixel, 1);
+    PathIntegrator other_integrator(&accel, scene.GetLights(), &other_sampler, max_bounces);
+    progress = other_integrator.Render(*camera);
+    Image3 other = progress->Wait().ConvertToImage();
+
+    double noise = RMSE(other, reference);
+    std::cout << std::format("  {:24} {:>7}  rmse to sampled gaussian {:.5f}", "sampled gaussian, seed 1", "", noise)
+              << std::endl;
+
+    BoxFilter box(1);
+    TentFilter tent(2);
+    GaussianFilter gaussian(0.5f);
+    MitchellFilter mitchell(2);
+
+    std::pair<const char*, const Filter*> filters[] = {
+        { "splatted box 1", &box },
+        { "splatted tent 2", &tent },
+        { "splatted gaussian 0.5", &gaussian },
+        { "splatted mitchell 2", &mitchell },
+    };
+
+    for (auto [name, filter] : filters)
+    {
+        integrator.SetReconstructionFilter(filter);
+
+        timer.Reset();
+        progress = integrator.Render(*camera);
+        Image3 image = progress->Wait().ConvertToImage();
+        timer.Mark();
+
+        progress = integrator.Render(*camera);
+        int32 differing = CountDifferingPixels(progress->Wait().ConvertToImage(), image);
+
+        std::cout << std::format(
+                         "  {:24} {:6.3f}s  rmse to sampled gaussian {:.5f}, repeated render differs in {} pixels", name,
+                         timer.Get(), RMSE(image, reference), differing
+                     )
+                  << std::endl;
+    }
+}
+
+static int32 filter_benchmark = Benchmark::Register("filter", FilterBenchmark);
@@ -0,0 +1,101 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(1024, 1024);
+
+static const int32 grid_size = 16;
+static const int32 sphere_segments = 64;
+
+static Transform GetInstanceTransform(int32 x, int32 z)
+{
+    Quat q(DegToRad(Float(x * 37 + z * 11)), Normalize(Vec3(1, 2, 3)));
+    Vec3 scale(1, 0.5f + 0.05f * ((x + z) % 8), 1);
+    return Transform(Vec3(x * 2.5f, 0, -z * 2.5f), q, scale);
+}
+
+static size_t GetMeshMemoryUsage(int32 segments)
+{
+    size_t vertex_count = size_t(segments + 1) * (segments / 2 + 1);
+    size_t triangle_count = size_t(segments) * segments;
+
+    return vertex_count * (sizeof(Point3) + sizeof(Vec3) + sizeof(Vec3) + sizeof(Point2)) + triangle_count * 3 * sizeof(int32);
+}
+
+// Geometry, primitives and acceleration structure
+static size_t GetTrianglesMemoryUsage(int32 segments)
+{
+    size_t triangle_count = size_t(segments) * segments;
+    return GetMeshMemoryUsage(segments) + triangle_count * (sizeof(Triangle) + sizeof(Primitive) + 2 * sizeof(void*));
+}
+
+static void Report(const char* name, const BVH& accel, double build_time, size_t memory)
+{
+    std::vector<Ray> rays = GeneratePrimaryRays(accel.GetAABB(), resolution);
+
+    double t = Measure([&]() {
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            for (int32 i = begin; i < end; ++i)
+            {
+                Intersection isect;
+                accel.Intersect(&isect, rays[i], Ray::epsilon, infinity);
+            }
+        });
+    });
+
+    std::cout << std::format(
+                     "  {:<10} build {:8.3f}s  memory {:9.2f} MB  closest {:8.2f} Mrays/s", name, build_time, memory / (1024.0 * 1024.0),
+                     rays.size() / t * 1e-6
+                 )
+              << std::endl;
+}
+
+// Memory and trace cost of instancing a mesh versus flattening all of its copies into one BVH
+static void InstancingBenchmark()
+{
+    const int32 copies = grid_size * grid_size;
+    std::cout << std::format("{} copies of a sphere with {} triangles", copies, sphere_segments * sphere_segments) << std::endl;
+
+    {
+        Scene scene;
+        auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+
+        Timer timer;
+        for (int32 z = 0; z < grid_size; ++z)
+        {
+            for (int32 x = 0; x < grid_size; ++x)
+            {
+                CreateSphereMesh(scene, GetInstanceTransform(x, z), sphere_segments, material);
+            }
+        }
+
+        BVH accel(scene.GetPrimitives());
+        timer.Mark();
+
+        size_t memory = copies * GetTrianglesMemoryUsage(sphere_segments) + accel.GetMemoryUsage();
+        Report("flattened", accel, timer.Get(), memory);
+    }
+
+    {
+        Scene scene;
+        auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+
+        Timer timer;
+        const BVH* blas = CreateSphereBLAS(scene, sphere_segments, material);
+        for (int32 z = 0; z < grid_size; ++z)
+        {
+            for (int32 x = 0; x < grid_size; ++x)
+            {
+                scene.CreateInstance(blas, GetInstanceTransform(x, z));
+            }
+        }
+
+        BVH accel(scene.GetPrimitives());
+        timer.Mark();
+
+        size_t memory = GetTrianglesMemoryUsage(sphere_segments) + blas->GetMemoryUsage() +
+                        copies * (sizeof(Instance) + sizeof(Primitive*)) + accel.GetMemoryUsage();
+        Report("instanced", accel, timer.Get(), memory);
+    }
+}
+
+static int32 instancing_benchmark = Benchmark::Register("instancing", InstancingBenchmark);
@@ -0,0 +1,124 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(320, 240);
+static const int32 samples_per_pixel = 16;
+static const int32 max_bounces = 8;
+
+// Spheres of every surface material on a ground plane, lit by an emissive sphere and the sky.
+// Neighbouring pixels hit different materials, so the shading of a tile jumps between material types
+static std::unique_ptr<Camera> CreateMaterialScene(Scene& scene)
+{
+    auto constant = [&](Float value) { return scene.CreateTexture<ConstantTexture, Float>(value); };
+    auto color = [&](const Spectrum& value) { return scene.CreateTexture<ConstantTexture, Spectrum>(value); };
+
+    auto ground = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.5f)));
+    Mesh* plane = CreateGridMesh(scene, 1, ground);
+    std::vector<Point3> positions(plane->GetPositions().begin(), plane->GetPositions().end());
+    for (Point3& p : positions)
+    {
+        p *= 20;
+    }
+    plane->SetPositions(positions);
+
+    RNG rng(1234);
+    for (int32 z = -6; z < 6; ++z)
+    {
+        for (int32 x = -6; x < 6; ++x)
+        {
+            Spectrum c(rng.NextFloat(), rng.NextFloat(), rng.NextFloat());
+            Float roughness = 0.05f + 0.4f * rng.NextFloat();
+
+            const Material* material = nullptr;
+            switch ((x + z + 12) % 6)
+            {
+            case 0:
+                material = scene.CreateMaterial<DiffuseMaterial>(color(c));
+                break;
+            case 1:
+                material = scene.CreateMaterial<MirrorMaterial>(color(c));
+                break;
+            case 2:
+                material = scene.CreateMaterial<DielectricMaterial>(1.5f, constant(roughness * 0.2f), constant(roughness * 0.2f));
+                break;
+            case 3:
+                material = scene.CreateMaterial<ThinDielectricMaterial>(1.5f);
+                break;
+            case 4:
+                material = scene.CreateMaterial<ConductorMaterial>(color(c), constant(roughness), constant(roughness));
+                break;
+            default:
+                material = scene.CreateMaterial<UnrealMaterial>(
+                    color(c), constant(rng.NextFloat()), constant(roughness), constant(roughness)
+                );
+                break;
+            }
+
+            Point3 center(x + 0.5f, 0.4f, z + 0.5f);
+            CreateSphereMesh(scene, Transform(center, Quat(1), Vec3(0.4f)), 24, material);
+        }
+    }
+
+    // Emissive sphere, its triangles are area lights
+    auto emitter = scene.CreateMaterial<DiffuseLightMaterial>(color(Spectrum(20)));
+    CreateSphereMesh(scene, Transform(Point3(0, 6, 0)), 8, emitter);
+    CreateAreaLights(scene, emitter);
+
+    scene.CreateLight<UniformInfiniteLight>(Spectrum(0.3f, 0.4f, 0.5f));
+
+    return std::make_unique<PerspectiveCamera>(Point3(0, 5, 12), Point3(0, 0, 0), y_axis, 40, 0, 1, resolution);
+}
+
+// Renders the same scene with the megakernel and the wavefront path tracer and compares the images
+static void IntegratorBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateMaterialScene(scene);
+
+    BVH accel(scene.GetPrimitives());
+    IndependentSampler sampler(samples_per_pixel);
+
+    std::cout << std::format(
+                     "{} primitives, {} lights, {}x{} {} spp, {} bounces", scene.GetPrimitives().size(), scene.GetLights().size(),
+                     resolution.x, resolution.y, samples_per_pixel, max_bounces
+                 )
+              << std::endl;
+
+    PathIntegrator path(&accel, scene.GetLights(), &sampler, max_bounces);
+    WavefrontPathIntegrator wavefront(&accel, scene.GetLights(), &sampler, max_bounces);
+
+    // Kept until the end, a worker may still be leaving the render job when Wait() returns
+    std::unique_ptr<RenderingProgress> progresses[2];
+    Image3 images[2];
+    Integrator* integrators[2] = { &path, &wavefront };
+    const char* names[2] = { "path", "wavefront" };
+
+    for (int32 i = 0; i < 2; ++i)
+    {
+        Timer timer;
+        progresses[i] = integrators[i]->Render(*camera);
+        images[i] = progresses[i]->Wait().ConvertToImage();
+        timer.Mark();
+        double t = timer.Get();
+
+        double samples = double(resolution.x) * resolution.y * samples_per_pixel;
+        std::cout << std::format("  {:10} {:6.3f}s {:6.3f} Msamples/s", names[i], t, samples / t * 1e-6)
+                  << std::endl;
+    }
+
+    int32 mismatches = 0;
+    Float max_difference = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            Float d = std::abs(images[0][i][j] - images[1][i][j]);
+            max_difference = std::max(max_difference, d);
+            mismatches += d > 0;
+        }
+    }
+
+    std::cout << std::format("  differing pixel components {}, max difference {}", mismatches, max_difference) << std::endl;
+}
+
+static int32 integrator_benchmark = Benchmark::Register("wavefront", IntegratorBenchmark);
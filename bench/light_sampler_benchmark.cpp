@@ -0,0 +1,149 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(128, 128);
+static const int32 samples_per_pixel = 16;
+static const int32 reference_samples_per_pixel = 256;
+static const int32 max_bounces = 4;
+static const int32 light_grid_size = 16;
+
+// Written with the results so that the sampling cannot be optimized away
+static volatile Float sink;
+
+static double RMSE(const Image3& image, const Image3& reference)
+{
+    double sum = 0;
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            sum += Sqr(double(image[i][j]) - double(reference[i][j]));
+        }
+    }
+
+    return std::sqrt(sum / (resolution.x * resolution.y * 3));
+}
+
+// Floor under a grid of small downward facing lights of different colors and power, most of them far from any given point
+static std::unique_ptr<Camera> CreateManyLights(Scene& scene)
+{
+    auto color = [&](const Spectrum& value) { return scene.CreateTexture<ConstantTexture, Spectrum>(value); };
+
+    auto white = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.73f)));
+    CreateQuadMesh(scene, Point3(-10, 0, 10), Vec3(20, 0, 0), Vec3(0, 0, -20), white);
+
+    RNG rng(1234);
+    for (int32 z = 0; z < light_grid_size; ++z)
+    {
+        for (int32 x = 0; x < light_grid_size; ++x)
+        {
+            Spectrum emission(rng.NextFloat(), rng.NextFloat(), rng.NextFloat());
+            emission *= 100 * Sqr(rng.NextFloat());
+
+            auto light = scene.CreateMaterial<DiffuseLightMaterial>(color(emission));
+            Point3 origin(x - light_grid_size / 2 + 0.45f, 0.5f + rng.NextFloat(), light_grid_size / 2 - z - 0.45f);
+            CreateQuadMesh(scene, origin, Vec3(0.1f, 0, 0), Vec3(0, 0, 0.1f), light);
+            CreateAreaLights(scene, light);
+        }
+    }
+
+    return std::make_unique<PerspectiveCamera>(Point3(0, 6, 10), Point3(0, 0, 0), y_axis, 60, 0, 1, resolution);
+}
+
+// Choices per second at random points on the floor, runs on one thread
+static double SampleLights(const LightSampler& light_sampler)
+{
+    RNG rng(1234);
+    std::vector<Intersection> isects(1 << 14);
+    for (Intersection& isect : isects)
+    {
+        isect = Intersection{ .point = Point3(rng.NextFloat() * 20 - 10, 0, rng.NextFloat() * 20 - 10), .normal = y_axis };
+    }
+
+    Float weight_sum = 0;
+    double t = MeasureBest([&]() {
+        for (const Intersection& isect : isects)
+        {
+            SampledLight sampled_light;
+            if (light_sampler.Sample(&sampled_light, isect, rng.NextFloat()))
+            {
+                weight_sum += sampled_light.weight;
+            }
+        }
+    });
+
+    sink = weight_sum;
+
+    return isects.size() / t;
+}
+
+// Uniform light selection against the light hierarchy and resampling on a scene with many lights, at the same number of samples.
+// Both converge to the same image, the error to a reference tells how much noise the choice of the lights adds
+static void LightSamplerBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateManyLights(scene);
+    BVH accel(scene.GetPrimitives());
+
+    IndependentSampler reference_sampler(reference_samples_per_pixel, 1);
+    PathIntegrator reference_integrator(&accel, scene.GetLights(), &reference_sampler, max_bounces);
+    reference_integrator.SetLightSampler(LightSamplerType::bvh);
+    Image3 reference = reference_integrator.Render(*camera)->Wait().ConvertToImage();
+
+    std::cout << std::format(
+                     "{} lights, {}x{} {} spp, reference {} spp", scene.GetLights().size(), resolution.x, resolution.y,
+                     samples_per_pixel, reference_samples_per_pixel
+                 )
+              << std::endl;
+
+    const std::pair<const char*, LightSamplerType> types[] = {
+        { "uniform", LightSamplerType::uniform },
+        { "power", LightSamplerType::power },
+        { "bvh", LightSamplerType::bvh },
+    };
+
+    std::vector<Light*> lights = scene.GetLights();
+    for (auto [name, type] : types)
+    {
+        std::unique_ptr<LightSampler> light_sampler = CreateLightSampler(type, lights, accel.GetAABB());
+        double samples_per_sec = SampleLights(*light_sampler) * 1e-6;
+
+        IndependentSampler sampler(samples_per_pixel);
+        PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+        integrator.SetLightSampler(type);
+
+        Timer timer;
+        Image3 image = integrator.Render(*camera)->Wait().ConvertToImage();
+        timer.Mark();
+
+        double rmse = RMSE(image, reference);
+
+        std::cout << std::format(
+                         "  {:10} {:8.2f} Msamples/s  render {:6.3f}s  rmse {:.5f}", name, samples_per_sec, timer.Get(), rmse
+                     )
+                  << std::endl;
+        Benchmark::Record(std::format("{} Msamples/s", name), samples_per_sec);
+        Benchmark::Record(std::format("{} rmse", name), rmse, false);
+    }
+
+    // Resampling several light samples per shadow ray, the render time grows much slower than the number of candidates
+    for (int32 candidates : { 4, 16 })
+    {
+        IndependentSampler sampler(samples_per_pixel);
+        PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+        integrator.SetLightSampler(LightSamplerType::bvh);
+        integrator.SetLightCandidates(candidates);
+
+        Timer timer;
+        Image3 image = integrator.Render(*camera)->Wait().ConvertToImage();
+        timer.Mark();
+
+        double rmse = RMSE(image, reference);
+
+        std::string name = std::format("bvh ris {}", candidates);
+        std::cout << std::format("  {:10} {:>19}  render {:6.3f}s  rmse {:.5f}", name, "", timer.Get(), rmse) << std::endl;
+        Benchmark::Record(std::format("{} rmse", name), rmse, false);
+    }
+}
+
+static int32 light_sampler_benchmark = Benchmark::Register("lights", LightSamplerBenchmark);
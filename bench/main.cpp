@@ -0,0 +1,157 @@
+#include "benchmark.h"
+
+#include <fstream>
+
+// Results file of --save and --compare, one "name,value,higher_is_better" line per result
+static bool SaveResults(const std::string& filename)
+{
+    std::ofstream out(filename);
+    for (auto& [name, result] : Benchmark::results)
+    {
+        out << std::format("{},{},{}\n", name, result.value, int32(result.higher_is_better));
+    }
+
+    return bool(out);
+}
+
+static bool LoadResults(const std::string& filename, std::map<std::string, Benchmark::Result>* results)
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // The name may contain anything but the last two commas
+        size_t second = line.rfind(',');
+        size_t first = second == std::string::npos || second == 0 ? std::string::npos : line.rfind(',', second - 1);
+        if (first == std::string::npos)
+        {
+            continue;
+        }
+
+        Benchmark::Result result;
+        result.value = std::stod(line.substr(first + 1, second - first - 1));
+        result.higher_is_better = line.substr(second + 1) != "0";
+
+        (*results)[line.substr(0, first)] = result;
+    }
+
+    return true;
+}
+
+// Prints the change of every result against the baseline, returns the number of results worse by more than the tolerance
+static int32 CompareResults(const std::map<std::string, Benchmark::Result>& baseline, double tolerance)
+{
+    std::cout << std::format("[compare] tolerance {:.0f}%", tolerance * 100) << std::endl;
+
+    int32 regressions = 0;
+    for (auto& [name, result] : Benchmark::results)
+    {
+        auto it = baseline.find(name);
+        if (it == baseline.end())
+        {
+            continue;
+        }
+
+        // Positive if better
+        double ratio = result.higher_is_better ? result.value / it->second.value : it->second.value / result.value;
+        double change = ratio - 1;
+
+        const char* verdict = "";
+        if (change < -tolerance)
+        {
+            verdict = "  REGRESSION";
+            ++regressions;
+        }
+        else if (change > tolerance)
+        {
+            verdict = "  improved";
+        }
+
+        std::cout << std::format("  {:60} {:+7.1f}%{}", name, change * 100, verdict) << std::endl;
+    }
+
+    std::cout << std::format("  {} regressions", regressions) << std::endl;
+    return regressions;
+}
+
+// Usage: bench [benchmark names..] [--save results.csv] [--compare baseline.csv] [--tolerance 0.1]
+// Runs all registered benchmarks if no name is given.
+// --save writes the recorded results, --compare checks them against a saved run and fails on regressions.
+// Fails as well if a benchmark reported a broken correctness check
+int main(int argc, char* argv[])
+{
+    ThreadPool::global_thread_pool.reset(new ThreadPool(std::thread::hardware_concurrency()));
+
+    std::vector<std::string> names;
+    std::string save_filename;
+    std::string compare_filename;
+    double tolerance = 0.1;
+
+    for (int32 i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--save" && i + 1 < argc)
+        {
+            save_filename = argv[++i];
+        }
+        else if (arg == "--compare" && i + 1 < argc)
+        {
+            compare_filename = argv[++i];
+        }
+        else if (arg == "--tolerance" && i + 1 < argc)
+        {
+            tolerance = std::atof(argv[++i]);
+        }
+        else
+        {
+            names.push_back(arg);
+        }
+    }
+
+    std::map<std::string, Benchmark::Result> baseline;
+    if (!compare_filename.empty() && !LoadResults(compare_filename, &baseline))
+    {
+        std::cout << "failed to read baseline: " << compare_filename << std::endl;
+        return 1;
+    }
+
+    if (names.empty())
+    {
+        for (auto& [name, func] : Benchmark::benchmarks)
+        {
+            Benchmark::Run(name);
+        }
+    }
+
+    for (const std::string& name : names)
+    {
+        if (!Benchmark::Run(name))
+        {
+            std::cout << "benchmark not found: " << name << std::endl;
+        }
+    }
+
+    if (!save_filename.empty() && !SaveResults(save_filename))
+    {
+        std::cout << "failed to write results: " << save_filename << std::endl;
+        return 1;
+    }
+
+    if (!compare_filename.empty() && CompareResults(baseline, tolerance) > 0)
+    {
+        return 1;
+    }
+
+    if (Benchmark::failures > 0)
+    {
+        std::cout << std::format("{} checks failed", Benchmark::failures) << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
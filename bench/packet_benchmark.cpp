@@ -0,0 +1,218 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(1024, 1024);
+static const int32 tile_size = 16;
+
+// Every check_stride-th batch is checked ray by ray against the single ray queries
+static const int32 check_stride = 16;
+
+struct RayBatch
+{
+    std::vector<Ray> rays;
+    std::vector<Float> t_max;
+};
+
+// Reorders the rays so that the rays of each tile are contiguous, the way the integrators submit them
+static RayBatch ToTileOrder(const std::vector<Ray>& rays)
+{
+    RayBatch batch;
+    batch.rays.reserve(rays.size());
+
+    for (int32 y0 = 0; y0 < resolution.y; y0 += tile_size)
+    {
+        for (int32 x0 = 0; x0 < resolution.x; x0 += tile_size)
+        {
+            for (int32 y = y0; y < y0 + tile_size; ++y)
+            {
+                for (int32 x = x0; x < x0 + tile_size; ++x)
+                {
+                    batch.rays.push_back(rays[x + y * resolution.x]);
+                }
+            }
+        }
+    }
+
+    batch.t_max.assign(batch.rays.size(), infinity);
+    return batch;
+}
+
+// Shadow rays from the primary hit points towards a point light above the scene
+static RayBatch GenerateShadowRays(const Intersectable* accel, const RayBatch& primary)
+{
+    AABB bounds = accel->GetAABB();
+    Point3 light = bounds.GetCenter() + Vec3(0, bounds.GetExtents().y, 0);
+
+    RayBatch batch;
+    for (const Ray& ray : primary.rays)
+    {
+        Intersection isect;
+        if (accel->Intersect(&isect, ray, Ray::epsilon, infinity))
+        {
+            Vec3 d = light - isect.point;
+            Float distance = d.Normalize();
+
+            batch.rays.push_back(Ray(isect.point, d));
+            batch.t_max.push_back(distance);
+        }
+    }
+
+    return batch;
+}
+
+static double TraceSingle(const Intersectable* accel, const RayBatch& batch, bool any)
+{
+    return Measure([&]() {
+        ParallelFor(0, int32(batch.rays.size()), [&](int32 begin, int32 end) {
+            for (int32 i = begin; i < end; ++i)
+            {
+                if (any)
+                {
+                    accel->IntersectAny(batch.rays[i], Ray::epsilon, batch.t_max[i]);
+                }
+                else
+                {
+                    Intersection isect;
+                    accel->Intersect(&isect, batch.rays[i], Ray::epsilon, batch.t_max[i]);
+                }
+            }
+        });
+    });
+}
+
+static double TraceBatch(const Intersectable* accel, const RayBatch& batch, bool any)
+{
+    const int32 batch_size = tile_size * tile_size;
+    const int32 batch_count = (int32(batch.rays.size()) + batch_size - 1) / batch_size;
+
+    return Measure([&]() {
+        ParallelFor(0, batch_count, [&](int32 b) {
+            size_t begin = size_t(b) * batch_size;
+            size_t count = std::min<size_t>(batch_size, batch.rays.size() - begin);
+
+            std::span<const Ray> rays(batch.rays.data() + begin, count);
+            std::span<const Float> t_max(batch.t_max.data() + begin, count);
+
+            bool hits[batch_size];
+            if (any)
+            {
+                accel->IntersectAnyBatch(std::span<bool>(hits, count), rays, Ray::epsilon, t_max);
+            }
+            else
+            {
+                Intersection isects[batch_size];
+                accel->IntersectBatch(std::span<Intersection>(isects, count), std::span<bool>(hits, count), rays, Ray::epsilon, t_max);
+            }
+        });
+    });
+}
+
+// Traces the checked batches with random maximum distances, returns the number of rays whose batched result
+// differs from the single ray query. The distances of the shadow rays are only ever shortened
+static int32 CountBatchMismatches(const Intersectable* accel, const RayBatch& batch, bool any)
+{
+    const int32 batch_size = tile_size * tile_size;
+    const int32 batch_count = (int32(batch.rays.size()) + batch_size - 1) / batch_size;
+
+    std::vector<Float> t_max = GenerateRayTMax(accel->GetAABB(), batch.rays.size(), 1234);
+    for (size_t i = 0; i < t_max.size(); ++i)
+    {
+        t_max[i] = std::min(t_max[i], batch.t_max[i]);
+    }
+
+    std::atomic<int32> mismatches = 0;
+    ParallelFor(0, (batch_count + check_stride - 1) / check_stride, [&](int32 c) {
+        size_t begin = size_t(c) * check_stride * batch_size;
+        size_t count = std::min<size_t>(batch_size, batch.rays.size() - begin);
+
+        std::span<const Ray> rays(batch.rays.data() + begin, count);
+        std::span<const Float> ray_t_max(t_max.data() + begin, count);
+
+        bool hits[batch_size];
+        Intersection isects[batch_size];
+        if (any)
+        {
+            accel->IntersectAnyBatch(std::span<bool>(hits, count), rays, Ray::epsilon, ray_t_max);
+        }
+        else
+        {
+            accel->IntersectBatch(
+                std::span<Intersection>(isects, count), std::span<bool>(hits, count), rays, Ray::epsilon, ray_t_max
+            );
+        }
+
+        int32 local_mismatches = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Intersection isect;
+            bool hit = accel->Intersect(&isect, rays[i], Ray::epsilon, ray_t_max[i]);
+
+            if (any)
+            {
+                local_mismatches += hits[i] != hit;
+            }
+            else
+            {
+                ReferenceHit reference{ hit, isect.t, isect.primitive };
+                local_mismatches += !MatchesReference(reference, rays[i], ray_t_max[i], hits[i], isects[i]);
+            }
+        }
+        mismatches += local_mismatches;
+    });
+
+    return mismatches;
+}
+
+static void Report(const char* name, const Intersectable* accel, const RayBatch& batch, bool any)
+{
+    double single = batch.rays.size() / TraceSingle(accel, batch, any) * 1e-6;
+    double packet = batch.rays.size() / TraceBatch(accel, batch, any) * 1e-6;
+    int32 mismatches = CountBatchMismatches(accel, batch, any);
+
+    std::cout << std::format(
+                     "  {:<10} single {:8.2f} Mrays/s  batch {:8.2f} Mrays/s  ({:.2f}x)  mismatches {}", name, single, packet,
+                     packet / single, mismatches
+                 )
+              << std::endl;
+
+    if (mismatches > 0)
+    {
+        Benchmark::Fail(std::format("{} batches differ from the single ray queries in {} rays", name, mismatches));
+    }
+}
+
+// Compares the per tile batched queries of BVH with tracing the same rays one by one.
+// The batched hits are checked ray by ray against the single ray queries, with random maximum distances
+static void PacketBenchmark()
+{
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        std::cout << bench_scene.name << " (" << scene.GetPrimitives().size() << " primitives)" << std::endl;
+
+        BVH bvh(scene.GetPrimitives());
+
+        RayBatch primary = ToTileOrder(GeneratePrimaryRays(bvh.GetAABB(), resolution));
+        RayBatch shadow = GenerateShadowRays(&bvh, primary);
+
+        // Same rays in random order, every batch is incoherent
+        RayBatch shuffled = primary;
+        RNG rng(1234);
+        for (size_t i = shuffled.rays.size() - 1; i > 0; --i)
+        {
+            std::swap(shuffled.rays[i], shuffled.rays[rng.NextUint(uint32(i + 1))]);
+        }
+
+        Report("primary", &bvh, primary, false);
+        Report("shadow", &bvh, shadow, true);
+        Report("shuffled", &bvh, shuffled, false);
+    }
+}
+
+static int32 packet_benchmark = Benchmark::Register("packet", PacketBenchmark);
@@ -0,0 +1,151 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(256, 256);
+static const int32 max_bounces = 8;
+static const int32 pass_samples = 4;
+
+// A snapshot is consistent if all pixels took the same number of samples, NaN and infinite samples aside
+static bool IsConsistent(const Film& film)
+{
+    Float max_weight = 0;
+    for (Point2i pixel : AABB2i(Point2i(0, 0), resolution))
+    {
+        max_weight = std::max(max_weight, film.GetWeight(pixel));
+    }
+
+    int32 outliers = 0;
+    for (Point2i pixel : AABB2i(Point2i(0, 0), resolution))
+    {
+        outliers += film.GetWeight(pixel) < max_weight - 1;
+    }
+
+    return outliers == 0 && int32(max_weight) % pass_samples == 0;
+}
+
+// Time budgets and snapshots of the progressive render, and its difference to the tile by tile render
+static void ProgressiveBenchmark()
+{
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+
+    {
+        const int32 spp = 16;
+
+        IndependentSampler sampler(spp);
+        PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+        std::unique_ptr<RenderingProgress> tiled = integrator.Render(*camera);
+        Image3 a = tiled->Wait().ConvertToImage();
+
+        integrator.SetProgressiveRendering({ .pass_samples = pass_samples });
+        std::unique_ptr<RenderingProgress> progressive = integrator.Render(*camera);
+        Image3 b = progressive->Wait().ConvertToImage();
+
+        // The passes are accumulated in tiles before they are added to the film, only the rounding differs
+        Float max_difference = 0;
+        for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+        {
+            for (int32 j = 0; j < 3; ++j)
+            {
+                max_difference = std::max(max_difference, std::abs(a[i][j] - b[i][j]) / std::max(a[i][j], Float(1e-3)));
+            }
+        }
+
+        std::cout << std::format(
+                         "{} spp tiled vs {} passes, max relative difference {:.2e}", spp, progressive->GetNumPassDone(),
+                         max_difference
+                     )
+                  << std::endl;
+    }
+
+    // Budgets shorter than the first pass, with and without a pass size. The first pass is finished regardless
+    {
+        IndependentSampler sampler(64);
+        PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+        const std::pair<const char*, ProgressiveRenderingOptions> cases[] = {
+            { "budget only", { .time_budget = 0.05 } },
+            { "passes", { .pass_samples = pass_samples, .time_budget = 0.05 } },
+        };
+
+        for (const auto& [name, options] : cases)
+        {
+            integrator.SetProgressiveRendering(options);
+
+            Timer timer;
+            std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+            const Film& film = progress->Wait();
+            timer.Mark();
+
+            Image3 image = film.ConvertToImage();
+
+            int32 empty_pixels = 0;
+            int32 nan_pixels = 0;
+            for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+            {
+                empty_pixels += film.GetWeight(Point2i(i % resolution.x, i / resolution.x)) == 0;
+                nan_pixels += std::isnan(image[i].r) || std::isnan(image[i].g) || std::isnan(image[i].b);
+            }
+
+            std::cout << std::format(
+                             "  budget {:4.2f}s  took {:6.3f}s  {:4} passes  {}: {} empty pixels, {} NaN pixels",
+                             options.time_budget, timer.Get(), progress->GetNumPassDone(), name, empty_pixels, nan_pixels
+                         )
+                      << std::endl;
+            Benchmark::Record(std::format("short budget {} empty pixels", name), empty_pixels, false);
+        }
+    }
+
+    IndependentSampler sampler(1 << 20);
+    PathIntegrator integrator(&accel, scene.GetLights(), &sampler, max_bounces);
+
+    for (double budget : { 0.5, 1.0, 2.0, 4.0 })
+    {
+        integrator.SetProgressiveRendering({ .pass_samples = pass_samples, .time_budget = budget });
+
+        Timer timer;
+        std::unique_ptr<RenderingProgress> progress = integrator.Render(*camera);
+
+        // Poll snapshots while the workers keep rendering
+        int32 snapshots = 0;
+        int32 inconsistent = 0;
+        double snapshot_time = 0;
+        while (!progress->IsDone())
+        {
+            Timer snapshot_timer;
+            Film snapshot = progress->GetSnapshot();
+            snapshot_timer.Mark();
+            snapshot_time += snapshot_timer.Get();
+
+            ++snapshots;
+            inconsistent += !IsConsistent(snapshot);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        progress->Wait();
+        timer.Mark();
+        double t = timer.Get();
+
+        Film film = progress->GetSnapshot();
+        double weights = 0;
+        for (Point2i pixel : AABB2i(Point2i(0, 0), resolution))
+        {
+            weights += film.GetWeight(pixel);
+        }
+
+        std::cout << std::format(
+                         "  budget {:4.1f}s  took {:6.3f}s  {:4} passes {:7.1f} spp", budget, t, progress->GetNumPassDone(),
+                         weights / (resolution.x * resolution.y)
+                     )
+                  << std::format(
+                         "  {} snapshots {:.3f}ms each, {} inconsistent", snapshots, snapshot_time / std::max(snapshots, 1) * 1e3,
+                         inconsistent
+                     )
+                  << std::endl;
+    }
+}
+
+static int32 progressive_benchmark = Benchmark::Register("progressive", ProgressiveBenchmark);
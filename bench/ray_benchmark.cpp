@@ -0,0 +1,92 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(256, 256);
+
+// Diffuse bounces off the primary hits, cosine distributed about the normal facing the ray. Rays that missed are dropped
+static std::vector<Ray> GenerateDiffuseRays(const Intersectable* accel, const std::vector<Ray>& primary, uint64 seed)
+{
+    RNG rng(seed);
+
+    std::vector<Ray> rays;
+    rays.reserve(primary.size());
+
+    for (const Ray& ray : primary)
+    {
+        Intersection isect;
+        if (!accel->Intersect(&isect, ray, Ray::epsilon, infinity))
+        {
+            continue;
+        }
+
+        Vec3 normal = Dot(isect.normal, ray.d) < 0 ? isect.normal : -isect.normal;
+        Vec3 d = Frame::FromZ(normal).FromLocal(SampleCosineHemisphere({ rng.NextFloat(), rng.NextFloat() }));
+
+        rays.emplace_back(isect.point, d);
+    }
+
+    return rays;
+}
+
+// Rays per second of the closest or the any hit query
+static double Trace(const Intersectable* accel, const std::vector<Ray>& rays, bool any)
+{
+    double t = MeasureBest([&]() {
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            for (int32 i = begin; i < end; ++i)
+            {
+                if (any)
+                {
+                    accel->IntersectAny(rays[i], Ray::epsilon, infinity);
+                }
+                else
+                {
+                    Intersection isect;
+                    accel->Intersect(&isect, rays[i], Ray::epsilon, infinity);
+                }
+            }
+        });
+    });
+
+    return rays.size() / t;
+}
+
+// BVH build time and ray throughput on coherent primary rays and on incoherent diffuse bounces
+static void RayBenchmark()
+{
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        std::unique_ptr<BVH> bvh;
+        double build_time = MeasureBest([&]() { bvh = std::make_unique<BVH>(scene.GetPrimitives()); }, 3, 0);
+
+        std::vector<Ray> primary = GeneratePrimaryRays(bvh->GetAABB(), resolution);
+        std::vector<Ray> diffuse = GenerateDiffuseRays(bvh.get(), primary, 1234);
+
+        std::cout << std::format(
+                         "{} ({} primitives), build {:.3f}s, {} primary and {} diffuse rays", bench_scene.name,
+                         scene.GetPrimitives().size(), build_time, primary.size(), diffuse.size()
+                     )
+                  << std::endl;
+        Benchmark::Record(bench_scene.name + "/build seconds", build_time, false);
+
+        const std::pair<const char*, const std::vector<Ray>*> ray_sets[] = { { "primary", &primary }, { "diffuse", &diffuse } };
+        for (auto [name, rays] : ray_sets)
+        {
+            double closest = Trace(bvh.get(), *rays, false) * 1e-6;
+            double any = Trace(bvh.get(), *rays, true) * 1e-6;
+
+            std::cout << std::format("  {:8} closest {:8.2f} Mrays/s  any {:8.2f} Mrays/s", name, closest, any) << std::endl;
+            Benchmark::Record(std::format("{}/{} closest Mrays/s", bench_scene.name, name), closest);
+            Benchmark::Record(std::format("{}/{} any Mrays/s", bench_scene.name, name), any);
+        }
+    }
+}
+
+static int32 ray_benchmark = Benchmark::Register("rays", RayBenchmark);
@@ -0,0 +1,88 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(512, 512);
+
+static const int32 grid_resolution = 384;
+static const int32 frame_count = 8;
+
+// Twists the grid around the y axis and ripples it, the twist grows with every frame
+static void Deform(const std::vector<Point3>& rest, std::vector<Point3>* positions, int32 frame)
+{
+    for (size_t i = 0; i < rest.size(); ++i)
+    {
+        const Point3& p = rest[i];
+        Float r = std::sqrt(p.x * p.x + p.z * p.z);
+
+        Float angle = frame * 0.4f * r;
+        Float c = std::cos(angle), s = std::sin(angle);
+
+        (*positions)[i] = Point3(c * p.x - s * p.z, 0.1f * std::sin(8 * r - frame), s * p.x + c * p.z);
+    }
+}
+
+static double TraceClosest(const BVH& accel, const std::vector<Ray>& rays)
+{
+    double t = Measure(
+        [&]() {
+            ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+                for (int32 i = begin; i < end; ++i)
+                {
+                    Intersection isect;
+                    accel.Intersect(&isect, rays[i], Ray::epsilon, infinity);
+                }
+            });
+        },
+        0.2
+    );
+
+    return rays.size() / t;
+}
+
+// Per frame cost and tree quality of refitting a deforming mesh versus rebuilding its BVH
+static void RefitBenchmark()
+{
+    Scene scene;
+    auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+    Mesh* mesh = CreateGridMesh(scene, grid_resolution, material);
+
+    std::cout << std::format("grid with {} triangles, twisted a bit more every frame", mesh->GetTriangleCount()) << std::endl;
+
+    std::vector<Point3> rest(mesh->GetPositions().begin(), mesh->GetPositions().end());
+    std::vector<Point3> positions(rest.size());
+
+    BVH refitted(scene.GetPrimitives());
+    BVH partially_rebuilt(scene.GetPrimitives());
+
+    for (int32 frame = 1; frame <= frame_count; ++frame)
+    {
+        Deform(rest, &positions, frame);
+        mesh->SetPositions(positions);
+
+        Timer timer;
+        BVH rebuilt(scene.GetPrimitives());
+        timer.Mark();
+        double rebuild_time = timer.Get();
+
+        refitted.Refit();
+        timer.Mark();
+        double refit_time = timer.Get();
+
+        int32 rebuild_count = partially_rebuilt.Refit(1.5f);
+        timer.Mark();
+        double partial_time = timer.Get();
+
+        std::vector<Ray> rays = GeneratePrimaryRays(rebuilt.GetAABB(), resolution);
+
+        std::cout << std::format(
+                         "  frame {}  rebuild {:6.3f}s {:6.2f} SAH {:5.2f} Mrays/s  refit {:6.3f}s {:6.2f} SAH {:5.2f} Mrays/s  "
+                         "refit+rebuild {:6.3f}s {:6.2f} SAH {:5.2f} Mrays/s ({} subtrees)",
+                         frame, rebuild_time, rebuilt.GetSAHCost(), TraceClosest(rebuilt, rays) * 1e-6, refit_time,
+                         refitted.GetSAHCost(), TraceClosest(refitted, rays) * 1e-6, partial_time, partially_rebuilt.GetSAHCost(),
+                         TraceClosest(partially_rebuilt, rays) * 1e-6, rebuild_count
+                     )
+                  << std::endl;
+    }
+}
+
+static int32 refit_benchmark = Benchmark::Register("refit", RefitBenchmark);
@@ -0,0 +1,152 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const int32 reference_samples_per_pixel = 4096;
+static const int32 max_bounces = 4;
+
+// Veach's multiple importance sampling test, four glossy plates of increasing roughness under spherical lights of
+// decreasing size and increasing power
+static std::unique_ptr<Camera> CreateMISTest(Scene& scene, const Point2i& resolution)
+{
+    auto color = [&](const Spectrum& value) { return scene.CreateTexture<ConstantTexture, Spectrum>(value); };
+    auto constant = [&](Float value) { return scene.CreateTexture<ConstantTexture, Float>(value); };
+
+    auto floor = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.4f)));
+    if (!LoadOBJ(scene, "res/veach_mi/floor.obj", identity, floor))
+    {
+        return nullptr;
+    }
+
+    const Float roughnesses[] = { 0.005f, 0.02f, 0.05f, 0.1f };
+    for (int32 i = 0; i < 4; ++i)
+    {
+        Float roughness = std::sqrt(roughnesses[i]);
+        auto plate = scene.CreateMaterial<UnrealMaterial>(
+            color(Spectrum(0.07f, 0.09f, 0.13f)), constant(1), constant(roughness), constant(roughness)
+        );
+        if (!LoadOBJ(scene, std::format("res/veach_mi/plate{}.obj", i + 1), identity, plate))
+        {
+            return nullptr;
+        }
+    }
+
+    const std::tuple<Point3, Float, Float> spheres[] = {
+        { Point3(10, 10, 4), 0.5f, 800 },
+        { Point3(-3.75f, 0, 0), 0.03333f, 901.803f },
+        { Point3(-1.25f, 0, 0), 0.1f, 100 },
+        { Point3(1.25f, 0, 0), 0.3f, 11.1111f },
+        { Point3(3.75f, 0, 0), 0.9f, 1.23457f },
+    };
+    for (auto [center, radius, emission] : spheres)
+    {
+        // The sphere meshes face inwards
+        auto light = scene.CreateMaterial<DiffuseLightMaterial>(color(Spectrum(emission)), true);
+        CreateSphereMesh(scene, Transform(center, Quat(1), Vec3(radius)), 16, light);
+        CreateAreaLights(scene, light);
+    }
+
+    Point3 lookfrom(0, 2, 15);
+    Point3 lookat(0, -2, 2.5f);
+    return std::make_unique<PerspectiveCamera>(lookfrom, lookat, y_axis, 28, 0, Dist(lookfrom, lookat), resolution);
+}
+
+static Image3 Render(const Camera& camera, const Intersectable* accel, const std::vector<Light*>& lights, const Sampler* sampler)
+{
+    PathIntegrator integrator(accel, lights, sampler, max_bounces);
+    return integrator.Render(camera)->Wait().ConvertToImage();
+}
+
+static double MSE(const Image3& image, const Image3& reference)
+{
+    double sum = 0;
+    for (int32 i = 0; i < image.width * image.height; ++i)
+    {
+        for (int32 j = 0; j < 3; ++j)
+        {
+            sum += Sqr(double(image[i][j]) - double(reference[i][j]));
+        }
+    }
+
+    return sum / (image.width * image.height * 3);
+}
+
+// Error against a high sample count reference as the sample count grows, for every sampler.
+// Independent samples converge at O(1/n), the stratified and the low discrepancy samplers faster where the integrand is smooth
+static void SamplerBenchmark()
+{
+    struct TestScene
+    {
+        const char* name;
+        Point2i resolution;
+        std::function<std::unique_ptr<Camera>(Scene&, const Point2i&)> create;
+    };
+
+    const TestScene test_scenes[] = {
+        { "cornell-box", Point2i(64, 64), CreateCornellBox },
+        { "mis", Point2i(96, 54), CreateMISTest },
+    };
+
+    for (const TestScene& test_scene : test_scenes)
+    {
+        Scene scene;
+        std::unique_ptr<Camera> camera = test_scene.create(scene, test_scene.resolution);
+        if (!camera)
+        {
+            std::cout << std::format("{}: failed to load the scene", test_scene.name) << std::endl;
+            continue;
+        }
+
+        BVH accel(scene.GetPrimitives());
+        const Point2i& resolution = test_scene.resolution;
+
+        // Seeded apart from the compared independent sampler
+        IndependentSampler reference_sampler(reference_samples_per_pixel, 1);
+        Image3 reference = Render(*camera, &accel, scene.GetLights(), &reference_sampler);
+
+        std::cout << std::format(
+                         "{} {}x{}, reference {} spp", test_scene.name, resolution.x, resolution.y, reference_samples_per_pixel
+                     )
+                  << std::endl;
+        std::cout << std::format("  {:12}", "spp");
+        for (int32 spp = 4; spp <= 256; spp *= 4)
+        {
+            std::cout << std::format(" {:>12}", spp);
+        }
+        std::cout << std::endl;
+
+        const char* names[] = { "independent", "stratified", "sobol", "zsobol" };
+        for (const char* name : names)
+        {
+            std::cout << std::format("  {:12}", name);
+            for (int32 spp = 4; spp <= 256; spp *= 4)
+            {
+                std::unique_ptr<Sampler> sampler;
+                if (name == names[0])
+                {
+                    sampler = std::make_unique<IndependentSampler>(spp);
+                }
+                else if (name == names[1])
+                {
+                    int32 n = int32(std::sqrt(spp));
+                    sampler = std::make_unique<StratifiedSampler>(n, n, true);
+                }
+                else if (name == names[2])
+                {
+                    sampler = std::make_unique<SobolSampler>(spp);
+                }
+                else
+                {
+                    sampler = std::make_unique<ZSobolSampler>(spp, resolution);
+                }
+
+                double mse = MSE(Render(*camera, &accel, scene.GetLights(), sampler.get()), reference);
+
+                std::cout << std::format(" {:12.4e}", mse);
+                Benchmark::Record(std::format("{}/{}/{} spp mse", test_scene.name, name, spp), mse, false);
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+static int32 sampler_benchmark = Benchmark::Register("samplers", SamplerBenchmark);
@@ -0,0 +1,437 @@
+#include "scenes.h"
+
+#include <fstream>
+
+static void CreateTriangles(Scene& scene, const Mesh* mesh, const Material* material)
+{
+    for (int32 i = 0; i < mesh->GetTriangleCount(); ++i)
+    {
+        Triangle* triangle = scene.CreateShape<Triangle>(mesh, i);
+        scene.CreatePrimitive<Primitive>(triangle, material, MediumInterface{});
+    }
+}
+
+static Mesh* CreateMesh(Scene& scene, std::vector<Point3> positions, std::vector<int32> indices, const Transform& transform)
+{
+    // Compute smooth vertex normals
+    std::vector<Vec3> normals(positions.size(), Vec3::zero);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const Point3& p0 = positions[indices[i + 0]];
+        const Point3& p1 = positions[indices[i + 1]];
+        const Point3& p2 = positions[indices[i + 2]];
+
+        Vec3 n = Cross(p1 - p0, p2 - p0);
+        normals[indices[i + 0]] += n;
+        normals[indices[i + 1]] += n;
+        normals[indices[i + 2]] += n;
+    }
+
+    std::vector<Vec3> tangents(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        normals[i] = Length2(normals[i]) > 0 ? Normalize(normals[i]) : z_axis;
+        tangents[i] = Frame::FromZ(normals[i]).x;
+    }
+
+    std::vector<Point2> tex_coords(positions.size(), Point2(0));
+
+    return scene.CreateMesh(
+        std::move(positions), std::move(normals), std::move(tangents), std::move(tex_coords), std::move(indices), Mat4(transform)
+    );
+}
+
+bool LoadOBJ(Scene& scene, const std::string& filename, const Transform& transform, const Material* material)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<Point3> positions;
+    std::vector<int32> indices;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string type;
+        ss >> type;
+
+        if (type == "v")
+        {
+            Point3 p;
+            ss >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        }
+        else if (type == "f")
+        {
+            // Triangulate polygon as a fan, only the position indices are used
+            std::vector<int32> face;
+            std::string vertex;
+            while (ss >> vertex)
+            {
+                int32 index = std::stoi(vertex.substr(0, vertex.find('/')));
+                face.push_back(index < 0 ? int32(positions.size()) + index : index - 1);
+            }
+
+            for (size_t i = 2; i < face.size(); ++i)
+            {
+                indices.push_back(face[0]);
+                indices.push_back(face[i - 1]);
+                indices.push_back(face[i]);
+            }
+        }
+    }
+
+    if (indices.empty())
+    {
+        return false;
+    }
+
+    Mesh* mesh = CreateMesh(scene, std::move(positions), std::move(indices), transform);
+    CreateTriangles(scene, mesh, material);
+
+    return true;
+}
+
+void CreateRandomTriangles(Scene& scene, int32 count, uint64 seed, const Material* material)
+{
+    RNG rng(seed);
+    auto rand = [&rng](Float min, Float max) { return min + (max - min) * rng.NextFloat(); };
+
+    std::vector<Point3> positions;
+    std::vector<int32> indices;
+    positions.reserve(count * 3);
+    indices.reserve(count * 3);
+
+    for (int32 i = 0; i < count; ++i)
+    {
+        Point3 center(rand(-1, 1), rand(-1, 1), rand(-1, 1));
+        for (int32 j = 0; j < 3; ++j)
+        {
+            indices.push_back(int32(positions.size()));
+            positions.push_back(center + Vec3(rand(-0.02f, 0.02f), rand(-0.02f, 0.02f), rand(-0.02f, 0.02f)));
+        }
+    }
+
+    Mesh* mesh = CreateMesh(scene, std::move(positions), std::move(indices), identity);
+    CreateTriangles(scene, mesh, material);
+}
+
+void CreateSliverTriangles(Scene& scene, int32 count, uint64 seed, const Material* material)
+{
+    RNG rng(seed);
+    auto rand = [&rng](Float min, Float max) { return min + (max - min) * rng.NextFloat(); };
+
+    std::vector<Point3> positions;
+    std::vector<int32> indices;
+    positions.reserve(count * 3);
+    indices.reserve(count * 3);
+
+    for (int32 i = 0; i < count; ++i)
+    {
+        // Long and thin triangle in a random direction, its bounds are mostly empty space
+        Point3 a(rand(-1, 1), rand(-1, 1), rand(-1, 1));
+        Point3 b = a + Vec3(rand(-0.5f, 0.5f), rand(-0.5f, 0.5f), rand(-0.5f, 0.5f));
+        Vec3 offset(rand(-0.01f, 0.01f), rand(-0.01f, 0.01f), rand(-0.01f, 0.01f));
+
+        indices.push_back(int32(positions.size()));
+        positions.push_back(a);
+        indices.push_back(int32(positions.size()));
+        positions.push_back(b);
+        indices.push_back(int32(positions.size()));
+        positions.push_back(b + offset);
+    }
+
+    Mesh* mesh = CreateMesh(scene, std::move(positions), std::move(indices), identity);
+    CreateTriangles(scene, mesh, material);
+}
+
+static Mesh* CreateUVSphere(Scene& scene, const Transform& transform, int32 segments)
+{
+    std::vector<Point3> positions;
+    std::vector<int32> indices;
+
+    int32 rings = segments / 2;
+    for (int32 j = 0; j <= rings; ++j)
+    {
+        Float theta = pi * j / rings;
+        for (int32 i = 0; i <= segments; ++i)
+        {
+            Float phi = two_pi * i / segments;
+            positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+
+    for (int32 j = 0; j < rings; ++j)
+    {
+        for (int32 i = 0; i < segments; ++i)
+        {
+            int32 i0 = j * (segments + 1) + i;
+            int32 i1 = i0 + segments + 1;
+
+            indices.insert(indices.end(), { i0, i1, i0 + 1 });
+            indices.insert(indices.end(), { i0 + 1, i1, i1 + 1 });
+        }
+    }
+
+    return CreateMesh(scene, std::move(positions), std::move(indices), transform);
+}
+
+Mesh* CreateSphereMesh(Scene& scene, const Transform& transform, int32 segments, const Material* material)
+{
+    Mesh* mesh = CreateUVSphere(scene, transform, segments);
+    CreateTriangles(scene, mesh, material);
+
+    return mesh;
+}
+
+Mesh* CreateGridMesh(Scene& scene, int32 resolution, const Material* material)
+{
+    std::vector<Point3> positions;
+    std::vector<int32> indices;
+
+    for (int32 j = 0; j <= resolution; ++j)
+    {
+        for (int32 i = 0; i <= resolution; ++i)
+        {
+            positions.emplace_back(Float(i) / resolution * 2 - 1, 0, Float(j) / resolution * 2 - 1);
+        }
+    }
+
+    for (int32 j = 0; j < resolution; ++j)
+    {
+        for (int32 i = 0; i < resolution; ++i)
+        {
+            int32 i0 = j * (resolution + 1) + i;
+            int32 i1 = i0 + resolution + 1;
+
+            indices.insert(indices.end(), { i0, i1, i0 + 1 });
+            indices.insert(indices.end(), { i0 + 1, i1, i1 + 1 });
+        }
+    }
+
+    Mesh* mesh = CreateMesh(scene, std::move(positions), std::move(indices), identity);
+    CreateTriangles(scene, mesh, material);
+
+    return mesh;
+}
+
+Mesh* CreateQuadMesh(Scene& scene, const Point3& origin, const Vec3& u, const Vec3& v, const Material* material)
+{
+    std::vector<Point3> positions = { origin, origin + u, origin + v, origin + u + v };
+    std::vector<int32> indices = { 0, 1, 2, 1, 3, 2 };
+
+    Mesh* mesh = CreateMesh(scene, std::move(positions), std::move(indices), identity);
+    CreateTriangles(scene, mesh, material);
+
+    return mesh;
+}
+
+void CreateAreaLights(Scene& scene, const Material* material)
+{
+    for (Primitive* primitive : scene.GetPrimitives())
+    {
+        if (primitive->GetMaterial() == material)
+        {
+            scene.CreateLight<AreaLight>(primitive);
+        }
+    }
+}
+
+std::unique_ptr<Camera> CreateCornellBox(Scene& scene, const Point2i& resolution)
+{
+    auto color = [&](const Spectrum& value) { return scene.CreateTexture<ConstantTexture, Spectrum>(value); };
+    auto constant = [&](Float value) { return scene.CreateTexture<ConstantTexture, Float>(value); };
+
+    auto white = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.73f)));
+    auto red = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.65f, 0.05f, 0.05f)));
+    auto green = scene.CreateMaterial<DiffuseMaterial>(color(Spectrum(0.12f, 0.45f, 0.15f)));
+    auto glass = scene.CreateMaterial<DielectricMaterial>(1.5f, constant(0), constant(0));
+    auto light = scene.CreateMaterial<DiffuseLightMaterial>(color(Spectrum(15)));
+
+    CreateQuadMesh(scene, Point3(0, 0, 0), Vec3(0, 0, -1), Vec3(1, 0, 0), white);      // Floor
+    CreateQuadMesh(scene, Point3(0, 1, 0), Vec3(1, 0, 0), Vec3(0, 0, -1), white);      // Ceiling
+    CreateQuadMesh(scene, Point3(0, 0, -1), Vec3(0, 1, 0), Vec3(1, 0, 0), white);      // Back
+    CreateQuadMesh(scene, Point3(0, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, -1), red);        // Left
+    CreateQuadMesh(scene, Point3(1, 0, 0), Vec3(0, 0, -1), Vec3(0, 1, 0), green);      // Right
+    CreateQuadMesh(scene, Point3(0.4f, 0.999f, -0.4f), Vec3(0, 0, -0.2f), Vec3(0.2f, 0, 0), light);
+
+    CreateSphereMesh(scene, Transform(Point3(0.3f, 0.18f, -0.65f), Quat(1), Vec3(0.18f)), 32, white);
+    CreateSphereMesh(scene, Transform(Point3(0.7f, 0.18f, -0.35f), Quat(1), Vec3(0.18f)), 32, glass);
+
+    CreateAreaLights(scene, light);
+
+    return std::make_unique<PerspectiveCamera>(Point3(0.5f, 0.5f, 1.64f), Point3(0.5f, 0.5f, 0), y_axis, 40, 0, 1, resolution);
+}
+
+const BVH* CreateSphereBLAS(Scene& scene, int32 segments, const Material* material)
+{
+    Mesh* mesh = CreateUVSphere(scene, identity, segments);
+    return scene.CreateBLAS(mesh, material);
+}
+
+const std::vector<BenchmarkScene>& GetBenchmarkScenes()
+{
+    static const std::vector<BenchmarkScene> scenes = {
+        { "random-triangles",
+          [](Scene& scene) {
+              auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+              CreateRandomTriangles(scene, 200000, 1234, material);
+              return true;
+          } },
+        { "sliver-triangles",
+          [](Scene& scene) {
+              auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+              CreateSliverTriangles(scene, 20000, 4321, material);
+              return true;
+          } },
+        { "sphere-grid",
+          [](Scene& scene) {
+              auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+              for (int32 z = 0; z < 8; ++z)
+              {
+                  for (int32 x = 0; x < 8; ++x)
+                  {
+                      CreateSphereMesh(scene, Transform(Vec3(x * 2.5f, 0, -z * 2.5f)), 64, material);
+                  }
+              }
+              return true;
+          } },
+        { "monkey-grid",
+          [](Scene& scene) {
+              auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+              if (!LoadOBJ(scene, "res/background.obj", Transform(Vec3(0, -1, 0), identity, Vec3(10)), material))
+              {
+                  return false;
+              }
+
+              for (int32 z = 0; z < 10; ++z)
+              {
+                  for (int32 x = 0; x < 10; ++x)
+                  {
+                      Quat q(DegToRad(Float(x * 37 + z * 11)), y_axis);
+                      if (!LoadOBJ(scene, "res/monkey.obj", Transform(Vec3(x * 2.5f, 0, -z * 2.5f), q), material))
+                      {
+                          return false;
+                      }
+                  }
+              }
+              return true;
+          } },
+    };
+
+    return scenes;
+}
+
+std::vector<Ray> GeneratePrimaryRays(const AABB& bounds, const Point2i& resolution)
+{
+    Point3 center = bounds.GetCenter();
+    Float radius = Length(bounds.GetExtents()) / 2;
+
+    Point3 look_from = center + Normalize(Vec3(0.3f, 0.6f, 1)) * radius * 1.5f;
+    PerspectiveCamera camera(look_from, center, y_axis, 60, 0, 1, resolution);
+
+    std::vector<Ray> rays(resolution.x * resolution.y);
+    for (int32 y = 0; y < resolution.y; ++y)
+    {
+        for (int32 x = 0; x < resolution.x; ++x)
+        {
+            camera.SampleRay(&rays[x + y * resolution.x], Point2i(x, y), Point2(0.5f), Point2(0.5f));
+        }
+    }
+
+    return rays;
+}
+
+std::vector<Float> GenerateRayTMax(const AABB& bounds, size_t count, uint64 seed)
+{
+    const Float diagonal = Length(bounds.GetExtents());
+
+    RNG rng(seed);
+    std::vector<Float> t_max(count);
+    for (Float& t : t_max)
+    {
+        t = rng.NextFloat() < 0.25f ? infinity : rng.NextFloat() * 2 * diagonal;
+    }
+
+    return t_max;
+}
+
+std::vector<ReferenceHit> TraceReference(
+    const Intersectable* reference, const std::vector<Ray>& rays, const std::vector<Float>& t_max
+)
+{
+    std::vector<ReferenceHit> hits(rays.size());
+    ParallelFor(0, int32(rays.size()), [&](int32 i) {
+        Intersection isect;
+        bool hit = reference->Intersect(&isect, rays[i], Ray::epsilon, t_max[i]);
+        hits[i] = hit ? ReferenceHit{ true, isect.t, isect.primitive } : ReferenceHit{ false, 0, nullptr };
+    });
+
+    return hits;
+}
+
+bool MatchesReference(const ReferenceHit& reference, const Ray& ray, Float t_max, bool hit, const Intersection& isect)
+{
+    if (hit != reference.hit)
+    {
+        return false;
+    }
+
+    if (!hit)
+    {
+        return true;
+    }
+
+    if (isect.t != reference.t)
+    {
+        return false;
+    }
+
+    if (isect.primitive == reference.primitive)
+    {
+        return true;
+    }
+
+    Intersection check;
+    return isect.primitive->Intersect(&check, ray, Ray::epsilon, t_max) && check.t == reference.t;
+}
+
+HitCheck CreateHitCheck(const Intersectable* reference, const std::vector<Ray>& rays, int32 stride, uint64 seed)
+{
+    HitCheck check;
+    for (size_t i = 0; i < rays.size(); i += stride)
+    {
+        check.rays.push_back(rays[i]);
+    }
+
+    check.t_max = GenerateRayTMax(reference->GetAABB(), check.rays.size(), seed);
+    check.reference = TraceReference(reference, check.rays, check.t_max);
+
+    return check;
+}
+
+int32 CountMismatchedHits(const Intersectable* accel, const HitCheck& check)
+{
+    std::atomic<int32> mismatches = 0;
+    ParallelFor(0, int32(check.rays.size()), [&](int32 begin, int32 end) {
+        int32 local_mismatches = 0;
+        for (int32 i = begin; i < end; ++i)
+        {
+            const Ray& ray = check.rays[i];
+            const ReferenceHit& reference = check.reference[i];
+
+            Intersection isect;
+            bool hit = accel->Intersect(&isect, ray, Ray::epsilon, check.t_max[i]);
+            bool hit_any = accel->IntersectAny(ray, Ray::epsilon, check.t_max[i]);
+
+            local_mismatches += !MatchesReference(reference, ray, check.t_max[i], hit, isect) || hit_any != reference.hit;
+        }
+        mismatches += local_mismatches;
+    });
+
+    return mismatches;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "benchmark.h"
+
+// Scenes used by the benchmarks.
+// Procedural scenes are generated with fixed seeds so that results are comparable between runs.
+struct BenchmarkScene
+{
+    std::string name;
+    std::function<bool(Scene&)> create;
+};
+
+const std::vector<BenchmarkScene>& GetBenchmarkScenes();
+
+// Minimal Wavefront OBJ reader for the bundled models (res/*.obj)
+bool LoadOBJ(Scene& scene, const std::string& filename, const Transform& transform, const Material* material);
+
+void CreateRandomTriangles(Scene& scene, int32 count, uint64 seed, const Material* material);
+void CreateSliverTriangles(Scene& scene, int32 count, uint64 seed, const Material* material);
+Mesh* CreateSphereMesh(Scene& scene, const Transform& transform, int32 segments, const Material* material);
+
+// Flat grid of 2 * resolution^2 triangles over [-1, 1] on the xz plane, returns the mesh so that it can be deformed
+Mesh* CreateGridMesh(Scene& scene, int32 resolution, const Material* material);
+
+// Parallelogram with the corners origin, origin + u, origin + v and origin + u + v, facing Cross(u, v)
+Mesh* CreateQuadMesh(Scene& scene, const Point3& origin, const Vec3& u, const Vec3& v, const Material* material);
+
+// Creates an area light for every primitive with the given emissive material
+void CreateAreaLights(Scene& scene, const Material* material);
+
+// Cornell box with a diffuse and a glass sphere, lit by a small area light in the ceiling
+std::unique_ptr<Camera> CreateCornellBox(Scene& scene, const Point2i& resolution);
+
+// Unit sphere mesh in its own space for instancing
+const BVH* CreateSphereBLAS(Scene& scene, int32 segments, const Material* material);
+
+// Builds camera rays covering the scene bounds
+std::vector<Ray> GeneratePrimaryRays(const AABB& bounds, const Point2i& resolution);
+
+// Random maximum ray distances for the correctness checks. Most end somewhere within the scene bounds,
+// so that the queries also stop before the closest hit, the others are unbounded
+std::vector<Float> GenerateRayTMax(const AABB& bounds, size_t count, uint64 seed);
+
+// Closest hit of a ray found by the reference accelerator
+struct ReferenceHit
+{
+    bool hit;
+    Float t;
+    const Primitive* primitive;
+};
+
+// Traces the rays one by one with the closest hit query
+std::vector<ReferenceHit> TraceReference(
+    const Intersectable* reference, const std::vector<Ray>& rays, const std::vector<Float>& t_max
+);
+
+// Whether a closest hit agrees with the reference in the hit, the distance and the primitive.
+// Another primitive is accepted only if it is hit at the same distance, e.g. on an edge shared by two triangles
+bool MatchesReference(const ReferenceHit& reference, const Ray& ray, Float t_max, bool hit, const Intersection& isect);
+
+// Every stride-th ray with a random maximum distance and its closest hit in the reference accelerator
+struct HitCheck
+{
+    std::vector<Ray> rays;
+    std::vector<Float> t_max;
+    std::vector<ReferenceHit> reference;
+};
+
+HitCheck CreateHitCheck(const Intersectable* reference, const std::vector<Ray>& rays, int32 stride, uint64 seed);
+
+// Number of rays whose closest hit or any hit query on accel differs from the reference
+int32 CountMismatchedHits(const Intersectable* accel, const HitCheck& check);
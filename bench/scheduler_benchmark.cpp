@@ -0,0 +1,90 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+// Runs func with a global thread pool of the given size, zero runs everything on the calling thread only
+template <typename F>
+static double MeasureWithThreads(int32 thread_count, F&& func)
+{
+    std::unique_ptr<ThreadPool> thread_pool = std::move(ThreadPool::global_thread_pool);
+    if (thread_count > 0)
+    {
+        ThreadPool::global_thread_pool.reset(new ThreadPool(thread_count));
+    }
+
+    double t = Measure(func, 0.5);
+
+    ThreadPool::global_thread_pool = std::move(thread_pool);
+    return t;
+}
+
+template <typename F>
+static void Report(const std::string& name, F&& func)
+{
+    const int32 max_threads = int32(std::thread::hardware_concurrency());
+
+    std::cout << name << std::endl;
+
+    double serial = MeasureWithThreads(0, func);
+    std::cout << std::format("  {:>3} threads {:9.3f}ms", 1, serial * 1e3) << std::endl;
+
+    for (int32 threads = 2; threads <= max_threads; threads *= 2)
+    {
+        double t = MeasureWithThreads(threads, func);
+        std::cout << std::format("  {:>3} threads {:9.3f}ms  ({:.2f}x)", threads, t * 1e3, serial / t) << std::endl;
+
+        if (threads < max_threads && threads * 2 > max_threads)
+        {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+// Some arithmetic the compiler cannot drop
+static Float Work(int32 i, int32 iterations)
+{
+    Float x = Float(i & 1023);
+    for (int32 j = 0; j < iterations; ++j)
+    {
+        x = std::sqrt(x + Float(j));
+    }
+
+    return x;
+}
+
+// Scheduling overhead and scaling of the thread pool for the loop shapes used by the renderer
+static void SchedulerBenchmark()
+{
+    std::vector<Float> results(1 << 20);
+
+    // Many iterations of a few nanoseconds each, dominated by claiming the chunks
+    Report("flat loop, 1M tiny iterations", [&]() {
+        ParallelFor(0, int32(results.size()), [&](int32 i) { results[i] = Work(i, 4); });
+    });
+
+    // Loops inside loops as in the BVH build, the inner loops are started from the worker threads
+    Report("nested loops, 256 x 4096 iterations", [&]() {
+        ParallelFor(0, 256, [&](int32 i) {
+            ParallelFor(0, 4096, [&](int32 j) { results[i * 4096 + j] = Work(j, 4); });
+        });
+    });
+
+    // Tiles of uneven cost, the bottom of the image is eight times as expensive as the top
+    const Point2i resolution(1024, 1024);
+    Report("tiles, 1024x1024 image in 16px tiles", [&]() {
+        ParallelFor2D(resolution, [&](AABB2i tile) {
+            for (Point2i pixel : tile)
+            {
+                int32 i = pixel.y * resolution.x + pixel.x;
+                results[i] = Work(i, 4 + 28 * pixel.y / resolution.y);
+            }
+        });
+    });
+
+    Scene scene;
+    auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+    CreateRandomTriangles(scene, 1000000, 1234, material);
+
+    Report("BVH build, 1M random triangles", [&]() { BVH bvh(scene.GetPrimitives()); });
+}
+
+static int32 scheduler_benchmark = Benchmark::Register("scheduler", SchedulerBenchmark);
@@ -0,0 +1,108 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(128, 128);
+static const int32 samples_per_pixel = 16;
+static const int32 max_bounces = 8;
+
+static void Report(const std::string& name, Integrator* integrator, const Camera& camera)
+{
+    Timer timer;
+    std::unique_ptr<RenderingProgress> progress = integrator->Render(camera);
+    progress->Wait();
+    timer.Mark();
+
+    const Statistics& stats = progress->GetStatistics();
+
+    int64 rays = stats[Stat::closest_hit_queries] + stats[Stat::any_hit_queries];
+    int64 paths = 0;
+    int64 bounces = 0;
+    for (int32 i = 0; i < stat_histogram_bucket_count; ++i)
+    {
+        paths += stats.histograms[int32(StatHistogram::path_length)][i];
+        bounces += i * stats.histograms[int32(StatHistogram::path_length)][i];
+    }
+
+    std::cout << std::format("  {:24} {:6.3f}s", name, timer.Get()) << std::endl;
+    std::cout << std::format(
+                     "    camera rays {}, closest hit {}, any hit {}, russian roulette {}", stats[Stat::camera_rays],
+                     stats[Stat::closest_hit_queries], stats[Stat::any_hit_queries], stats[Stat::russian_roulette_terminations]
+                 )
+              << std::endl;
+    std::cout << std::format(
+                     "    per ray: {:.2f} nodes, {:.2f} primitive tests, mean path length {:.2f}",
+                     double(stats[Stat::bvh_nodes_visited]) / std::max<int64>(rays, 1),
+                     double(stats[Stat::bvh_primitive_tests]) / std::max<int64>(rays, 1),
+                     double(bounces) / std::max<int64>(paths, 1)
+                 )
+              << std::endl;
+}
+
+// Starts two renders at once, each one must count its own camera rays only
+static void CheckConcurrentRenders(Integrator* integrator, const Camera& camera)
+{
+    std::unique_ptr<RenderingProgress> first = integrator->Render(camera);
+    std::unique_ptr<RenderingProgress> second = integrator->Render(camera);
+    first->Wait();
+    second->Wait();
+
+    const int64 expected = int64(resolution.x) * resolution.y * samples_per_pixel;
+    int64 first_rays = first->GetStatistics()[Stat::camera_rays];
+    int64 second_rays = second->GetStatistics()[Stat::camera_rays];
+
+    std::cout << std::format("  concurrent renders: camera rays {} and {}, expected {} each", first_rays, second_rays, expected)
+              << std::endl;
+
+    if (first_rays != expected || second_rays != expected)
+    {
+        Benchmark::Fail("the statistics of concurrent renders include the work of each other");
+    }
+}
+
+// Renders the Cornell box and reports the statistics of the render for every accelerator.
+// The instanced accelerator places the whole scene as a single instance, its ray count matches the one of the BVH.
+// Build with BULBIT_ENABLE_STATS and without to compare the render times, the counters are zero without it
+static void StatsBenchmark()
+{
+#if defined(BULBIT_ENABLE_STATS)
+    std::cout << "statistics enabled" << std::endl;
+#else
+    std::cout << "statistics disabled, configure with -DBULBIT_ENABLE_STATS=ON to collect them" << std::endl;
+#endif
+
+    Scene scene;
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, resolution);
+    BVH accel(scene.GetPrimitives());
+    WideBVH4 wide4(scene.GetPrimitives());
+    WideBVH8 wide8(scene.GetPrimitives());
+    CompressedBVH compressed(scene.GetPrimitives());
+
+    Instance instance(&accel, identity);
+    BVH tlas({ &instance });
+
+    IndependentSampler sampler(samples_per_pixel);
+
+    std::pair<const char*, const Intersectable*> accels[] = {
+        { "BVH", &accel },
+        { "WideBVH4", &wide4 },
+        { "WideBVH8", &wide8 },
+        { "CompressedBVH", &compressed },
+        { "instanced BVH", &tlas },
+    };
+
+    for (auto [name, intersectable] : accels)
+    {
+        PathIntegrator path(intersectable, scene.GetLights(), &sampler, max_bounces);
+        Report(std::format("path {}", name), &path, *camera);
+    }
+
+    WavefrontPathIntegrator wavefront(&accel, scene.GetLights(), &sampler, max_bounces);
+    Report("wavefront BVH", &wavefront, *camera);
+
+#if defined(BULBIT_ENABLE_STATS)
+    PathIntegrator path(&accel, scene.GetLights(), &sampler, max_bounces);
+    CheckConcurrentRenders(&path, *camera);
+#endif
+}
+
+static int32 stats_benchmark = Benchmark::Register("stats", StatsBenchmark);
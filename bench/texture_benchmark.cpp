@@ -0,0 +1,80 @@
+#include "benchmark.h"
+
+static const int32 lookup_count = 1 << 18;
+static const int32 image_size = 1024;
+
+// Written with the results so that the lookups cannot be optimized away
+static volatile Float sink;
+
+// Lookups per second through the virtual Texture interface, as the materials do. Runs on one thread
+template <typename T>
+static double Lookup(const Texture<T>* texture, const std::vector<Point2>& uvs)
+{
+    T sum(0);
+    double t = MeasureBest([&]() {
+        for (const Point2& uv : uvs)
+        {
+            sum += texture->Evaluate(uv);
+        }
+    });
+
+    if constexpr (std::is_same_v<T, Float>)
+    {
+        sink = sum;
+    }
+    else
+    {
+        sink = sum.Average();
+    }
+
+    return uvs.size() / t;
+}
+
+// Texture lookup throughput of the texture types. The image lookups are made once along scanlines, where neighbouring lookups
+// share cache lines, and once at random coordinates
+static void TextureBenchmark()
+{
+    RNG rng(1234);
+
+    Image1 image1(image_size, image_size);
+    Image3 image3(image_size, image_size);
+    for (int32 i = 0; i < image_size * image_size; ++i)
+    {
+        image1[i] = rng.NextFloat();
+        image3[i] = Spectrum(rng.NextFloat(), rng.NextFloat(), rng.NextFloat());
+    }
+
+    FloatConstantTexture float_constant(0.5f);
+    SpectrumConstantTexture spectrum_constant(Spectrum(0.5f));
+    FloatImageTexture float_image(std::move(image1), TexCoordFilter::repeat);
+    SpectrumImageTexture spectrum_image(std::move(image3), TexCoordFilter::repeat);
+    SpectrumConstantTexture white(Spectrum(1));
+    SpectrumCheckerTexture checker(&white, &spectrum_constant, Point2(16, 16));
+
+    std::vector<Point2> coherent(lookup_count);
+    for (int32 i = 0; i < lookup_count; ++i)
+    {
+        coherent[i] = Point2((i % image_size + 0.5f) / image_size, (i / image_size + 0.5f) / image_size);
+    }
+
+    std::vector<Point2> random(lookup_count);
+    for (Point2& uv : random)
+    {
+        uv = Point2(rng.NextFloat(), rng.NextFloat());
+    }
+
+    auto report = [](const char* name, double lookups_per_sec) {
+        std::cout << std::format("  {:24} {:8.2f} Mlookups/s", name, lookups_per_sec * 1e-6) << std::endl;
+        Benchmark::Record(std::format("{} Mlookups/s", name), lookups_per_sec * 1e-6);
+    };
+
+    report("float constant", Lookup<Float>(&float_constant, random));
+    report("spectrum constant", Lookup<Spectrum>(&spectrum_constant, random));
+    report("spectrum checker", Lookup<Spectrum>(&checker, random));
+    report("float image scanline", Lookup<Float>(&float_image, coherent));
+    report("float image random", Lookup<Float>(&float_image, random));
+    report("spectrum image scanline", Lookup<Spectrum>(&spectrum_image, coherent));
+    report("spectrum image random", Lookup<Spectrum>(&spectrum_image, random));
+}
+
+static int32 texture_benchmark = Benchmark::Register("texture", TextureBenchmark);
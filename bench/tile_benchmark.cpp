@@ -0,0 +1,87 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const Point2i resolution(640, 480);
+static const int32 samples_per_pixel = 4;
+
+static double Render(UniDirectionalRayIntegrator& integrator, const Camera& camera, const TilingOptions& options)
+{
+    integrator.SetTiling(options);
+
+    Timer timer;
+    std::unique_ptr<RenderingProgress> progress = integrator.Render(camera);
+    progress->Wait();
+    timer.Mark();
+
+    return timer.Get();
+}
+
+// Render time of the tile orders, and of splitting the tiles of the last adaptive rounds.
+// Hardware cache counters are not read here, the orders are compared by their effect on the render time
+static void TileBenchmark()
+{
+    const std::pair<const char*, TileOrder> orders[] = {
+        { "scanline", TileOrder::scanline },
+        { "hilbert", TileOrder::hilbert },
+        { "spiral", TileOrder::spiral },
+    };
+
+    for (const BenchmarkScene& bench_scene : GetBenchmarkScenes())
+    {
+        Scene scene;
+        if (!bench_scene.create(scene))
+        {
+            std::cout << bench_scene.name << ": failed to load scene" << std::endl;
+            continue;
+        }
+
+        BVH accel(scene.GetPrimitives());
+
+        // Looks at the scene from the front, far enough to see all of it
+        AABB bounds = accel.GetAABB();
+        Point3 center = bounds.GetCenter();
+        Float distance = Length(bounds.GetExtents()) * 1.2f;
+        PerspectiveCamera camera(center + Vec3(0, 0.3f, 1) * distance, center, y_axis, 45, 0, 1, resolution);
+
+        IndependentSampler sampler(samples_per_pixel);
+        AmbientOcclusion integrator(&accel, scene.GetLights(), &sampler, Length(bounds.GetExtents()) * 0.1f);
+
+        std::cout << std::format(
+                         "{} ({} primitives), {}x{} {} spp ambient occlusion", bench_scene.name, scene.GetPrimitives().size(),
+                         resolution.x, resolution.y, samples_per_pixel
+                     )
+                  << std::endl;
+
+        double scanline = 0;
+        for (auto [name, order] : orders)
+        {
+            double t = Render(integrator, camera, { .order = order });
+            if (order == TileOrder::scanline)
+            {
+                scanline = t;
+            }
+
+            std::cout << std::format("  {:10} {:7.3f}s  ({:.2f}x)", name, t, scanline / t) << std::endl;
+        }
+    }
+
+    // The last rounds of an adaptive render only sample the few tiles around the caustic and the light
+    Scene scene;
+    const Point2i cornell_resolution(128, 128);
+    std::unique_ptr<Camera> camera = CreateCornellBox(scene, cornell_resolution);
+    BVH accel(scene.GetPrimitives());
+
+    IndependentSampler sampler(256);
+    PathIntegrator integrator(&accel, scene.GetLights(), &sampler, 8);
+    integrator.SetAdaptiveSampling({ .max_error = 0.02f });
+
+    std::cout << std::format("cornell box, {}x{} adaptive up to 256 spp", cornell_resolution.x, cornell_resolution.y)
+              << std::endl;
+
+    double whole = Render(integrator, *camera, { .min_size = 0 });
+    double split = Render(integrator, *camera, {});
+    std::cout << std::format("  {:10} {:7.3f}s", "16px tiles", whole) << std::endl;
+    std::cout << std::format("  {:10} {:7.3f}s  ({:.2f}x)", "split", split, whole / split) << std::endl;
+}
+
+static int32 tile_benchmark = Benchmark::Register("tiles", TileBenchmark);
@@ -0,0 +1,66 @@
+#include "benchmark.h"
+#include "scenes.h"
+
+static const int32 sphere_segments = 512;
+
+// Rays from inside a closed mesh aimed at its vertices and edge midpoints, where a non watertight test lets rays through
+static std::vector<Ray> GenerateEdgeRays(const Scene& scene, const Point3& origin)
+{
+    std::vector<Ray> rays;
+    for (const Primitive* primitive : scene.GetPrimitives())
+    {
+        const Triangle* triangle = static_cast<const Triangle*>(primitive->GetShape());
+
+        Point3 p0, p1, p2;
+        triangle->GetVertices(&p0, &p1, &p2);
+
+        for (const Point3& target : { p0, (p0 + p1) / 2, (p1 + p2) / 2, (p2 + p0) / 2 })
+        {
+            rays.emplace_back(origin, target - origin);
+        }
+    }
+
+    return rays;
+}
+
+template <typename Accel>
+static void Run(const char* name, const Scene& scene, const std::vector<Ray>& rays)
+{
+    Accel accel(scene.GetPrimitives());
+
+    std::atomic<int32> leaks(0);
+    double t = Measure([&]() {
+        leaks = 0;
+        ParallelFor(0, int32(rays.size()), [&](int32 begin, int32 end) {
+            int32 misses = 0;
+            for (int32 i = begin; i < end; ++i)
+            {
+                Intersection isect;
+                misses += accel.Intersect(&isect, rays[i], Ray::epsilon, infinity) ? 0 : 1;
+            }
+            leaks += misses;
+        });
+    });
+
+    std::cout << std::format("  {:<9} leaks {:>6} / {}  closest {:8.2f} Mrays/s", name, leaks.load(), rays.size(), rays.size() / t * 1e-6)
+              << std::endl;
+}
+
+// Counts the rays escaping a closed sphere mesh through the shared edges and vertices
+static void WatertightBenchmark()
+{
+    Scene scene;
+    auto material = scene.CreateMaterial<DiffuseMaterial>(scene.CreateTexture<ConstantTexture, Spectrum>(Spectrum(0.5f)));
+    CreateSphereMesh(scene, Transform(Vec3(0), identity, Vec3(3)), sphere_segments, material);
+
+    for (const Point3& origin : { Point3(0), Point3(0.1f, -0.2f, 0.3f) })
+    {
+        std::vector<Ray> rays = GenerateEdgeRays(scene, origin);
+
+        std::cout << std::format("origin ({}, {}, {})", origin.x, origin.y, origin.z) << std::endl;
+        Run<BVH>("BVH", scene, rays);
+        Run<WideBVH8>("WideBVH8", scene, rays);
+    }
+}
+
+static int32 watertight_benchmark = Benchmark::Register("watertight", WatertightBenchmark);
@@ -10,75 +10,52 @@ class AsyncJob : public ParallelJob
 {
 public:
     AsyncJob(std::function<T(void)> f)
-        : func(std::move(f))
+        : ParallelJob(1, 1)
+        , func(std::move(f))
     {
     }
 
-    virtual bool HaveWork() const override
+    virtual ~AsyncJob()
     {
-        return !started;
+        // The job must not be destroyed while it is queued or running
+        Wait();
     }
 
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) override
+    virtual void Run(int32 begin, int32 end) override
     {
-        thread_pool->RemoveJob(this);
-        started = true;
-        lock->unlock();
-
-        T res = func();
-        std::unique_lock<std::mutex> l(mutex);
-        result = res;
-        cv.notify_all();
+        BulbitNotUsed(begin);
+        BulbitNotUsed(end);
+        result = func();
     }
 
     bool IsReady() const
     {
-        std::lock_guard<std::mutex> l(mutex);
-        return result.has_value();
+        return Finished();
     }
 
     T GetResult()
     {
         Wait();
-        std::lock_guard<std::mutex> l(mutex);
         return result.value();
     }
 
     void Wait()
     {
-        while (!IsReady())
-        {
-            if (thread_pool->WorkOrReturn() == false)
-            {
-                // Other thread is running this job
-                break;
-            }
-        }
-
-        std::unique_lock<std::mutex> lock(mutex);
-        while (!result.has_value())
+        if (thread_pool)
         {
-            cv.wait(lock);
+            thread_pool->Wait(this);
         }
     }
 
     void DoWork()
     {
-        T res = func();
-
-        std::unique_lock<std::mutex> lock(mutex);
-        result = res;
-        cv.notify_all();
+        stat_counters = GetCurrentStatCounters();
+        Execute(0, 1);
     }
 
 private:
     std::function<T(void)> func;
     std::optional<T> result;
-
-    mutable std::mutex mutex;
-    std::condition_variable cv;
-
-    bool started = false;
 };
 
 template <typename F, typename... Args>
@@ -88,14 +65,13 @@ inline auto RunAsync(ThreadPool* thread_pool, F func, Args&&... args)
     using R = std::invoke_result_t<F, Args...>;
     auto job = std::make_unique<AsyncJob<R>>(std::move(fvoid));
 
-    std::unique_lock<std::mutex> lock;
     if (!thread_pool)
     {
         job->DoWork();
     }
     else
     {
-        lock = thread_pool->AddJob(job.get());
+        thread_pool->Submit(job.get(), 0, 1);
     }
 
     return job;
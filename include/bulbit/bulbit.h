@@ -12,9 +12,13 @@
 #include "shapes.h"
 
 #include "bvh.h"
+#include "compressed_bvh.h"
 #include "dynamic_bvh.h"
+#include "instance.h"
+#include "wide_bvh.h"
 
 #include "async_job.h"
 #include "parallel_for.h"
 #include "progress.h"
+#include "stats.h"
 #include "timer.h"
@@ -3,20 +3,131 @@
 #include "growable_array.h"
 #include "parallel.h"
 #include "primitive.h"
+#include "stats.h"
+#include "triangle_intersector.h"
 
 namespace bulbit
 {
 
+enum class BVHBuildMethod
+{
+    // Binned SAH over the primitive centroids
+    SAH,
+
+    // SAH with spatial splits and reference duplication (Stich et al. 2009)
+    SBVH,
+
+    // Morton code ordering, much faster to build but with lower quality (Karras 2012)
+    LBVH,
+};
+
+struct BVHBuildOptions
+{
+    BVHBuildMethod method = BVHBuildMethod::SAH;
+
+    // Maximum number of duplicated references relative to the primitive count (SBVH only)
+    Float spatial_split_budget = 0.3f;
+
+    // Restructures the treelets of the tree to their optimal topology (LBVH only, Karras and Aila 2013)
+    bool treelet_optimization = true;
+};
+
+// Per primitive leaf data in the order of the leaves, shared by BVH and the layouts collapsed from it.
+// Triangle vertices are stored inline so that leaf tests skip the primitive, shape and mesh indirections
+struct BVHLeaves
+{
+    enum PrimitiveType : uint8
+    {
+        generic,
+        opaque_triangle,
+        alpha_tested_triangle,
+    };
+
+    struct TriangleVertices
+    {
+        Point3 p[3];
+    };
+
+    // Leaves test runs of up to this many opaque triangles at once
+    static constexpr int32 triangle_batch_size = 4;
+
+    // Classifies the primitives and copies the vertices of the triangles
+    void BuildTriangles();
+
+    // Leaf data of the primitives at the given indices, in that order
+    BVHLeaves Gather(std::span<const int32> indices) const;
+
+    size_t GetMemoryUsage() const;
+
+    bool IntersectTriangle(
+        int32 index, const TriangleIntersector& intersector, Float t_min, Float t_max, Float* out_t, Float* out_u, Float* out_v
+    ) const;
+
+    // Returns the mask of the hit triangles among [index, index + count)
+    uint32 IntersectTriangles(
+        int32 index, int32 count, const TriangleIntersector& intersector, Float t_min, Float t_max, Float* out_t, Float* out_u,
+        Float* out_v
+    ) const;
+
+    struct ClosestHitCallback;
+    struct AnyHitCallback;
+
+    std::vector<Primitive*> primitives;
+    std::vector<PrimitiveType> types;
+    std::vector<TriangleVertices> triangles;
+};
+
 class BVH : public Intersectable
 {
 public:
-    BVH(const std::vector<Primitive*>& primitives);
+    BVH(const std::vector<Primitive*>& primitives, const BVHBuildOptions& options = {});
     ~BVH() noexcept;
 
     virtual AABB GetAABB() const override;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
 
+    virtual void IntersectBatch(
+        std::span<Intersection> out_isects,
+        std::span<bool> out_hits,
+        std::span<const Ray> rays,
+        Float t_min,
+        std::span<const Float> t_max
+    ) const override;
+    virtual void IntersectAnyBatch(std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max)
+        const override;
+
+    int32 GetNodeCount() const;
+    int32 GetPrimitiveCount() const;
+    Float GetSAHCost() const;
+
+    // Bytes held by the nodes and the per primitive leaf data, the primitives themselves are not included
+    size_t GetMemoryUsage() const;
+
+    // Recomputes the node bounds bottom-up after the primitives moved, the topology and the primitive order are kept.
+    // Subtrees whose SAH cost grew more than rebuild_threshold times since they were built are rebuilt from scratch.
+    // Returns the number of rebuilt subtrees
+    int32 Refit(Float rebuild_threshold = infinity);
+
+    // Nodes are stored in the depth first order, the first child of an internal node follows it
+    struct alignas(32) LinearBVHNode
+    {
+        AABB aabb;
+
+        union
+        {
+            int32 primitives_offset;
+            int32 child2_offset;
+        };
+
+        uint16 primitive_count;
+        uint8 axis;
+    };
+
+    // Read by the layouts collapsed from the binary tree
+    const LinearBVHNode* GetNodes() const;
+    const BVHLeaves& GetLeaves() const;
+
 private:
     friend class Scene;
 
@@ -41,19 +152,11 @@ private:
         BuildNode* child2;
     };
 
-    struct alignas(32) LinearBVHNode
-    {
-        AABB aabb;
+    // Spans larger than this are binned and partitioned in parallel
+    static constexpr int32 parallel_build_threshold = 64 * 1024;
 
-        union
-        {
-            int32 primitives_offset;
-            int32 child2_offset;
-        };
-
-        uint16 primitive_count;
-        uint8 axis;
-    };
+    // Cost of a traversal step relative to a primitive intersection
+    static constexpr Float traverse_cost = 0.5f;
 
     BuildNode* BuildRecursive(
         ThreadLocal<Allocator>& thread_allocators,
@@ -63,15 +166,204 @@ private:
         std::vector<Primitive*>& ordered_prims
     );
 
+    struct SpatialSplitBuild;
+
+    BuildNode* BuildSpatial(
+        ThreadLocal<Allocator>& thread_allocators,
+        std::vector<BVHPrimitive>& references,
+        std::atomic<int32>* total_nodes,
+        std::atomic<int32>* ordered_prims_offset,
+        std::vector<Primitive*>& ordered_prims,
+        Float duplication_budget
+    );
+    BuildNode* BuildSpatialRecursive(SpatialSplitBuild& build, std::vector<BVHPrimitive>& references);
+
+    struct LinearBuild;
+
+    // Builds the flat node array directly, without the intermediate build nodes
+    void BuildLinear(bool treelet_optimization);
+
     int32 FlattenBVH(BuildNode* node, int32* offset);
 
+    // Subtrees with up to this many nodes are refitted as independent tasks
+    static constexpr int32 refit_subtree_size = 4 * 1024;
+
+    // Contiguous node range of a subtree in the depth first order
+    struct RefitSubtree
+    {
+        int32 begin, end;
+
+        // SAH cost of the subtree relative to the root of the whole tree when it was built
+        Float cost;
+    };
+
+    int32 GetSubtreeEnd(int32 index) const;
+    Float GetSubtreeCost(int32 begin, int32 end) const;
+
+    void InitRefitSubtrees(int32 index);
+    void RefitNodes(int32 begin, int32 end);
+    void RebuildSubtrees(const std::vector<bool>& rebuild);
+
     template <typename T>
     void RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const;
 
-    std::vector<Primitive*> primitives;
+    static constexpr int32 packet_size = 64;
+    static constexpr int32 incoherent_check_leaves = 16;
+    static constexpr int32 min_rays_per_leaf = 4;
+
+    template <typename T>
+    void RayCastPacket(std::span<const Ray> rays, Float t_min, Float* t_max, T* callbacks) const;
+
+    BVHLeaves leaves;
+
     LinearBVHNode* nodes;
+    int32 node_count;
+
+    BVHBuildOptions options;
+
+    // Internal nodes above the refit subtrees in the depth first order, built on the first refit
+    std::vector<int32> refit_top_nodes;
+    std::vector<RefitSubtree> refit_subtrees;
+};
+
+// Leaf callbacks of the closest hit and any hit queries
+struct BVHLeaves::ClosestHitCallback
+{
+    void Init(const BVHLeaves* _leaves, Intersection* _closest, const Ray& ray, Float t_max)
+    {
+        leaves = _leaves;
+        intersector = TriangleIntersector(ray);
+        closest = _closest;
+        hit_closest = false;
+        t = t_max;
+        closest_triangle = -1;
+    }
+
+    Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, int32 index)
+    {
+        PrimitiveType type = leaves->types[index];
+        if (type != generic)
+        {
+            Float tri_t, tri_u, tri_v;
+            if (!leaves->IntersectTriangle(index, intersector, t_min, t_max, &tri_t, &tri_u, &tri_v))
+            {
+                return t;
+            }
+
+            if (type == opaque_triangle)
+            {
+                BulbitAssert(tri_t <= t);
+                hit_closest = true;
+                t = tri_t;
+                closest_triangle = index;
+                u = tri_u;
+                v = tri_v;
+                return t;
+            }
+        }
+
+        Intersection isect;
+        bool hit = leaves->primitives[index]->Intersect(&isect, ray, t_min, t_max);
+
+        if (hit)
+        {
+            BulbitAssert(isect.t <= t);
+            hit_closest = true;
+            t = isect.t;
+            *closest = isect;
+            closest_triangle = -1;
+        }
+
+        // Keep traverse with smaller bounds
+        return t;
+    }
+
+    // Tests the primitives of a leaf, runs of opaque triangles are tested together
+    Float RayCastLeafCallback(const Ray& ray, Float t_min, Float t_max, int32 offset, int32 count);
+
+    // Resolves the closest opaque triangle hit into a full intersection
+    bool Finish(const Ray& ray);
+
+    const BVHLeaves* leaves;
+    TriangleIntersector intersector;
+
+    Intersection* closest;
+    bool hit_closest;
+    Float t;
+
+    // Opaque triangle hits are resolved after the traversal, only for the closest one
+    int32 closest_triangle;
+    Float u, v;
+};
+
+struct BVHLeaves::AnyHitCallback
+{
+    void Init(const BVHLeaves* _leaves, const Ray& ray)
+    {
+        leaves = _leaves;
+        intersector = TriangleIntersector(ray);
+        hit_any = false;
+    }
+
+    Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, int32 index)
+    {
+        bool hit;
+
+        if (leaves->types[index] == opaque_triangle)
+        {
+            Float t, u, v;
+            hit = leaves->IntersectTriangle(index, intersector, t_min, t_max, &t, &u, &v);
+        }
+        else
+        {
+            hit = leaves->primitives[index]->IntersectAny(ray, t_min, t_max);
+        }
+
+        if (hit)
+        {
+            hit_any = true;
+
+            // Stop traversal
+            return t_min;
+        }
+
+        return t_max;
+    }
+
+    Float RayCastLeafCallback(const Ray& ray, Float t_min, Float t_max, int32 offset, int32 count);
+
+    const BVHLeaves* leaves;
+    TriangleIntersector intersector;
+
+    bool hit_any;
 };
 
+inline int32 BVH::GetNodeCount() const
+{
+    return node_count;
+}
+
+// Number of primitive references, which may include duplicates made by spatial splits
+inline int32 BVH::GetPrimitiveCount() const
+{
+    return int32(leaves.primitives.size());
+}
+
+inline size_t BVH::GetMemoryUsage() const
+{
+    return node_count * sizeof(LinearBVHNode) + leaves.GetMemoryUsage();
+}
+
+inline const BVH::LinearBVHNode* BVH::GetNodes() const
+{
+    return nodes;
+}
+
+inline const BVHLeaves& BVH::GetLeaves() const
+{
+    return leaves;
+}
+
 inline BVH::BVHPrimitive::BVHPrimitive(size_t index, const AABB& aabb)
     : index{ index }
     , aabb{ aabb }
@@ -96,6 +388,20 @@ inline void BVH::BuildNode::InitInternal(int32 _axis, BuildNode* _child1, BuildN
     count = 0;
 }
 
+inline size_t BVHLeaves::GetMemoryUsage() const
+{
+    return primitives.size() * sizeof(Primitive*) + types.size() * sizeof(PrimitiveType) +
+           triangles.size() * sizeof(TriangleVertices);
+}
+
+inline bool BVHLeaves::IntersectTriangle(
+    int32 index, const TriangleIntersector& intersector, Float t_min, Float t_max, Float* out_t, Float* out_u, Float* out_v
+) const
+{
+    const TriangleVertices& tri = triangles[index];
+    return intersector.Intersect(tri.p[0], tri.p[1], tri.p[2], t_min, t_max, out_t, out_u, out_v);
+}
+
 template <typename T>
 inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
 {
@@ -105,27 +411,33 @@ inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
     GrowableArray<int32, 64> stack;
     stack.Emplace(0);
 
+    // Added to the statistics once per ray
+    [[maybe_unused]] int32 nodes_visited = 0;
+    [[maybe_unused]] int32 primitive_tests = 0;
+
     while (stack.Count() > 0)
     {
         int32 index = stack.Pop();
+        ++nodes_visited;
 
         if (nodes[index].aabb.TestRay(r.o, t_min, t_max, inv_dir, is_dir_neg))
         {
             if (nodes[index].primitive_count > 0)
             {
                 // Leaf node
-                for (int32 i = 0; i < nodes[index].primitive_count; ++i)
+                primitive_tests += nodes[index].primitive_count;
+
+                Float t = callback->RayCastLeafCallback(
+                    r, t_min, t_max, nodes[index].primitives_offset, nodes[index].primitive_count
+                );
+                if (t <= t_min)
                 {
-                    Float t = callback->RayCastCallback(r, t_min, t_max, primitives[nodes[index].primitives_offset + i]);
-                    if (t <= t_min)
-                    {
-                        return;
-                    }
-                    else
-                    {
-                        // Shorten the ray
-                        t_max = t;
-                    }
+                    break;
+                }
+                else
+                {
+                    // Shorten the ray
+                    t_max = t;
                 }
             }
             else
@@ -150,6 +462,9 @@ inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
             }
         }
     }
+
+    BulbitStatAdd(Stat::bvh_nodes_visited, nodes_visited);
+    BulbitStatAdd(Stat::bvh_primitive_tests, primitive_tests);
 }
 
 } // namespace bulbit
\ No newline at end of file
@@ -21,7 +21,11 @@ public:
     }
     virtual ~Camera() = default;
 
-    virtual Float SampleRay(Ray* out_ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const = 0;
+    // Samples a ray through the film position, given in pixels. u1 is used for sampling the lens
+    virtual Float GenerateRay(Ray* out_ray, const Point2& film_position, const Point2& u1) const = 0;
+
+    // Samples a ray through the pixel, the position in the pixel is sampled from the pixel filter with u0
+    Float SampleRay(Ray* out_ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const;
 
     const Point2i& GetScreenResolution() const;
     const Medium* GetMedium() const;
@@ -33,6 +37,14 @@ protected:
     const Filter* filter;
 };
 
+inline Float Camera::SampleRay(Ray* out_ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const
+{
+    Point2 pixel_offset = filter->Sample(u0) + Point2(Float(0.5), Float(0.5));
+    Point2 film_position(pixel.x + pixel_offset.x, pixel.y + pixel_offset.y);
+
+    return GenerateRay(out_ray, film_position, u1);
+}
+
 inline const Point2i& Camera::GetScreenResolution() const
 {
     return resolution;
@@ -110,7 +110,7 @@ protected:
     }
 
 public:
-    int8 GetTypeIndex()
+    int8 GetTypeIndex() const
     {
         return type_index;
     }
@@ -1,27 +1,145 @@
 #pragma once
 
+#include "bounding_box.h"
 #include "camera.h"
 #include "image.h"
 #include "spectrum.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace bulbit
 {
 
+class FilmTile;
+class FilmSnapshot;
+
 class Film
 {
 public:
     Film(const Point2i& resolution);
+    Film(const Film& other);
 
     void AddSample(const Point2i& pixel, const Spectrum& L, Float weight);
     Image3 ConvertToImage() const;
 
+    // Adds the samples of another film of the same resolution, e.g. of a different image region or sample range
+    void Merge(const Film& other);
+
+    // Adds the samples of a finished tile that lie inside of it. Tiles do not overlap, so they can be merged from any thread
+    void MergeTile(const FilmTile& tile);
+
+    // Adds the samples a finished tile splatted into its margin. The margins overlap the neighbouring tiles, they are merged
+    // on one thread once no tile is rendered, in a fixed order so that the sums do not depend on the order the tiles finished in
+    void MergeTileMargin(const FilmTile& tile);
+
+    // Sum of the sample weights of the pixel
+    Float GetWeight(const Point2i& pixel) const;
+
+    // Relative standard error of the pixel mean, estimated in luminance from the first and second moments of the samples.
+    // Assumes unit sample weights, the weight sum is the sample count, so it is approximate for splatted samples.
+    // Pixels darker than min_luminance are compared to it, so that nearly black pixels do not take the whole sample budget
+    Float EstimateRelativeError(const Point2i& pixel, Float min_luminance = Float(0.01)) const;
+
+    // Raw copy of the accumulation buffers for render checkpoints.
+    // Read() fails if the stream ends early or was written by a film of another resolution
+    void Write(std::ostream& out) const;
+    bool Read(std::istream& in);
+
     const Point2i resolution;
 
 private:
+    friend class FilmSnapshot;
+
+    void CopyRow(const Film& other, int32 y);
+
     std::unique_ptr<Spectrum[]> samples;
     std::unique_ptr<Float[]> weights;
+
+    // Sum of the squared sample luminances
+    std::unique_ptr<Float[]> squared_luminances;
+};
+
+// Accumulation buffers of one tile of the film, including the margin its samples splat into.
+// A tile is owned by a single thread, so the samples are added without synchronization and stay in cache
+class FilmTile
+{
+public:
+    // Tile of the film, with the margin of the filter radius if the samples are splatted
+    FilmTile(const AABB2i& tile, const Point2i& resolution, const Filter* filter = nullptr);
+
+    void AddSample(const Point2i& pixel, const Spectrum& L, Float weight);
+
+    // Adds the sample to every pixel whose center is within the filter radius of the film position,
+    // weighted by the filter
+    void AddSplat(const Point2& film_position, const Spectrum& L);
+
+    // True if the samples may reach pixels outside of the tile
+    bool HasMargin() const;
+
+    // Pixels of the tile, without the margin
+    const AABB2i interior;
+
+    // Pixels the tile covers, including the margin
+    const AABB2i bounds;
+
+private:
+    friend class Film;
+
+    static AABB2i ExpandTile(const AABB2i& tile, const Point2i& resolution, const Filter* filter);
+
+    const Filter* filter;
+
+    std::vector<Spectrum> samples;
+    std::vector<Float> weights;
+    std::vector<Float> squared_luminances;
 };
 
+// Copy of a film at a point in time, e.g. at the end of a pass of a progressive render, while the film is written on.
+// Update() only marks the rows, a row is copied the first time it is written afterwards or when the copy is read.
+// Writers call PrepareWrite() for the rows they are about to write, so that no thread stops to copy the whole film
+class FilmSnapshot
+{
+public:
+    FilmSnapshot(const Film& film);
+
+    // Takes the current state of the film, tagged with a value of the caller, e.g. a sample count.
+    // Nothing may write to the film meanwhile
+    void Update(int32 tag = 0);
+
+    // Saves the rows [y_begin, y_end) before they are written to, can be called from any thread
+    void PrepareWrite(int32 y_begin, int32 y_end);
+
+    // The film as of the last Update(), black before the first. tag receives the tag of the update, if not null
+    Film Get(int32* tag = nullptr) const;
+
+private:
+    enum RowState : uint8
+    {
+        row_copied,
+        row_pending,
+        row_copying,
+    };
+
+    void SaveRow(int32 y) const;
+
+    const Film& film;
+
+    // Rows not copied yet are still unchanged in the film
+    std::unique_ptr<Film> copy;
+    std::unique_ptr<std::atomic<uint8>[]> row_states;
+
+    int32 tag;
+
+    // Keeps Update() from marking the rows while Get() reads them
+    mutable std::mutex mutex;
+};
+
+// Film files hold the raw accumulation buffers of a render, to be merged with the films of other render processes.
+// ReadFilm() returns null if the file cannot be read
+bool WriteFilm(const Film& film, const std::filesystem::path& filename);
+std::unique_ptr<Film> ReadFilm(const std::filesystem::path& filename);
+
 inline Film::Film(const Point2i& resolution)
     : resolution{ resolution }
 {
@@ -30,18 +148,90 @@ inline Film::Film(const Point2i& resolution)
 
     samples = std::make_unique<Spectrum[]>(width * height);
     weights = std::make_unique<Float[]>(width * height);
+    squared_luminances = std::make_unique<Float[]>(width * height);
 
     for (int32 i = 0; i < width * height; ++i)
     {
         samples[i] = Spectrum::black;
         weights[i] = 0.0f;
+        squared_luminances[i] = 0.0f;
     }
 }
 
+inline Film::Film(const Film& other)
+    : Film(other.resolution)
+{
+    int32 count = resolution.x * resolution.y;
+
+    std::copy(other.samples.get(), other.samples.get() + count, samples.get());
+    std::copy(other.weights.get(), other.weights.get() + count, weights.get());
+    std::copy(other.squared_luminances.get(), other.squared_luminances.get() + count, squared_luminances.get());
+}
+
+inline void Film::CopyRow(const Film& other, int32 y)
+{
+    BulbitAssert(other.resolution == resolution);
+
+    int32 begin = y * resolution.x;
+    int32 end = begin + resolution.x;
+
+    std::copy(other.samples.get() + begin, other.samples.get() + end, samples.get() + begin);
+    std::copy(other.weights.get() + begin, other.weights.get() + end, weights.get() + begin);
+    std::copy(other.squared_luminances.get() + begin, other.squared_luminances.get() + end, squared_luminances.get() + begin);
+}
+
 inline void Film::AddSample(const Point2i& pixel, const Spectrum& L, Float w)
 {
     samples[pixel.x + pixel.y * resolution.x] += L;
     weights[pixel.x + pixel.y * resolution.x] += w;
+    squared_luminances[pixel.x + pixel.y * resolution.x] += Sqr(L.Luminance());
+}
+
+inline void Film::Merge(const Film& other)
+{
+    BulbitAssert(other.resolution == resolution);
+
+    for (int32 i = 0; i < resolution.x * resolution.y; ++i)
+    {
+        samples[i] += other.samples[i];
+        weights[i] += other.weights[i];
+        squared_luminances[i] += other.squared_luminances[i];
+    }
+}
+
+inline void Film::MergeTile(const FilmTile& tile)
+{
+    int32 width = tile.bounds.max.x - tile.bounds.min.x;
+    for (Point2i pixel : tile.interior)
+    {
+        int32 i = pixel.x + pixel.y * resolution.x;
+        int32 j = (pixel.x - tile.bounds.min.x) + (pixel.y - tile.bounds.min.y) * width;
+
+        samples[i] += tile.samples[j];
+        weights[i] += tile.weights[j];
+        squared_luminances[i] += tile.squared_luminances[j];
+    }
+}
+
+inline void Film::MergeTileMargin(const FilmTile& tile)
+{
+    int32 width = tile.bounds.max.x - tile.bounds.min.x;
+    for (Point2i pixel : tile.bounds)
+    {
+        // Pixels of the tile itself are merged by MergeTile()
+        if (pixel.x >= tile.interior.min.x && pixel.x < tile.interior.max.x && pixel.y >= tile.interior.min.y &&
+            pixel.y < tile.interior.max.y)
+        {
+            continue;
+        }
+
+        int32 i = pixel.x + pixel.y * resolution.x;
+        int32 j = (pixel.x - tile.bounds.min.x) + (pixel.y - tile.bounds.min.y) * width;
+
+        samples[i] += tile.samples[j];
+        weights[i] += tile.weights[j];
+        squared_luminances[i] += tile.squared_luminances[j];
+    }
 }
 
 inline Image3 Film::ConvertToImage() const
@@ -52,11 +242,219 @@ inline Image3 Film::ConvertToImage() const
 
     for (int32 i = 0; i < width * height; ++i)
     {
-        Spectrum s = samples[i] / weights[i];
+        // Black for the pixels without samples, e.g. outside of a render region
+        Spectrum s = weights[i] != 0 ? samples[i] / weights[i] : Spectrum::black;
         image[i] = Vec3(s.r, s.g, s.b);
     }
 
     return image;
 }
 
+inline Float Film::GetWeight(const Point2i& pixel) const
+{
+    return weights[pixel.x + pixel.y * resolution.x];
+}
+
+inline Float Film::EstimateRelativeError(const Point2i& pixel, Float min_luminance) const
+{
+    int32 i = pixel.x + pixel.y * resolution.x;
+
+    Float n = weights[i];
+    if (n < 2)
+    {
+        return infinity;
+    }
+
+    Float mean = samples[i].Luminance() / n;
+    Float variance = std::max<Float>(0, squared_luminances[i] / n - Sqr(mean)) * n / (n - 1);
+
+    return std::sqrt(variance / n) / std::max(mean, min_luminance);
+}
+
+inline void Film::Write(std::ostream& out) const
+{
+    int32 count = resolution.x * resolution.y;
+
+    out.write(reinterpret_cast<const char*>(&resolution), sizeof(Point2i));
+    out.write(reinterpret_cast<const char*>(samples.get()), sizeof(Spectrum) * count);
+    out.write(reinterpret_cast<const char*>(weights.get()), sizeof(Float) * count);
+    out.write(reinterpret_cast<const char*>(squared_luminances.get()), sizeof(Float) * count);
+}
+
+inline bool Film::Read(std::istream& in)
+{
+    int32 count = resolution.x * resolution.y;
+
+    Point2i stored_resolution;
+    in.read(reinterpret_cast<char*>(&stored_resolution), sizeof(Point2i));
+    if (!in || stored_resolution != resolution)
+    {
+        return false;
+    }
+
+    in.read(reinterpret_cast<char*>(samples.get()), sizeof(Spectrum) * count);
+    in.read(reinterpret_cast<char*>(weights.get()), sizeof(Float) * count);
+    in.read(reinterpret_cast<char*>(squared_luminances.get()), sizeof(Float) * count);
+
+    return bool(in);
+}
+
+inline FilmSnapshot::FilmSnapshot(const Film& film)
+    : film{ film }
+    , tag{ 0 }
+{
+}
+
+inline void FilmSnapshot::Update(int32 new_tag)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!copy)
+    {
+        copy = std::make_unique<Film>(film.resolution);
+        row_states = std::make_unique<std::atomic<uint8>[]>(film.resolution.y);
+    }
+
+    // The rows copied since the last update were written after, the others still hold the last state
+    for (int32 y = 0; y < film.resolution.y; ++y)
+    {
+        row_states[y].store(row_pending, std::memory_order_relaxed);
+    }
+
+    tag = new_tag;
+}
+
+inline void FilmSnapshot::SaveRow(int32 y) const
+{
+    std::atomic<uint8>& state = row_states[y];
+
+    uint8 expected = row_pending;
+    if (state.load(std::memory_order_acquire) == row_pending &&
+        state.compare_exchange_strong(expected, row_copying, std::memory_order_acquire))
+    {
+        copy->CopyRow(film, y);
+        state.store(row_copied, std::memory_order_release);
+        return;
+    }
+
+    // Another thread is copying the row
+    while (state.load(std::memory_order_acquire) != row_copied)
+    {
+        std::this_thread::yield();
+    }
+}
+
+inline void FilmSnapshot::PrepareWrite(int32 y_begin, int32 y_end)
+{
+    // Nothing to keep before the first update
+    if (!row_states)
+    {
+        return;
+    }
+
+    for (int32 y = y_begin; y < y_end; ++y)
+    {
+        SaveRow(y);
+    }
+}
+
+inline Film FilmSnapshot::Get(int32* out_tag) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (out_tag)
+    {
+        *out_tag = tag;
+    }
+
+    if (!copy)
+    {
+        return Film(film.resolution);
+    }
+
+    for (int32 y = 0; y < film.resolution.y; ++y)
+    {
+        SaveRow(y);
+    }
+
+    return Film(*copy);
+}
+
+inline AABB2i FilmTile::ExpandTile(const AABB2i& tile, const Point2i& resolution, const Filter* filter)
+{
+    if (!filter)
+    {
+        return tile;
+    }
+
+    // Samples lie inside the tile, the centers of the pixels they reach are less than radius + 1/2 away from its border
+    int32 margin = int32(std::ceil(filter->GetRadius() + Float(0.5)));
+
+    Point2i min(std::max(tile.min.x - margin, 0), std::max(tile.min.y - margin, 0));
+    Point2i max(std::min(tile.max.x + margin, resolution.x), std::min(tile.max.y + margin, resolution.y));
+
+    return AABB2i(min, max);
+}
+
+inline FilmTile::FilmTile(const AABB2i& tile, const Point2i& resolution, const Filter* filter)
+    : interior{ tile }
+    , bounds{ ExpandTile(tile, resolution, filter) }
+    , filter{ filter }
+{
+    Point2i extents = bounds.GetExtents();
+    int32 count = extents.x * extents.y;
+
+    samples.resize(count, Spectrum::black);
+    weights.resize(count, 0);
+    squared_luminances.resize(count, 0);
+}
+
+inline void FilmTile::AddSample(const Point2i& pixel, const Spectrum& L, Float w)
+{
+    int32 i = (pixel.x - bounds.min.x) + (pixel.y - bounds.min.y) * (bounds.max.x - bounds.min.x);
+
+    samples[i] += L;
+    weights[i] += w;
+    squared_luminances[i] += Sqr(L.Luminance());
+}
+
+inline bool FilmTile::HasMargin() const
+{
+    return bounds.min != interior.min || bounds.max != interior.max;
+}
+
+inline void FilmTile::AddSplat(const Point2& film_position, const Spectrum& L)
+{
+    BulbitAssert(filter != nullptr);
+
+    Float radius = filter->GetRadius();
+    Float luminance = L.Luminance();
+
+    // Pixels with centers in [film_position - radius, film_position + radius]
+    int32 x0 = std::max(int32(std::ceil(film_position.x - radius - Float(0.5))), bounds.min.x);
+    int32 x1 = std::min(int32(std::floor(film_position.x + radius - Float(0.5))) + 1, bounds.max.x);
+    int32 y0 = std::max(int32(std::ceil(film_position.y - radius - Float(0.5))), bounds.min.y);
+    int32 y1 = std::min(int32(std::floor(film_position.y + radius - Float(0.5))) + 1, bounds.max.y);
+
+    int32 width = bounds.max.x - bounds.min.x;
+    for (int32 y = y0; y < y1; ++y)
+    {
+        for (int32 x = x0; x < x1; ++x)
+        {
+            Point2 offset(x + Float(0.5) - film_position.x, y + Float(0.5) - film_position.y);
+
+            Float w = filter->Evaluate(offset);
+            if (w == 0)
+            {
+                continue;
+            }
+
+            int32 i = (x - bounds.min.x) + (y - bounds.min.y) * width;
+            samples[i] += w * L;
+            weights[i] += w;
+            squared_luminances[i] += w * Sqr(luminance);
+        }
+    }
+}
+
 } // namespace bulbit
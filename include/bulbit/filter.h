@@ -12,7 +12,14 @@ public:
     Filter() = default;
     virtual ~Filter() = default;
 
+    // Offset from the pixel center distributed like the filter, used by the camera to importance sample the filter
     virtual Point2 Sample(const Point2& u) const = 0;
+
+    // Unnormalized filter value at the offset from the pixel center, used for splatting samples onto the film
+    virtual Float Evaluate(const Point2& p) const = 0;
+
+    // Half width of the square the filter is nonzero in
+    virtual Float GetRadius() const = 0;
 };
 
 } // namespace bulbit
@@ -19,6 +19,17 @@ public:
         return (2 * u - 1) * (extent / 2);
     }
 
+    virtual Float Evaluate(const Point2& p) const override
+    {
+        Float h = extent / 2;
+        return (std::abs(p.x) <= h && std::abs(p.y) <= h) ? 1 : 0;
+    }
+
+    virtual Float GetRadius() const override
+    {
+        return extent / 2;
+    }
+
 private:
     Float extent;
 };
@@ -41,6 +52,17 @@ public:
         return Point2(x, y);
     }
 
+    virtual Float Evaluate(const Point2& p) const override
+    {
+        Float h = extent / 2;
+        return std::max<Float>(0, h - std::abs(p.x)) * std::max<Float>(0, h - std::abs(p.y));
+    }
+
+    virtual Float GetRadius() const override
+    {
+        return extent / 2;
+    }
+
 private:
     Float extent;
 };
@@ -62,8 +84,84 @@ public:
         return Point2{ r * std::cos(theta), r * std::sin(theta) };
     }
 
+    // Truncated at three sigma and shifted down to reach zero there
+    virtual Float Evaluate(const Point2& p) const override
+    {
+        Float radius = GetRadius();
+        if (std::abs(p.x) >= radius || std::abs(p.y) >= radius)
+        {
+            return 0;
+        }
+
+        Float edge = std::exp(-Sqr(radius) / (2 * Sqr(sigma)));
+        Float gx = std::exp(-Sqr(p.x) / (2 * Sqr(sigma))) - edge;
+        Float gy = std::exp(-Sqr(p.y) / (2 * Sqr(sigma))) - edge;
+
+        return gx * gy;
+    }
+
+    virtual Float GetRadius() const override
+    {
+        return 3 * sigma;
+    }
+
 private:
     Float sigma;
 };
 
+// Mitchell-Netravali cubic, B = C = 1/3 by default. Sharper than the gaussian, with small negative lobes.
+// The lobes cannot be importance sampled, Sample() draws from a tent of the same radius, so the filter
+// only has its full effect when splatting
+class MitchellFilter : public Filter
+{
+public:
+    MitchellFilter(Float radius = 2, Float b = Float(1) / 3, Float c = Float(1) / 3)
+        : radius{ radius }
+        , b{ b }
+        , c{ c }
+    {
+    }
+
+    virtual Point2 Sample(const Point2& u) const override
+    {
+        Float x = u[0] < Float(0.5) ? radius * (sqrt(2 * u[0]) - 1) : radius * (1 - sqrt(1 - 2 * (u[0] - Float(0.5))));
+        Float y = u[1] < Float(0.5) ? radius * (sqrt(2 * u[1]) - 1) : radius * (1 - sqrt(1 - 2 * (u[1] - Float(0.5))));
+
+        return Point2(x, y);
+    }
+
+    virtual Float Evaluate(const Point2& p) const override
+    {
+        return Mitchell1D(2 * p.x / radius) * Mitchell1D(2 * p.y / radius);
+    }
+
+    virtual Float GetRadius() const override
+    {
+        return radius;
+    }
+
+private:
+    // Cubic over [-2, 2]
+    Float Mitchell1D(Float x) const
+    {
+        x = std::abs(x);
+        if (x >= 2)
+        {
+            return 0;
+        }
+
+        if (x > 1)
+        {
+            return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6;
+        }
+        else
+        {
+            return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6;
+        }
+    }
+
+    Float radius;
+    Float b, c;
+};
+
 } // namespace bulbit
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "primitive.h"
+#include "transform.h"
+
+namespace bulbit
+{
+
+// Places a shared bottom level acceleration structure into the world with its own transform.
+// Rays are transformed into the object space of the instance during traversal, so the geometry and
+// its BVH are stored once no matter how many times it is instanced.
+// Instances are primitives themselves, so a BVH built over them forms the top level of a two level hierarchy.
+// The intersection refers to the primitive inside the BLAS, instanced geometry is not sampled as an area light.
+class Instance : public Primitive
+{
+public:
+    Instance(const Intersectable* blas, const Transform& transform);
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    const Intersectable* GetBLAS() const;
+    const Transform& GetTransform() const;
+
+private:
+    // The direction is not normalized so that the ray parameter is the same in both spaces
+    Ray ToObject(const Ray& ray) const;
+
+    const Intersectable* blas;
+    Transform transform;
+    AABB aabb;
+};
+
+inline const Intersectable* Instance::GetBLAS() const
+{
+    return blas;
+}
+
+inline const Transform& Instance::GetTransform() const
+{
+    return transform;
+}
+
+inline Ray Instance::ToObject(const Ray& ray) const
+{
+    return Ray(transform.q.RotateInv(ray.o - transform.p) / transform.s, transform.q.RotateInv(ray.d) / transform.s);
+}
+
+} // namespace bulbit
@@ -2,6 +2,7 @@
 
 #include "camera.h"
 #include "film.h"
+#include "parallel_for.h"
 #include "sampler.h"
 #include "scene.h"
 
@@ -34,10 +35,96 @@ protected:
         return accel->IntersectAny(ray, t_min, t_max);
     }
 
+    // Submit the primary or shadow rays of a tile at once
+    void IntersectBatch(
+        std::span<Intersection> out_isects,
+        std::span<bool> out_hits,
+        std::span<const Ray> rays,
+        Float t_min,
+        std::span<const Float> t_max
+    ) const
+    {
+        accel->IntersectBatch(out_isects, out_hits, rays, t_min, t_max);
+    }
+
+    void IntersectAnyBatch(std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max) const
+    {
+        accel->IntersectAnyBatch(out_hits, rays, t_min, t_max);
+    }
+
     const Intersectable* accel;
     std::vector<Light*> all_lights;
 };
 
+// Takes the samples of the pixels in rounds and stops sampling a pixel once its estimated error is low enough.
+// A tile is retired when all of its pixels converged. The samples per pixel of the sampler are the budget of the pixels that
+// never converge
+struct AdaptiveSamplingOptions
+{
+    // Relative standard error below which a pixel is converged, see Film::EstimateRelativeError().
+    // Zero disables adaptive sampling
+    Float max_error = 0;
+
+    // Samples per pixel of the first round, taken by every pixel. Too few let the error estimate miss rare bright paths
+    int32 min_samples = 64;
+
+    // Samples per pixel added by every following round
+    int32 round_samples = 16;
+};
+
+// Sweeps the whole image in passes of a few samples per pixel, so that a usable image exists after the first pass.
+// RenderingProgress::GetSnapshot() returns the film as of the last finished pass
+struct ProgressiveRenderingOptions
+{
+    // Samples per pixel of every pass, zero renders each tile with all of its samples at once, or in passes of 4 samples
+    // with a time budget or checkpoints
+    int32 pass_samples = 0;
+
+    // Wall-clock budget of the render in seconds, no tile is started after it ran out. Zero is unlimited.
+    // The first pass is always finished, so the render may take longer than a budget shorter than one pass
+    double time_budget = 0;
+};
+
+// Renders a part of the image or of the samples, for distributing a frame over several processes.
+// The films of all parts summed with Film::Merge() make up the full render
+struct RenderPartitionOptions
+{
+    // Pixels to render, an empty region renders the whole image
+    AABB2i region = AABB2i(Point2i(0, 0), Point2i(0, 0));
+
+    // Sample indices [sample_begin, sample_end) to take of every pixel, zero sample_end means up to the sampler spp
+    int32 sample_begin = 0;
+    int32 sample_end = 0;
+};
+
+// Saves the film at pass boundaries, so that a killed render can be resumed. Without a pass size of progressive rendering or
+// adaptive sampling, the render is split into passes of 4 samples per pixel.
+// Render() continues from the checkpoint file if it exists and was written with the same sampling options, the resumed image
+// is bit-identical to an uninterrupted render, with or without a reconstruction filter.
+// The file is written on a separate thread and once more when the render ends
+struct CheckpointOptions
+{
+    // Empty disables checkpointing
+    std::filesystem::path filename;
+
+    // Seconds between checkpoints
+    double interval = 600;
+};
+
+// How the image is split into tiles, a tile being the pixels a thread renders at a time
+struct TilingOptions
+{
+    // Order the tiles are handed out to the threads in
+    TileOrder order = TileOrder::hilbert;
+
+    // Edge length of the tiles in pixels
+    int32 size = 16;
+
+    // While there are fewer than a few tiles per thread, the tiles are quartered down to this size. It keeps all threads busy
+    // on small images and in the late rounds of an adaptive render, when only a few tiles are left. Zero disables the splitting
+    int32 min_size = 4;
+};
+
 class UniDirectionalRayIntegrator : public Integrator
 {
 public:
@@ -48,8 +135,38 @@ public:
 
     virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const = 0;
 
+    void SetAdaptiveSampling(const AdaptiveSamplingOptions& options);
+    void SetProgressiveRendering(const ProgressiveRenderingOptions& options);
+    void SetCheckpointing(const CheckpointOptions& options);
+    void SetRenderPartition(const RenderPartitionOptions& options);
+    void SetTiling(const TilingOptions& options);
+
+    // Splats every sample onto the pixels in the filter footprint, instead of sampling the ray position in the pixel from the
+    // camera filter. Enables filters with negative lobes and wider than a pixel. Null restores the camera filter
+    void SetReconstructionFilter(const Filter* filter);
+
 private:
+    // Takes the samples [sample_begin, sample_end) of every pixel in the tile that is not marked in converged_pixels.
+    // The samples are accumulated in a tile of the film, which is merged into the film by the caller
+    std::unique_ptr<FilmTile> RenderTile(
+        const Camera& camera,
+        Sampler& sampler,
+        const AABB2i& tile,
+        int32 sample_begin,
+        int32 sample_end,
+        const uint8* converged_pixels
+    ) const;
+
+    // Marks the pixels of the tile that reached the error target, returns true if all of them did
+    bool UpdateConvergence(const Film& film, const AABB2i& tile, uint8* converged_pixels) const;
+
     const Sampler* sampler_prototype;
+    AdaptiveSamplingOptions adaptive_sampling;
+    ProgressiveRenderingOptions progressive_rendering;
+    CheckpointOptions checkpoint;
+    RenderPartitionOptions partition;
+    TilingOptions tiling;
+    const Filter* reconstruction_filter = nullptr;
 };
 
 } // namespace bulbit
@@ -95,13 +95,69 @@ public:
 
     virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
 
+    // How the light of the direct lighting is chosen, LightSamplerType::uniform by default
+    void SetLightSampler(LightSamplerType type);
+
+    // Number of light samples drawn for each direct lighting estimate. With more than one, a single sample is resampled
+    // in proportion to its unshadowed contribution and only its shadow ray is traced (resampled importance sampling).
+    // 1 by default
+    void SetLightCandidates(int32 candidates);
+
 private:
     Spectrum SampleDirectLight(const Vec3& wo, const Intersection& isect, BSDF* bsdf, Sampler& sampler, const Spectrum& beta)
         const;
+    Spectrum ResampleDirectLight(const Vec3& wo, const Intersection& isect, BSDF* bsdf, Sampler& sampler, const Spectrum& beta)
+        const;
 
     std::vector<Light*> infinite_lights;
     std::unordered_map<const Primitive*, AreaLight*> area_lights;
-    UniformLightSampler light_sampler;
+    std::unique_ptr<LightSampler> light_sampler;
+    int32 light_candidates;
+
+    int32 max_bounces;
+    bool regularize_bsdf;
+};
+
+// Uni-directional path tracer that advances many paths at once, one bounce per pass.
+// Each pass runs the stages over queues of paths: closest hit, shading sorted by material type and shadow rays,
+// so that the rays are traced in batches and the paths hitting the same material are shaded together.
+// Produces the same image as PathIntegrator with the same sampler.
+class WavefrontPathIntegrator : public Integrator
+{
+public:
+    WavefrontPathIntegrator(
+        const Intersectable* accel,
+        std::vector<Light*> lights,
+        const Sampler* sampler,
+        int32 max_bounces,
+        bool regularize_bsdf = false
+    );
+    virtual ~WavefrontPathIntegrator() = default;
+
+    virtual std::unique_ptr<RenderingProgress> Render(const Camera& camera) override;
+
+    // How the light of the direct lighting is chosen, LightSamplerType::uniform by default
+    void SetLightSampler(LightSamplerType type);
+
+private:
+    struct Wavefront;
+
+    // Paths in flight at once, bounds the memory of the path states
+    static constexpr int32 max_wavefront_size = 64 * 1024;
+
+    void GenerateCameraRays(Wavefront& wf, const Camera& camera) const;
+    void TraceClosestRays(Wavefront& wf) const;
+    void HandleEscapedRays(Wavefront& wf) const;
+    void SortByMaterial(Wavefront& wf) const;
+    void ShadeHits(Wavefront& wf) const;
+    void TraceShadowRays(Wavefront& wf) const;
+    void AccumulateSamples(Wavefront& wf, Film& film) const;
+
+    const Sampler* sampler_prototype;
+
+    std::vector<Light*> infinite_lights;
+    std::unordered_map<const Primitive*, AreaLight*> area_lights;
+    std::unique_ptr<LightSampler> light_sampler;
 
     int32 max_bounces;
     bool regularize_bsdf;
@@ -135,6 +191,9 @@ public:
 
     virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
 
+    // How the light of the direct lighting is chosen, LightSamplerType::uniform by default
+    void SetLightSampler(LightSamplerType type);
+
 private:
     Spectrum SampleDirectLight(
         const Vec3& wo,
@@ -150,7 +209,7 @@ private:
 
     std::vector<Light*> infinite_lights;
     std::unordered_map<const Primitive*, AreaLight*> area_lights;
-    UniformLightSampler light_sampler;
+    std::unique_ptr<LightSampler> light_sampler;
 
     int32 max_bounces;
     bool regularize_bsdf;
@@ -42,6 +42,42 @@ public:
     virtual AABB GetAABB() const = 0;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const = 0;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const = 0;
+
+    // Batched queries for a group of rays, e.g. the primary or shadow rays of a tile
+    // Each ray is tested within [t_min, t_max[i]]
+    virtual void IntersectBatch(
+        std::span<Intersection> out_isects,
+        std::span<bool> out_hits,
+        std::span<const Ray> rays,
+        Float t_min,
+        std::span<const Float> t_max
+    ) const;
+    virtual void IntersectAnyBatch(std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max)
+        const;
 };
 
+inline void Intersectable::IntersectBatch(
+    std::span<Intersection> out_isects, std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+) const
+{
+    BulbitAssert(out_isects.size() == rays.size() && out_hits.size() == rays.size() && t_max.size() == rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        out_hits[i] = Intersect(&out_isects[i], rays[i], t_min, t_max[i]);
+    }
+}
+
+inline void Intersectable::IntersectAnyBatch(
+    std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+) const
+{
+    BulbitAssert(out_hits.size() == rays.size() && t_max.size() == rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        out_hits[i] = IntersectAny(rays[i], t_min, t_max[i]);
+    }
+}
+
 } // namespace bulbit
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bounding_box.h"
 #include "dynamic_dispatcher.h"
 #include "ray.h"
 #include "spectrum.h"
@@ -27,6 +28,23 @@ struct LightSample
     Spectrum Li;
 };
 
+// Spatial and directional extent of the emission of a light, the bounds of the light hierarchy of BVHLightSampler.
+// The light emits from inside aabb, into the directions within theta_o of w plus at most theta_e beyond them
+struct LightBounds
+{
+    AABB aabb;
+    Vec3 w;
+    Float phi; // emitted power
+    Float cos_theta_o;
+    Float cos_theta_e;
+    bool two_sided;
+
+    // Conservative estimate of the contribution of the light to the point p with normal n, n is zero in a medium
+    Float Importance(const Point3& p, const Vec3& n) const;
+
+    static LightBounds Union(const LightBounds& lb1, const LightBounds& lb2);
+};
+
 using Lights =
     TypePack<class PointLight, class DirectionalLight, class AreaLight, class UniformInfiniteLight, class ImageInfiniteLight>;
 
@@ -43,6 +61,12 @@ public:
     Float EvaluatePDF(const Ray& ray) const;
     Spectrum Le(const Ray& ray) const;
 
+    // Total emitted power. The lights at infinity count what passes through a disk with the radius of the world
+    Spectrum Phi(Float world_radius) const;
+
+    // Returns false for the lights at infinity and the lights whose power is not known
+    bool GetBounds(LightBounds* bounds) const;
+
     bool IsDeltaLight() const;
 };
 
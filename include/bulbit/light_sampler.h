@@ -22,8 +22,11 @@ public:
 
     virtual ~LightSampler() = default;
 
+    // Picks a light for the direct lighting at isect, weight is the inverse of its probability
     virtual bool Sample(SampledLight* sampled_light, const Intersection& isect, Float u) const = 0;
-    virtual Float EvaluatePMF(const Light* light) const = 0;
+
+    // Probability that Sample() picks the light at the reference point, for the MIS of the BSDF samples hitting a light
+    virtual Float EvaluatePMF(const Intersection& ref, const Light* light) const = 0;
 
 protected:
     std::span<Light*> lights;
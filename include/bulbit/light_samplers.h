@@ -1,10 +1,25 @@
 #pragma once
 
 #include "light_sampler.h"
+#include "sampling.h"
+
+#include <unordered_map>
 
 namespace bulbit
 {
 
+enum class LightSamplerType
+{
+    // Every light with the same probability
+    uniform,
+
+    // Proportional to the power of the lights, see PowerLightSampler
+    power,
+
+    // Importance by the power and orientation of the lights near the reference point, see BVHLightSampler
+    bvh,
+};
+
 class UniformLightSampler : public LightSampler
 {
 public:
@@ -12,7 +27,65 @@ public:
     virtual ~UniformLightSampler() = default;
 
     virtual bool Sample(SampledLight* sampled_light, const Intersection& isect, Float u) const override;
-    virtual Float EvaluatePMF(const Light* light) const override;
+    virtual Float EvaluatePMF(const Intersection& ref, const Light* light) const override;
+};
+
+// Chooses the lights by their emitted power, the same for every reference point.
+// Cheaper than BVHLightSampler, but the lights far from the reference point are chosen as often as the near ones
+class PowerLightSampler : public LightSampler
+{
+public:
+    PowerLightSampler(std::span<Light*> lights, const AABB& world_bounds);
+    virtual ~PowerLightSampler() = default;
+
+    virtual bool Sample(SampledLight* sampled_light, const Intersection& isect, Float u) const override;
+    virtual Float EvaluatePMF(const Intersection& ref, const Light* light) const override;
+
+private:
+    AliasTable alias_table;
+    std::unordered_map<const Light*, int32> light_indices;
 };
 
+// Light hierarchy over the bounded lights, traversed from the root by the importance of the children for the reference point.
+// The lights at infinity are chosen uniformly, as a whole as likely as the hierarchy (Conty Estevez and Kulla 2018)
+class BVHLightSampler : public LightSampler
+{
+public:
+    BVHLightSampler(std::span<Light*> lights);
+    virtual ~BVHLightSampler() = default;
+
+    virtual bool Sample(SampledLight* sampled_light, const Intersection& isect, Float u) const override;
+    virtual Float EvaluatePMF(const Intersection& ref, const Light* light) const override;
+
+private:
+    struct Node
+    {
+        LightBounds bounds;
+
+        // Index of the second child, the first child follows the node. Index of the light for the leaves
+        int32 child_or_light_index;
+        bool is_leaf;
+    };
+
+    struct BVHLight
+    {
+        int32 index;
+        LightBounds bounds;
+    };
+
+    int32 BuildNodes(std::span<BVHLight> bvh_lights, uint64 bit_trail, int32 depth);
+
+    // Probability of choosing one of the unbounded lights instead of the hierarchy
+    Float UnboundedProbability() const;
+
+    std::vector<const Light*> unbounded_lights;
+    std::vector<Node> nodes;
+
+    // Path from the root to the leaf of every bounded light, a set bit at depth d means the second child
+    std::unordered_map<const Light*, uint64> bit_trails;
+};
+
+// The world bounds give the lights at infinity their power
+std::unique_ptr<LightSampler> CreateLightSampler(LightSamplerType type, std::span<Light*> lights, const AABB& world_bounds);
+
 } // namespace bulbit
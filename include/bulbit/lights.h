@@ -17,6 +17,8 @@ public:
 
     LightSample Sample_Li(const Intersection& ref, const Point2& u) const;
     Float EvaluatePDF(const Ray& ray) const;
+    Spectrum Phi(Float world_radius) const;
+    bool GetBounds(LightBounds* bounds) const;
 
 private:
     Point3 position;
@@ -30,6 +32,8 @@ public:
 
     LightSample Sample_Li(const Intersection& ref, const Point2& u) const;
     Float EvaluatePDF(const Ray& ray) const;
+    Spectrum Phi(Float world_radius) const;
+    bool GetBounds(LightBounds* bounds) const;
 
 private:
     Vec3 dir;
@@ -44,6 +48,8 @@ public:
 
     LightSample Sample_Li(const Intersection& ref, const Point2& u) const;
     Float EvaluatePDF(const Ray& ray) const;
+    Spectrum Phi(Float world_radius) const;
+    bool GetBounds(LightBounds* bounds) const;
 
     Spectrum Le(const Ray& ray) const;
 
@@ -63,6 +69,8 @@ public:
 
     LightSample Sample_Li(const Intersection& ref, const Point2& u) const;
     Float EvaluatePDF(const Ray& ray) const;
+    Spectrum Phi(Float world_radius) const;
+    bool GetBounds(LightBounds* bounds) const;
 
     Spectrum Le(const Ray& ray) const;
 
@@ -82,6 +90,8 @@ public:
 
     LightSample Sample_Li(const Intersection& ref, const Point2& u) const;
     Float EvaluatePDF(const Ray& ray) const;
+    Spectrum Phi(Float world_radius) const;
+    bool GetBounds(LightBounds* bounds) const;
 
     Spectrum Le(const Ray& ray) const;
 
@@ -105,6 +115,16 @@ inline Spectrum Light::Le(const Ray& ray) const
     return Dispatch([&](auto light) { return light->Le(ray); });
 }
 
+inline Spectrum Light::Phi(Float world_radius) const
+{
+    return Dispatch([&](auto light) { return light->Phi(world_radius); });
+}
+
+inline bool Light::GetBounds(LightBounds* bounds) const
+{
+    return Dispatch([&](auto light) { return light->GetBounds(bounds); });
+}
+
 inline bool Light::IsDeltaLight() const
 {
     return Is<PointLight>() || Is<DirectionalLight>();
@@ -0,0 +1,92 @@
+// Original source: https://github.com/mmp/pbrt-v4/blob/master/src/pbrt/util/lowdiscrepancy.h
+
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#pragma once
+
+#include <array>
+
+#include "floats.h"
+#include "hash.h"
+
+namespace bulbit
+{
+
+inline uint32 ReverseBits32(uint32 n)
+{
+    n = (n << 16) | (n >> 16);
+    n = ((n & 0x00ff00ff) << 8) | ((n & 0xff00ff00) >> 8);
+    n = ((n & 0x0f0f0f0f) << 4) | ((n & 0xf0f0f0f0) >> 4);
+    n = ((n & 0x33333333) << 2) | ((n & 0xcccccccc) >> 2);
+    n = ((n & 0x55555555) << 1) | ((n & 0xaaaaaaaa) >> 1);
+    return n;
+}
+
+// Spreads the lower 32 bits of x to the even bits
+inline uint64 LeftShift2(uint64 x)
+{
+    x &= 0xffffffff;
+    x = (x ^ (x << 16)) & 0x0000ffff0000ffff;
+    x = (x ^ (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x ^ (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x ^ (x << 2)) & 0x3333333333333333;
+    x = (x ^ (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+inline uint64 EncodeMorton2(uint32 x, uint32 y)
+{
+    return (LeftShift2(y) << 1) | LeftShift2(x);
+}
+
+constexpr int32 sobol_matrix_size = 64;
+
+// Generator matrices of the first two Sobol dimensions, one column per bit of the index.
+// The first is the van der Corput sequence, the second the Pascal matrix mod 2, together they form a (0, 2)-sequence
+constexpr std::array<std::array<uint32, sobol_matrix_size>, 2> sobol_matrices = []() {
+    std::array<std::array<uint32, sobol_matrix_size>, 2> matrices{};
+
+    uint32 v = 0x80000000;
+    for (int32 i = 0; i < sobol_matrix_size; ++i)
+    {
+        matrices[0][i] = i < 32 ? 0x80000000 >> i : 0;
+        matrices[1][i] = v;
+        v ^= v >> 1;
+    }
+
+    return matrices;
+}();
+
+// Hash based Owen scrambling, every bit is flipped depending on all of the higher bits
+// https://psychopath.io/post/2021_01_30_building_a_better_lk_hash
+inline uint32 FastOwenScramble(uint32 v, uint32 seed)
+{
+    v = ReverseBits32(v);
+    v ^= v * 0x3d20adea;
+    v += seed;
+    v *= (seed >> 16) | 1;
+    v ^= v * 0x05526c56;
+    v ^= v * 0x53a22864;
+    return ReverseBits32(v);
+}
+
+// Owen scrambled value of the Sobol sequence in the given dimension, dimension is 0 or 1
+inline Float SobolSample(uint64 index, int32 dimension, uint32 seed)
+{
+    uint32 v = 0;
+    for (int32 i = 0; index != 0; index >>= 1, ++i)
+    {
+        if (index & 1)
+        {
+            v ^= sobol_matrices[dimension][i];
+        }
+    }
+
+    v = FastOwenScramble(v, seed);
+
+    return std::fmin(Float(1) - epsilon, Float(v * 0x1p-32f));
+}
+
+} // namespace bulbit
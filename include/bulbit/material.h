@@ -33,6 +33,10 @@ protected:
 
 public:
     Float GetAlpha(const Intersection& isect) const;
+
+    // Returns false if GetAlpha() always evaluates to 1, so that alpha testing can be skipped
+    bool HasAlpha() const;
+
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -13,6 +13,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -34,6 +35,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -55,6 +57,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -75,6 +78,7 @@ public:
     ThinDielectricMaterial(Float eta);
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -105,6 +109,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -136,6 +141,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -159,6 +165,7 @@ public:
     DiffuseLightMaterial(const SpectrumTexture* emission, bool two_sided = false, const FloatTexture* alpha = nullptr);
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -178,6 +185,7 @@ public:
     MixtureMaterial(const Material* material1, const Material* material2, const FloatTexture* mix);
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -204,6 +212,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -236,6 +245,7 @@ public:
     );
 
     Float GetAlpha(const Intersection& isect) const;
+    bool HasAlpha() const;
     const SpectrumTexture* GetNormalMap() const;
 
     Spectrum Le(const Intersection& isect, const Vec3& wo) const;
@@ -258,6 +268,11 @@ inline Float Material::GetAlpha(const Intersection& isect) const
     return Dispatch([&](auto mat) { return mat->GetAlpha(isect); });
 }
 
+inline bool Material::HasAlpha() const
+{
+    return Dispatch([](auto mat) { return mat->HasAlpha(); });
+}
+
 inline const SpectrumTexture* Material::GetNormalMap() const
 {
     return Dispatch([](auto mat) { return mat->GetNormalMap(); });
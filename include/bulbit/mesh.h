@@ -32,6 +32,13 @@ public:
 
     int32 GetTriangleCount() const;
 
+    // Vertex positions in the world space
+    std::span<const Point3> GetPositions() const;
+
+    // Moves the vertices of an animated mesh, the vertex count must not change.
+    // Normals and tangents are kept, BVHs built over the mesh have to be refitted afterwards
+    void SetPositions(std::span<const Point3> positions);
+
 private:
     friend class Scene;
     friend class Triangle;
@@ -49,4 +56,15 @@ inline int32 Mesh::GetTriangleCount() const
     return triangle_count;
 }
 
+inline std::span<const Point3> Mesh::GetPositions() const
+{
+    return positions;
+}
+
+inline void Mesh::SetPositions(std::span<const Point3> new_positions)
+{
+    BulbitAssert(new_positions.size() == positions.size());
+    std::copy(new_positions.begin(), new_positions.end(), positions.begin());
+}
+
 } // namespace bulbit
\ No newline at end of file
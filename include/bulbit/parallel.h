@@ -1,7 +1,9 @@
 #pragma once
 
 #include "common.h"
+#include "stats.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <optional>
@@ -13,32 +15,59 @@ namespace bulbit
 
 class ThreadPool;
 
+// Work scheduled on the thread pool, made of the iterations [begin, end) given to ThreadPool::Submit().
+// The pool splits the iterations into tasks, a job is finished once all of its iterations ran
 class ParallelJob
 {
 public:
     virtual ~ParallelJob() = default;
 
-    virtual bool HaveWork() const = 0;
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) = 0;
+    // Executes the iterations [begin, end)
+    virtual void Run(int32 begin, int32 end) = 0;
 
     bool Finished() const
     {
-        return !HaveWork() && active_workers == 0;
+        return remaining.load(std::memory_order_acquire) == 0;
     }
 
 protected:
+    ParallelJob(int32 count, int32 grain_size)
+        : remaining{ count }
+        , grain_size{ grain_size }
+    {
+    }
+
+    // Runs the iterations and counts them as done, the job may be destroyed by the waiting thread right after
+    void Execute(int32 begin, int32 end)
+    {
+        {
+            StatScope stat_scope(stat_counters);
+            Run(begin, end);
+        }
+
+        remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+    }
+
     friend class ThreadPool;
-    ThreadPool* thread_pool;
+    ThreadPool* thread_pool = nullptr;
+
+    // Counters installed on the submitting thread, the tasks of the job count into them wherever they run
+    StatCounters* stat_counters = nullptr;
 
 private:
-    // Active threads working on this job
-    int32 active_workers = 0;
+    // Iterations not completed yet
+    std::atomic<int32> remaining;
 
-    // Links
-    ParallelJob* prev = nullptr;
-    ParallelJob* next = nullptr;
+    // Ranges longer than this are split in half so that the other half can be stolen
+    int32 grain_size;
 };
 
+// Work stealing thread pool.
+// Every thread owns a deque of tasks, a task being a range of iterations of a job.
+// The owner pushes and pops at the bottom and idle threads steal from the top,
+// so the thieves take the largest ranges and the owner keeps working on the most recent ones.
+// Deque operations are lock free, there is no lock shared by all threads on the scheduling path.
+// Threads outside the pool share one more deque, the pushes to it are serialized with a mutex.
 class ThreadPool
 {
 public:
@@ -47,11 +76,14 @@ public:
     explicit ThreadPool(int32 worker_count);
     ~ThreadPool();
 
-    void WorkOrWait(std::unique_lock<std::mutex>* lock);
-    bool WorkOrReturn();
+    // Queues the iterations [begin, end) of the job on the deque of the calling thread
+    void Submit(ParallelJob* job, int32 begin, int32 end);
+
+    // Runs tasks on the calling thread until the job is finished
+    void Wait(ParallelJob* job);
 
-    std::unique_lock<std::mutex> AddJob(ParallelJob* job);
-    void RemoveJob(ParallelJob* job);
+    // Runs one task of any job, returns false if there was nothing to run
+    bool RunTask();
 
     void ForEachThread(std::function<void(void)> func);
 
@@ -61,15 +93,35 @@ public:
     }
 
 private:
-    void Worker();
+    struct Task
+    {
+        ParallelJob* job;
+        int32 begin, end;
+    };
+
+    class TaskDeque;
 
-    bool shutdown = false;
+    void Worker(int32 index);
+
+    int32 GetDequeIndex() const;
+    bool Push(const Task& task);
+    bool Pop(Task* task);
+    bool Steal(Task* task);
+    void Execute(Task task);
 
     std::vector<std::thread> threads;
-    std::mutex mutex;
-    std::condition_variable job_list_condition;
 
-    ParallelJob* job_list = nullptr;
+    // One deque per worker thread, the last one is shared by the threads outside the pool
+    int32 deque_count;
+    std::unique_ptr<TaskDeque[]> deques;
+    std::mutex external_mutex;
+
+    // Sleeping workers are woken up when a task is pushed
+    std::atomic<int32> queued_tasks;
+    std::atomic<int32> sleeping_workers;
+    std::atomic<bool> shutdown;
+    std::mutex sleep_mutex;
+    std::condition_variable wake_condition;
 };
 
 template <typename T>
@@ -77,13 +129,13 @@ class ThreadLocal
 {
 public:
     ThreadLocal()
-        : hash_table{ 4 * std::thread::hardware_concurrency() }
+        : hash_table{ 4 * MaxThreadCount() }
         , createFcn{ []() { return T(); } }
     {
     }
 
     ThreadLocal(std::function<T(void)> createFcn)
-        : hash_table{ 4 * std::thread::hardware_concurrency() }
+        : hash_table{ 4 * MaxThreadCount() }
         , createFcn{ std::move(createFcn) }
     {
     }
@@ -93,6 +145,13 @@ public:
     void ForEach(std::function<void(std::thread::id tid, T& value)>&& callback);
 
 private:
+    // The global pool may have more threads than the hardware
+    static size_t MaxThreadCount()
+    {
+        size_t pool_threads = ThreadPool::global_thread_pool ? size_t(ThreadPool::global_thread_pool->WorkerCount()) : 0;
+        return std::max<size_t>(std::thread::hardware_concurrency(), pool_threads);
+    }
+
     struct Entry
     {
         std::thread::id tid;
@@ -10,26 +10,19 @@ class ParallelForLoop : public ParallelJob
 {
 public:
     ParallelForLoop(int32 begin_index, int32 end_index, int32 chunk_size, std::function<void(int32, int32)> func)
-        : func{ std::move(func) }
-        , next_index{ begin_index }
-        , end_index{ end_index }
-        , chunk_size{ chunk_size }
+        : ParallelJob(end_index - begin_index, chunk_size)
+        , func{ std::move(func) }
     {
         BulbitAssert(begin_index < end_index);
     }
 
-    virtual bool HaveWork() const override
+    virtual void Run(int32 begin, int32 end) override
     {
-        return next_index < end_index;
+        func(begin, end);
     }
 
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) override;
-
 private:
     std::function<void(int32, int32)> func;
-    int32 next_index;
-    const int32 end_index;
-    int32 chunk_size;
 };
 
 void ParallelFor(
@@ -55,31 +48,46 @@ inline void ParallelFor(
     );
 }
 
+// Order in which ParallelFor2D() hands out the tiles. Consecutive tiles run on the same thread or at the same time,
+// so orders that keep them close in the image share more of the scene in the caches
+enum class TileOrder
+{
+    // Row by row
+    scanline,
+    // Along a Hilbert curve, every run of consecutive tiles covers a compact area
+    hilbert,
+    // Rings around the center tile, the middle of the image is done first
+    spiral,
+};
+
+// Splits the extents into tiles of tile_size pixels, the tiles at the right and the bottom may be smaller
+std::vector<AABB2i> GenerateTiles(const Point2i& extents, int32 tile_size, TileOrder order = TileOrder::scanline);
+
+// Runs func for every tile, each tile is a task of its own so that an idle thread can steal any tile that was not started
+void ParallelFor2D(
+    const std::vector<AABB2i>& tiles,
+    std::function<void(int32 index, AABB2i tile)> func,
+    ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
+);
+
+inline void ParallelFor2D(
+    const std::vector<AABB2i>& tiles,
+    std::function<void(AABB2i tile)> func,
+    ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
+)
+{
+    ParallelFor2D(tiles, [&func](int32, AABB2i tile) { func(tile); }, thread_pool);
+}
+
 inline void ParallelFor2D(
     const Point2i& extents,
     std::function<void(AABB2i tile)> func,
     int32 tile_size = 16,
+    TileOrder order = TileOrder::scanline,
     ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
 )
 {
-    int32 num_tiles_x = (extents.x + tile_size - 1) / tile_size;
-    int32 num_tiles_y = (extents.y + tile_size - 1) / tile_size;
-    int32 tile_count = num_tiles_x * num_tiles_y;
-
-    ParallelFor(
-        0, tile_count,
-        [&](int32 i) {
-            Point2i tile(i % num_tiles_x, i / num_tiles_x);
-
-            int32 x0 = tile.x * tile_size;
-            int32 x1 = std::min(x0 + tile_size, extents.x);
-            int32 y0 = tile.y * tile_size;
-            int32 y1 = std::min(y0 + tile_size, extents.y);
-
-            func(AABB2i(Point2i(x0, y0), Point2i(x1, y1)));
-        },
-        thread_pool
-    );
+    ParallelFor2D(GenerateTiles(extents, tile_size, order), std::move(func), thread_pool);
 }
 
 } // namespace bulbit
@@ -5,6 +5,7 @@
 #include "materials.h"
 #include "medium.h"
 #include "shape.h"
+#include "stats.h"
 
 namespace bulbit
 {
@@ -62,6 +63,8 @@ inline bool Primitive::Intersect(Intersection* isect, const Ray& ray, Float t_mi
         Float p = alpha <= 0 ? 1 : HashFloat(ray, isect->point);
         if (p > alpha)
         {
+            BulbitStatIncrement(Stat::alpha_test_retries);
+
             // Recursively handle the case of sphere hit
             Ray new_ray(isect->point, ray.d);
             return Intersect(isect, new_ray, Ray::epsilon, t_max - isect->t);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "async_job.h"
+#include "stats.h"
 
 namespace bulbit
 {
@@ -14,6 +15,8 @@ public:
         , tile_done{ 0 }
         , done{ false }
         , film(resolution)
+        , pass_done{ 0 }
+        , snapshot(film)
     {
         int32 num_tiles_x = (resolution.x + tile_size - 1) / tile_size;
         int32 num_tiles_y = (resolution.y + tile_size - 1) / tile_size;
@@ -75,8 +78,35 @@ public:
         return film;
     }
 
+    // Copy of the film as of the last finished pass of a progressive render, consistent while the workers keep rendering.
+    // Black until the first pass finished. The rows the workers did not write since are copied by the caller
+    Film GetSnapshot() const
+    {
+        return snapshot.Get();
+    }
+
+    int32 GetNumPassDone() const
+    {
+        return pass_done.load();
+    }
+
+    // Counters of the tasks of this render, complete once it is done. Zero without BULBIT_ENABLE_STATS.
+    // Work running at the same time, such as a second render, is not included
+    Statistics GetStatistics() const
+    {
+        return statistics.Get();
+    }
+
 private:
     friend class UniDirectionalRayIntegrator;
+    friend class WavefrontPathIntegrator;
+
+    // Marks the film as the snapshot of a finished pass, the rows are copied once they are written to or read
+    void UpdateSnapshot(int32 sample_count)
+    {
+        snapshot.Update(sample_count);
+        pass_done++;
+    }
 
     Point2i resolution;
     int32 tile_size;
@@ -87,6 +117,11 @@ private:
 
     Film film;
     std::unique_ptr<AsyncJob<bool>> job;
+
+    std::atomic<int32> pass_done;
+    FilmSnapshot snapshot;
+
+    StatCounters statistics;
 };
 
 } // namespace bulbit
@@ -44,4 +44,48 @@ private:
     RNG rng;
 };
 
+// Owen scrambled Sobol points of the first two dimensions within each pixel, padded to higher dimensions by shuffling
+// the sample index and hashing the scramble of every dimension. Works best with a power of two samples per pixel
+class SobolSampler : public Sampler
+{
+public:
+    SobolSampler(int32 samples_per_pixel, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+
+    virtual std::unique_ptr<Sampler> Clone() const override;
+
+private:
+    int32 seed;
+    int32 dimension;
+};
+
+// Sobol points shared by all pixels along a Morton curve over the image, with the base 4 digits of the index permuted
+// per dimension. The error of neighboring pixels is decorrelated into blue noise (Ahmed and Wonka 2020)
+class ZSobolSampler : public Sampler
+{
+public:
+    ZSobolSampler(int32 samples_per_pixel, const Point2i& resolution, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+
+    virtual std::unique_ptr<Sampler> Clone() const override;
+
+private:
+    uint64 GetSampleIndex() const;
+
+    Point2i resolution;
+    int32 seed;
+    int32 log2_samples_per_pixel, base4_digits;
+
+    uint64 morton_index;
+    int32 dimension;
+};
+
 } // namespace bulbit
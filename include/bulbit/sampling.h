@@ -363,52 +363,248 @@ struct Distribution1D
     Float func_integral;
 };
 
+// Piecewise constant 2D distribution, the marginal over the rows and the conditional of every row.
+// The tables of all rows are stored contiguously, each with a guide table: the interval holding u = k / m for m = n / 4,
+// which narrows the binary search of a sample to a few neighbouring entries. The rows are built in parallel
 class Distribution2D
 {
 public:
-    Distribution2D(const Float* func, int32 nu, int32 nv)
+    Distribution2D(const Float* func, int32 nu, int32 nv);
+
+    Point2 SampleContinuous(Float* pdf, const Point2& u) const
+    {
+        Float pdfs[2];
+        int32 v;
+
+        Float d1 = SampleContinuous(&pdfs[1], u[1], MarginalFunc(), MarginalCDF(), MarginalGuide(), MarginalIntegral(), nv, &v);
+        Float d0 = SampleContinuous(&pdfs[0], u[0], Func(v), CDF(v), Guide(v), MarginalFunc()[v], nu, nullptr);
+
+        *pdf = pdfs[0] * pdfs[1];
+        return Point2(d0, d1);
+    }
+
+    Float Pdf(const Point2& p) const
     {
-        conditional_v.reserve(nv);
-        for (int32 v = 0; v < nv; ++v)
+        int32 iu = Clamp(int32(p[0] * nu), 0, nu - 1);
+        int32 iv = Clamp(int32(p[1] * nv), 0, nv - 1);
+
+        return Func(iv)[iu] / MarginalIntegral();
+    }
+
+private:
+    // Same as Distribution1D::SampleContinuous() over a table of n values and its n + 1 cdf entries
+    static Float SampleContinuous(
+        Float* pdf, Float u, const Float* func, const Float* cdf, const int32* guide, Float integral, int32 n, int32* off
+    )
+    {
+        // Search between the guide entries around u, or the whole table if rounding put u outside of them
+        int32 m = GuideCount(n);
+        int32 k = std::min(int32(u * m), m - 1);
+        int32 begin = guide[k];
+        int32 end = k + 1 < m ? guide[k + 1] + 1 : n;
+        if (cdf[begin] > u || (end < n && cdf[end] <= u))
         {
-            conditional_v.emplace_back(new Distribution1D(&func[v * nu], nu));
+            begin = 0;
+            end = n;
         }
 
-        std::vector<Float> marginal_func(nv);
-        for (int32 v = 0; v < nv; ++v)
+        int32 offset = begin + FindInterval(end - begin + 1, [&](int32 index) { return cdf[begin + index] <= u; });
+
+        if (off)
         {
-            marginal_func[v] = conditional_v[v]->func_integral;
+            *off = offset;
         }
 
-        marginal.reset(new Distribution1D(&marginal_func[0], nv));
+        *pdf = integral > 0 ? func[offset] / integral : 0;
+
+        Float du = (u - cdf[offset]) / (cdf[offset + 1] - cdf[offset]);
+
+        return (offset + du) / n;
     }
 
-    Point2 SampleContinuous(Float* pdf, const Point2& u) const
+    // Builds the normalized cdf and the guide table of a table, returns its integral
+    static Float BuildCDF(Float* cdf, int32* guide, const Float* func, int32 n);
+
+    static int32 GuideCount(int32 n)
     {
-        Float pdfs[2];
-        int32 v;
+        return (n + 3) / 4;
+    }
 
-        Float d1 = marginal->SampleContinuous(&pdfs[1], u[1], &v);
-        Float d0 = conditional_v[v]->SampleContinuous(&pdfs[0], u[0]);
+    // Layout of the data: nv rows of nu function values, nv rows of nu + 1 cdf entries,
+    // the nv row integrals (the marginal function), the nv + 1 marginal cdf entries and the marginal integral.
+    // The guides hold nv rows of GuideCount(nu) entries followed by the GuideCount(nv) entries of the marginal
+    const Float* Func(int32 v) const
+    {
+        return &data[size_t(v) * nu];
+    }
 
-        *pdf = pdfs[0] * pdfs[1];
-        return Point2(d0, d1);
+    const Float* CDF(int32 v) const
+    {
+        return &data[size_t(nv) * nu + size_t(v) * (nu + 1)];
     }
 
-    Float Pdf(const Point2& p) const
+    const int32* Guide(int32 v) const
     {
-        int32 w = conditional_v[0]->Count();
-        int32 h = marginal->Count();
+        return &guides[size_t(v) * GuideCount(nu)];
+    }
 
-        int32 iu = Clamp(int32(p[0] * w), 0, w - 1);
-        int32 iv = Clamp(int32(p[1] * h), 0, h - 1);
+    const Float* MarginalFunc() const
+    {
+        return &data[size_t(nv) * nu + size_t(nv) * (nu + 1)];
+    }
 
-        return conditional_v[iv]->func[iu] / marginal->func_integral;
+    const Float* MarginalCDF() const
+    {
+        return MarginalFunc() + nv;
+    }
+
+    const int32* MarginalGuide() const
+    {
+        return &guides[size_t(nv) * GuideCount(nu)];
+    }
+
+    Float MarginalIntegral() const
+    {
+        return MarginalCDF()[nv + 1];
+    }
+
+    int32 nu, nv;
+    std::vector<Float> data;
+    std::vector<int32> guides;
+};
+
+// Walker's alias method, samples an index proportional to its weight in constant time.
+// Every bin holds its own index with probability q and the alias index otherwise (Vose 1991)
+class AliasTable
+{
+public:
+    AliasTable() = default;
+
+    AliasTable(std::span<const Float> weights)
+        : bins(weights.size())
+    {
+        double sum = 0;
+        for (Float w : weights)
+        {
+            BulbitAssert(w >= 0);
+            sum += w;
+        }
+
+        int32 n = int32(bins.size());
+        for (int32 i = 0; i < n; ++i)
+        {
+            // Uniform if all weights are zero
+            bins[i].p = sum > 0 ? Float(weights[i] / sum) : Float(1) / n;
+        }
+
+        // Split the bins into the ones below and above the average probability
+        struct Outcome
+        {
+            double p_hat;
+            int32 index;
+        };
+        std::vector<Outcome> under, over;
+        for (int32 i = 0; i < n; ++i)
+        {
+            double p_hat = double(bins[i].p) * n;
+            if (p_hat < 1)
+            {
+                under.push_back(Outcome{ p_hat, i });
+            }
+            else
+            {
+                over.push_back(Outcome{ p_hat, i });
+            }
+        }
+
+        // Fill up every bin below the average with the excess of a bin above it
+        while (!under.empty() && !over.empty())
+        {
+            Outcome un = under.back();
+            under.pop_back();
+            Outcome ov = over.back();
+            over.pop_back();
+
+            bins[un.index].q = Float(un.p_hat);
+            bins[un.index].alias = ov.index;
+
+            double p_excess = un.p_hat + ov.p_hat - 1;
+            if (p_excess < 1)
+            {
+                under.push_back(Outcome{ p_excess, ov.index });
+            }
+            else
+            {
+                over.push_back(Outcome{ p_excess, ov.index });
+            }
+        }
+
+        // The rest are at the average up to rounding errors
+        for (const Outcome& outcome : under)
+        {
+            bins[outcome.index].q = 1;
+            bins[outcome.index].alias = -1;
+        }
+        for (const Outcome& outcome : over)
+        {
+            bins[outcome.index].q = 1;
+            bins[outcome.index].alias = -1;
+        }
+    }
+
+    int32 Sample(Float u, Float* pmf = nullptr, Float* u_remapped = nullptr) const
+    {
+        int32 n = int32(bins.size());
+        int32 offset = std::min<int32>(int32(u * n), n - 1);
+        Float up = std::min<Float>(u * n - offset, Float(1) - epsilon);
+
+        if (up < bins[offset].q)
+        {
+            if (pmf)
+            {
+                *pmf = bins[offset].p;
+            }
+            if (u_remapped)
+            {
+                *u_remapped = std::min<Float>(up / bins[offset].q, Float(1) - epsilon);
+            }
+
+            return offset;
+        }
+        else
+        {
+            int32 alias = bins[offset].alias;
+            if (pmf)
+            {
+                *pmf = bins[alias].p;
+            }
+            if (u_remapped)
+            {
+                *u_remapped = std::min<Float>((up - bins[offset].q) / (1 - bins[offset].q), Float(1) - epsilon);
+            }
+
+            return alias;
+        }
+    }
+
+    Float PMF(int32 index) const
+    {
+        return bins[index].p;
+    }
+
+    int32 Count() const
+    {
+        return int32(bins.size());
     }
 
 private:
-    std::vector<std::unique_ptr<Distribution1D>> conditional_v; // p(u|v)
-    std::unique_ptr<Distribution1D> marginal;
+    struct Bin
+    {
+        Float q, p;
+        int32 alias;
+    };
+
+    std::vector<Bin> bins;
 };
 
 // https://sopiro.github.io/posts/wrs/
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "bvh.h"
+#include "instance.h"
 #include "light.h"
 #include "material.h"
 #include "medium.h"
@@ -27,6 +29,16 @@ public:
     template <typename... Args>
     Mesh* CreateMesh(Args&&... args);
 
+    // Builds a bottom level BVH over the triangles of the mesh in the space of the mesh.
+    // The triangles are not part of GetPrimitives(), they are placed into the world with CreateInstance().
+    const BVH* CreateBLAS(
+        const Mesh* mesh,
+        const Material* material,
+        const MediumInterface& medium_interface = {},
+        const BVHBuildOptions& options = {}
+    );
+    Instance* CreateInstance(const Intersectable* blas, const Transform& transform);
+
     template <typename LightType, typename... Args>
     LightType* CreateLight(Args&&... args);
 
@@ -50,6 +62,10 @@ private:
     std::vector<Primitive*> primitives;
     std::vector<std::unique_ptr<Mesh>> meshes;
 
+    // Geometry referenced through instances only
+    std::vector<Primitive*> blas_primitives;
+    std::vector<std::unique_ptr<BVH>> blases;
+
     std::vector<Light*> lights;
 
     std::vector<Medium*> media;
@@ -84,6 +100,11 @@ inline Scene::~Scene() noexcept
         allocator.delete_object(p);
     }
 
+    for (Primitive* p : blas_primitives)
+    {
+        allocator.delete_object(p);
+    }
+
     for (Light* l : lights)
     {
         allocator.delete_object(l);
@@ -120,6 +141,30 @@ inline Mesh* Scene::CreateMesh(Args&&... args)
     return ptr;
 }
 
+inline const BVH* Scene::CreateBLAS(
+    const Mesh* mesh, const Material* material, const MediumInterface& medium_interface, const BVHBuildOptions& options
+)
+{
+    std::vector<Primitive*> triangles;
+    triangles.reserve(mesh->GetTriangleCount());
+
+    for (int32 i = 0; i < mesh->GetTriangleCount(); ++i)
+    {
+        Triangle* triangle = CreateShape<Triangle>(mesh, i);
+        Primitive* primitive = allocator.new_object<Primitive>(triangle, material, medium_interface);
+        blas_primitives.push_back(primitive);
+        triangles.push_back(primitive);
+    }
+
+    blases.push_back(std::make_unique<BVH>(triangles, options));
+    return blases.back().get();
+}
+
+inline Instance* Scene::CreateInstance(const Intersectable* blas, const Transform& transform)
+{
+    return CreatePrimitive<Instance>(blas, transform);
+}
+
 template <typename LightType, typename... Args>
 inline LightType* Scene::CreateLight(Args&&... args)
 {
@@ -93,8 +93,13 @@ public:
     virtual Float EvaluatePDF(const Ray& ray) const override;
     virtual Float PDF(const Intersection& hit_is, const Ray& hit_ray) const override;
 
+    void GetVertices(Point3* p0, Point3* p1, Point3* p2) const;
+
 private:
     friend class Scene;
+    friend struct BVHLeaves;
+
+    void SetIntersection(Intersection* isect, const Ray& ray, Float t, Float u, Float v) const;
 
     Vec3 GetNormal(Float u, Float v, Float w) const;
     Vec3 GetTangent(Float u, Float v, Float w) const;
@@ -152,6 +157,13 @@ inline Float Triangle::PDF(const Intersection& hit_is, const Ray& hit_ray) const
     return distance_squared / (cosine * area);
 }
 
+inline void Triangle::GetVertices(Point3* p0, Point3* p1, Point3* p2) const
+{
+    *p0 = mesh->positions[v[0]];
+    *p1 = mesh->positions[v[1]];
+    *p2 = mesh->positions[v[2]];
+}
+
 inline Vec3 Triangle::GetNormal(Float tu, Float tv, Float tw) const
 {
     const Vec3& n0 = mesh->normals[v[0]];
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+#include <filesystem>
+
+namespace bulbit
+{
+
+// Counters of the hot paths of the renderer, collected when compiled with BULBIT_ENABLE_STATS.
+// Without it the counting macros expand to nothing
+enum class Stat : int32
+{
+    // Integrator
+    camera_rays,
+    russian_roulette_terminations,
+
+    // Accelerator
+    closest_hit_queries,
+    any_hit_queries,
+    bvh_nodes_visited,
+    bvh_primitive_tests,
+    alpha_test_retries,
+
+    count
+};
+
+enum class StatHistogram : int32
+{
+    // Bounces of the paths when they were terminated
+    path_length,
+
+    count
+};
+
+// Values at or above the last bucket are counted in it
+constexpr int32 stat_histogram_bucket_count = 64;
+
+// Sum of the counters of all threads
+struct Statistics
+{
+    int64 counters[int32(Stat::count)] = {};
+    int64 histograms[int32(StatHistogram::count)][stat_histogram_bucket_count] = {};
+
+    int64 operator[](Stat stat) const
+    {
+        return counters[int32(stat)];
+    }
+
+    // Difference of two readings, the statistics gathered in between
+    Statistics operator-(const Statistics& other) const;
+};
+
+// Current totals since the program started, all zero without BULBIT_ENABLE_STATS
+Statistics GetStatistics();
+
+// Counters of a single render or another piece of work, apart from whatever else runs on the same threads.
+// A thread counts into them while a StatScope installs them, and so do the jobs it submits to the thread pool meanwhile.
+// The counts are added to the totals of the process as well
+class StatCounters
+{
+public:
+    // Totals of the finished tasks of the work, all zero without BULBIT_ENABLE_STATS
+    Statistics Get() const;
+
+#if defined(BULBIT_ENABLE_STATS)
+private:
+    friend class StatScope;
+
+    void Add(const Statistics& begin, const Statistics& end);
+
+    std::atomic<int64> counters[int32(Stat::count)] = {};
+    std::atomic<int64> histograms[int32(StatHistogram::count)][stat_histogram_bucket_count] = {};
+#endif
+};
+
+// Writes JSON or CSV depending on the file extension, the counters are grouped by the integrator and the accelerator
+bool WriteStatistics(const Statistics& stats, const std::filesystem::path& filename);
+
+#if defined(BULBIT_ENABLE_STATS)
+
+// Counters owned by one thread. Only the owner writes them, with plain loads and stores that the readers may see late
+class ThreadStatistics
+{
+public:
+    void Add(Stat stat, int64 value)
+    {
+        Add(counters[int32(stat)], value);
+    }
+
+    void Record(StatHistogram histogram, int32 value)
+    {
+        int32 bucket = std::clamp(value, 0, stat_histogram_bucket_count - 1);
+        Add(histograms[int32(histogram)][bucket], 1);
+    }
+
+private:
+    friend Statistics GetStatistics();
+    friend class StatQueryScope;
+    friend class StatScope;
+    friend StatCounters* GetCurrentStatCounters();
+
+    Statistics Get() const;
+
+    // Not a locked read-modify-write, there is a single writer
+    static void Add(std::atomic<int64>& counter, int64 value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<int64> counters[int32(Stat::count)] = {};
+    std::atomic<int64> histograms[int32(StatHistogram::count)][stat_histogram_bucket_count] = {};
+
+    // Number of acceleration structure queries in progress on the thread, see StatQueryScope
+    int32 query_depth = 0;
+
+    // Installed by StatScope, along with the counts of the thread when they were installed
+    StatCounters* scope_counters = nullptr;
+    Statistics scope_begin;
+};
+
+// Registers the counters of the calling thread, they are kept after the thread exits
+ThreadStatistics* CreateThreadStatistics();
+
+inline ThreadStatistics& GetThreadStatistics()
+{
+    thread_local ThreadStatistics* stats = CreateThreadStatistics();
+    return *stats;
+}
+
+// Counts the queries of an acceleration structure made while it is alive, unless it is nested in another query.
+// The BLAS of an instance is traversed from within the query of the TLAS, so a ray is counted once however many levels it
+// goes through, while its node visits and primitive tests are counted at every level
+class StatQueryScope
+{
+public:
+    StatQueryScope(Stat stat, int64 count)
+        : stats{ GetThreadStatistics() }
+    {
+        if (stats.query_depth++ == 0)
+        {
+            stats.Add(stat, count);
+        }
+    }
+
+    ~StatQueryScope()
+    {
+        --stats.query_depth;
+    }
+
+private:
+    ThreadStatistics& stats;
+};
+
+// Counts the work of the calling thread into the counters while alive, the thread pool installs the counters of the submitter
+// for every task it runs. A nested scope takes over until it ends, null counts the work only into the totals of the process
+class StatScope
+{
+public:
+    explicit StatScope(StatCounters* counters);
+    ~StatScope();
+
+    StatScope(const StatScope&) = delete;
+    StatScope& operator=(const StatScope&) = delete;
+
+private:
+    StatCounters* previous;
+};
+
+// Counters installed on the calling thread, null if none
+inline StatCounters* GetCurrentStatCounters()
+{
+    return GetThreadStatistics().scope_counters;
+}
+
+#define BulbitStatAdd(stat, value) GetThreadStatistics().Add(stat, value)
+#define BulbitStatIncrement(stat) GetThreadStatistics().Add(stat, 1)
+#define BulbitStatRecord(histogram, value) GetThreadStatistics().Record(histogram, value)
+#define BulbitStatQuery(stat, count) StatQueryScope stat_query_scope(stat, count)
+
+#else
+
+class StatScope
+{
+public:
+    explicit StatScope(StatCounters*) {}
+};
+
+inline StatCounters* GetCurrentStatCounters()
+{
+    return nullptr;
+}
+
+#define BulbitStatAdd(stat, value) ((void)0)
+#define BulbitStatIncrement(stat) ((void)0)
+#define BulbitStatRecord(histogram, value) ((void)0)
+#define BulbitStatQuery(stat, count) ((void)0)
+
+#endif
+
+} // namespace bulbit
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ray.h"
+
+namespace bulbit
+{
+
+// Watertight ray/triangle test (Woop et al. 2013).
+// The vertices are translated to the ray origin, permuted and sheared so that the ray runs along +z,
+// then the 2D edge functions decide the hit. Triangles sharing an edge evaluate the same edge function with the opposite sign,
+// so a ray can never pass between them.
+// The permutation and shear depend on the ray only, they are computed once and shared by all the triangles tested against it.
+struct TriangleIntersector
+{
+    TriangleIntersector() = default;
+    TriangleIntersector(const Ray& ray);
+
+    // Barycentric u and v are the weights of p1 and p2, t is in the units of the unnormalized ray direction
+    bool Intersect(
+        const Point3& p0, const Point3& p1, const Point3& p2, Float t_min, Float t_max, Float* out_t, Float* out_u, Float* out_v
+    ) const;
+
+    // Tests up to four triangles at once, triangles[i] points to the three vertices of triangle i.
+    // Returns the mask of the hit lanes, lanes from count on are not tested
+    uint32 Intersect4(
+        const Point3* const triangles[4], int32 count, Float t_min, Float t_max, Float out_t[4], Float out_u[4], Float out_v[4]
+    ) const;
+
+    Point3 o;
+
+    // Axis the ray is mapped onto and the two others, kx and ky are swapped to keep the winding for negative directions
+    int32 kx, ky, kz;
+
+    // Shear that maps the direction to (0, 0, 1)
+    Float sx, sy, sz;
+};
+
+inline TriangleIntersector::TriangleIntersector(const Ray& ray)
+    : o{ ray.o }
+{
+    Vec3 abs_d(std::abs(ray.d.x), std::abs(ray.d.y), std::abs(ray.d.z));
+    kz = abs_d.x > abs_d.y ? (abs_d.x > abs_d.z ? 0 : 2) : (abs_d.y > abs_d.z ? 1 : 2);
+    kx = kz == 2 ? 0 : kz + 1;
+    ky = kx == 2 ? 0 : kx + 1;
+
+    if (ray.d[kz] < 0)
+    {
+        std::swap(kx, ky);
+    }
+
+    sz = 1 / ray.d[kz];
+    sx = ray.d[kx] * sz;
+    sy = ray.d[ky] * sz;
+}
+
+inline bool TriangleIntersector::Intersect(
+    const Point3& p0, const Point3& p1, const Point3& p2, Float t_min, Float t_max, Float* out_t, Float* out_u, Float* out_v
+) const
+{
+    const Vec3 a = p0 - o;
+    const Vec3 b = p1 - o;
+    const Vec3 c = p2 - o;
+
+    const Float ax = a[kx] - sx * a[kz];
+    const Float ay = a[ky] - sy * a[kz];
+    const Float bx = b[kx] - sx * b[kz];
+    const Float by = b[ky] - sy * b[kz];
+    const Float cx = c[kx] - sx * c[kz];
+    const Float cy = c[ky] - sy * c[kz];
+
+    // Edge functions, the weights of p0, p1 and p2 scaled by the determinant
+    Float u = cx * by - cy * bx;
+    Float v = ax * cy - ay * cx;
+    Float w = bx * ay - by * ax;
+
+#ifndef BULBIT_DOUBLE_PRECISION
+    // The ray passes exactly through an edge or a vertex in single precision, decide it in double precision
+    if (u == 0 || v == 0 || w == 0)
+    {
+        u = Float(double(cx) * double(by) - double(cy) * double(bx));
+        v = Float(double(ax) * double(cy) - double(ay) * double(cx));
+        w = Float(double(bx) * double(ay) - double(by) * double(ax));
+    }
+#endif
+
+    if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+    {
+        return false;
+    }
+
+    const Float det = u + v + w;
+    if (det == 0)
+    {
+        return false;
+    }
+
+    const Float az = sz * a[kz];
+    const Float bz = sz * b[kz];
+    const Float cz = sz * c[kz];
+
+    const Float inv_det = 1 / det;
+    const Float t = (u * az + v * bz + w * cz) * inv_det;
+    if (!(t >= t_min && t <= t_max))
+    {
+        return false;
+    }
+
+    *out_t = t;
+    *out_u = v * inv_det;
+    *out_v = w * inv_det;
+    return true;
+}
+
+} // namespace bulbit
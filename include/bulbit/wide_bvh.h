@@ -0,0 +1,88 @@
+#pragma once
+
+#include "bvh.h"
+
+namespace bulbit
+{
+
+// N-ary BVH collapsed from the binary SAH tree built by BVH.
+// Child bounds of each node are stored as SoA float lanes so that all of them are tested with one SIMD slab test.
+template <int32 N>
+class WideBVH : public Intersectable
+{
+    static_assert(N == 4 || N == 8, "Only 4-wide and 8-wide nodes are supported");
+
+public:
+    static constexpr int32 width = N;
+
+    WideBVH(const std::vector<Primitive*>& primitives);
+    ~WideBVH() noexcept;
+
+    WideBVH(const WideBVH&) = delete;
+    WideBVH& operator=(const WideBVH&) = delete;
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    int32 GetNodeCount() const;
+
+    // Bytes held by the nodes and the per primitive leaf data
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr int32 empty_child = -1;
+
+    struct alignas(32) WideNode
+    {
+        // Child bounds in SoA layout
+        float min_x[N], min_y[N], min_z[N];
+        float max_x[N], max_y[N], max_z[N];
+
+        // Internal child: index of the child node
+        // Leaf child:     offset into the primitive array
+        // Empty slot:     empty_child
+        int32 children[N];
+
+        // Number of primitives for a leaf child, zero otherwise
+        uint16 counts[N];
+    };
+
+    int32 Collapse(const BVH& bvh, int32 bvh_node);
+
+    template <typename T>
+    void RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const;
+
+    std::vector<WideNode> nodes;
+
+    // Leaf data of the binary tree, the leaves keep their primitive ranges
+    BVHLeaves leaves;
+
+    AABB aabb;
+};
+
+template <int32 N>
+inline AABB WideBVH<N>::GetAABB() const
+{
+    return aabb;
+}
+
+template <int32 N>
+inline int32 WideBVH<N>::GetNodeCount() const
+{
+    return int32(nodes.size());
+}
+
+template <int32 N>
+inline size_t WideBVH<N>::GetMemoryUsage() const
+{
+    return nodes.size() * sizeof(WideNode) + leaves.GetMemoryUsage();
+}
+
+using WideBVH4 = WideBVH<4>;
+using WideBVH8 = WideBVH<8>;
+
+extern template class WideBVH<4>;
+extern template class WideBVH<8>;
+
+} // namespace bulbit
@@ -7,6 +7,9 @@
 
 #include <format>
 
+// Usage: sample [--region x0 y0 x1 y1] [--samples begin end] [--film filename]
+// Renders the pixels in the region and the sample indices [begin, end) of them. With --film, the raw film is written
+// for film_merge instead of the image, so that the parts of a frame can be rendered by several processes
 int main(int argc, char* argv[])
 {
 #if defined(_WIN32) && defined(_DEBUG)
@@ -16,6 +19,31 @@ int main(int argc, char* argv[])
 
     ThreadPool::global_thread_pool.reset(new ThreadPool(std::thread::hardware_concurrency()));
 
+    RenderPartitionOptions partition;
+    std::filesystem::path film_filename;
+    for (int32 i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--region" && i + 4 < argc)
+        {
+            Point2i min(std::atoi(argv[i + 1]), std::atoi(argv[i + 2]));
+            Point2i max(std::atoi(argv[i + 3]), std::atoi(argv[i + 4]));
+            partition.region = AABB2i(min, max);
+            i += 4;
+        }
+        else if (arg == "--samples" && i + 2 < argc)
+        {
+            partition.sample_begin = std::atoi(argv[i + 1]);
+            partition.sample_end = std::atoi(argv[i + 2]);
+            i += 2;
+        }
+        else if (arg == "--film" && i + 1 < argc)
+        {
+            film_filename = argv[i + 1];
+            i += 1;
+        }
+    }
+
     Scene scene;
     std::unique_ptr<Camera> camera;
 
@@ -43,14 +71,24 @@ int main(int argc, char* argv[])
 
     IndependentSampler sampler(samples_per_pixel);
     // StratifiedSampler sampler(std::sqrt(samples_per_pixel), std::sqrt(samples_per_pixel), true);
+    // SobolSampler sampler(samples_per_pixel);
+    // ZSobolSampler sampler(samples_per_pixel, camera->GetScreenResolution());
 
     VolPathIntegrator renderer(&accel, scene.GetLights(), &sampler, max_bounces);
     // PathIntegrator renderer(&accel, scene.GetLights(), &sampler, max_bounces);
+    // WavefrontPathIntegrator renderer(&accel, scene.GetLights(), &sampler, max_bounces);
     // DebugIntegrator renderer(&accel, scene.GetLights(), &sampler);
     // AmbientOcclusion renderer(&accel, scene.GetLights(), &sampler, 0.5f);
     // AlbedoIntegrator renderer(&accel, scene.GetLights(), &sampler);
     // WhittedStyle renderer(&accel, scene.GetLights(), &sampler, max_bounces);
 
+    // renderer.SetAdaptiveSampling({ .max_error = 0.05f });
+    // renderer.SetProgressiveRendering({ .pass_samples = 4, .time_budget = 60 });
+    // renderer.SetCheckpointing({ .filename = "checkpoint.bin", .interval = 600 });
+    // renderer.SetTiling({ .order = TileOrder::spiral });
+    // renderer.SetLightSampler(LightSamplerType::bvh);
+    renderer.SetRenderPartition(partition);
+
     std::unique_ptr<RenderingProgress> rendering = renderer.Render(*camera);
     const Film& film = rendering->WaitAndLogProgress();
 
@@ -58,12 +96,21 @@ int main(int argc, char* argv[])
     t = timer.Get();
     std::cout << "\nComplete: " << t << 's' << std::endl;
 
+    if (!film_filename.empty())
+    {
+        return WriteFilm(film, film_filename) ? 0 : 1;
+    }
+
     Image3 image = film.ConvertToImage();
 
     auto [width, height] = camera->GetScreenResolution();
     std::string filename = std::format("render_{}x{}_s{}_d{}_t{}s.hdr", width, height, samples_per_pixel, max_bounces, t);
     WriteImage(image, filename.c_str());
 
+#if defined(BULBIT_ENABLE_STATS)
+    WriteStatistics(rendering->GetStatistics(), std::filesystem::path(filename).replace_extension(".json"));
+#endif
+
 #if _DEBUG
     return 0;
 #else
@@ -1,24 +1,132 @@
 #include "bulbit/bvh.h"
 #include "bulbit/intersectable.h"
 #include "bulbit/parallel_for.h"
+#include "bulbit/shapes.h"
 
 #include <algorithm>
+#include <bit>
 
 namespace bulbit
 {
 
-BVH::BVH(const std::vector<Primitive*>& _primitives)
-    : primitives{ std::move(_primitives) }
+namespace
 {
-    size_t primitive_count = primitives.size();
+
+constexpr int32 build_chunk_size = 16 * 1024;
+
+int32 GetChunkCount(size_t count)
+{
+    return int32((count + build_chunk_size - 1) / build_chunk_size);
+}
+
+// Reduces the chunks of [0, count) in parallel, each chunk is evaluated with func(begin, end)
+template <typename T, typename F, typename M>
+T ParallelReduce(size_t count, const T& init, F&& func, M&& merge)
+{
+    int32 chunk_count = GetChunkCount(count);
+    std::vector<T> results(chunk_count, init);
+
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        size_t begin = size_t(chunk) * build_chunk_size;
+        size_t end = std::min(begin + build_chunk_size, count);
+        results[chunk] = func(begin, end);
+    });
+
+    T result = init;
+    for (const T& r : results)
+    {
+        result = merge(result, r);
+    }
+
+    return result;
+}
+
+// Parallel version of std::partition, returns the number of elements satisfying the predicate
+template <typename T, typename P>
+size_t ParallelPartition(std::span<T> span, P&& pred)
+{
+    const size_t count = span.size();
+    const int32 chunk_count = GetChunkCount(count);
+
+    // Count the elements of each side per chunk
+    std::vector<size_t> left_offsets(chunk_count), right_offsets(chunk_count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        size_t begin = size_t(chunk) * build_chunk_size;
+        size_t end = std::min(begin + build_chunk_size, count);
+
+        size_t left = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            left += pred(span[i]) ? 1 : 0;
+        }
+
+        left_offsets[chunk] = left;
+        right_offsets[chunk] = (end - begin) - left;
+    });
+
+    // Exclusive prefix sums give the output offsets of each chunk
+    size_t left_sum = 0, right_sum = 0;
+    for (int32 chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        size_t left = left_offsets[chunk];
+        size_t right = right_offsets[chunk];
+
+        left_offsets[chunk] = left_sum;
+        right_offsets[chunk] = right_sum;
+
+        left_sum += left;
+        right_sum += right;
+    }
+
+    std::vector<T> partitioned(count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        size_t begin = size_t(chunk) * build_chunk_size;
+        size_t end = std::min(begin + build_chunk_size, count);
+
+        size_t left = left_offsets[chunk];
+        size_t right = left_sum + right_offsets[chunk];
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (pred(span[i]))
+            {
+                partitioned[left++] = span[i];
+            }
+            else
+            {
+                partitioned[right++] = span[i];
+            }
+        }
+    });
+
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        size_t begin = size_t(chunk) * build_chunk_size;
+        size_t end = std::min(begin + build_chunk_size, count);
+        std::copy(partitioned.begin() + begin, partitioned.begin() + end, span.begin() + begin);
+    });
+
+    return left_sum;
+}
+
+} // namespace
+
+BVH::BVH(const std::vector<Primitive*>& _primitives, const BVHBuildOptions& options)
+    : leaves{ _primitives }
+    , options{ options }
+{
+    if (options.method == BVHBuildMethod::LBVH)
+    {
+        BuildLinear(options.treelet_optimization);
+        leaves.BuildTriangles();
+        return;
+    }
+
+    size_t primitive_count = leaves.primitives.size();
     std::vector<BVHPrimitive> bvh_primitives(primitive_count);
     for (size_t i = 0; i < primitive_count; ++i)
     {
-        bvh_primitives[i] = BVHPrimitive(i, primitives[i]->GetAABB());
+        bvh_primitives[i] = BVHPrimitive(i, leaves.primitives[i]->GetAABB());
     }
 
-    std::vector<Primitive*> ordered_prims(primitive_count);
-
     std::atomic<int32> total_nodes(0);
     std::atomic<int32> ordered_prims_offset(0);
 
@@ -29,30 +137,47 @@ BVH::BVH(const std::vector<Primitive*>& _primitives)
         return Allocator(ptr);
     });
 
-    BuildNode* root = BuildRecursive(
-        thread_allocators, std::span<BVHPrimitive>(bvh_primitives), &total_nodes, &ordered_prims_offset, ordered_prims
-    );
+    BuildNode* root;
+    std::vector<Primitive*> ordered_prims;
+
+    if (options.method == BVHBuildMethod::SBVH)
+    {
+        root = BuildSpatial(
+            thread_allocators, bvh_primitives, &total_nodes, &ordered_prims_offset, ordered_prims, options.spatial_split_budget
+        );
+    }
+    else
+    {
+        ordered_prims.resize(primitive_count);
+
+        root = BuildRecursive(
+            thread_allocators, std::span<BVHPrimitive>(bvh_primitives), &total_nodes, &ordered_prims_offset, ordered_prims
+        );
 
-    BulbitAssert(size_t(ordered_prims_offset.load()) == primitive_count);
+        BulbitAssert(size_t(ordered_prims_offset.load()) == primitive_count);
+    }
 
-    primitives.swap(ordered_prims);
+    leaves.primitives.swap(ordered_prims);
 
     // Release temporary data
     bvh_primitives.resize(0);
     bvh_primitives.shrink_to_fit();
 
-    nodes = new LinearBVHNode[total_nodes];
+    node_count = total_nodes;
+    nodes = new LinearBVHNode[node_count];
     int32 offset = 0;
 
     // Flatten out to linear BVH representation
     FlattenBVH(root, &offset);
 
-    BulbitAssert(offset == total_nodes);
+    BulbitAssert(offset == node_count);
+
+    leaves.BuildTriangles();
 }
 
 BVH::~BVH() noexcept
 {
-    delete nodes;
+    delete[] nodes;
 }
 
 BVH::BuildNode* BVH::BuildRecursive(
@@ -69,10 +194,43 @@ BVH::BuildNode* BVH::BuildRecursive(
     total_nodes->fetch_add(1);
     int32 primitive_count = int32(primitive_span.size());
 
-    AABB span_bounds;
-    for (const BVHPrimitive& prim : primitive_span)
+    // Bin and partition the upper levels across all workers, the lower levels are built as independent subtree tasks
+    const bool parallel = primitive_count > parallel_build_threshold && ThreadPool::global_thread_pool;
+
+    AABB span_bounds, centroid_bounds;
+    if (parallel)
+    {
+        struct Bounds
+        {
+            AABB aabb, centroid;
+        };
+
+        Bounds bounds = ParallelReduce(
+            primitive_span.size(), Bounds{},
+            [&](size_t begin, size_t end) {
+                Bounds b;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    b.aabb = AABB::Union(b.aabb, primitive_span[i].aabb);
+                    b.centroid = AABB::Union(b.centroid, primitive_span[i].aabb.GetCenter());
+                }
+                return b;
+            },
+            [](const Bounds& b1, const Bounds& b2) {
+                return Bounds{ AABB::Union(b1.aabb, b2.aabb), AABB::Union(b1.centroid, b2.centroid) };
+            }
+        );
+
+        span_bounds = bounds.aabb;
+        centroid_bounds = bounds.centroid;
+    }
+    else
     {
-        span_bounds = AABB::Union(span_bounds, prim.aabb);
+        for (const BVHPrimitive& prim : primitive_span)
+        {
+            span_bounds = AABB::Union(span_bounds, prim.aabb);
+            centroid_bounds = AABB::Union(centroid_bounds, prim.aabb.GetCenter());
+        }
     }
 
     if (span_bounds.GetSurfaceArea() == 0 || primitive_count == 1)
@@ -81,19 +239,13 @@ BVH::BuildNode* BVH::BuildRecursive(
         for (int32 i = 0; i < primitive_count; ++i)
         {
             int32 index = int32(primitive_span[i].index);
-            ordered_prims[offset + i] = primitives[index];
+            ordered_prims[offset + i] = leaves.primitives[index];
         }
 
         node->InitLeaf(offset, primitive_count, span_bounds);
         return node;
     }
 
-    AABB centroid_bounds;
-    for (const BVHPrimitive& prim : primitive_span)
-    {
-        centroid_bounds = AABB::Union(centroid_bounds, prim.aabb.GetCenter());
-    }
-
     // Get the longest extent
     int32 axis = 0;
 
@@ -116,7 +268,7 @@ BVH::BuildNode* BVH::BuildRecursive(
         for (int32 i = 0; i < primitive_count; ++i)
         {
             int32 index = int32(primitive_span[i].index);
-            ordered_prims[offset + i] = primitives[index];
+            ordered_prims[offset + i] = leaves.primitives[index];
         }
 
         node->InitLeaf(offset, primitive_count, span_bounds);
@@ -161,21 +313,58 @@ BVH::BuildNode* BVH::BuildRecursive(
 
         constexpr int32 bucket_size = 12;
         constexpr int32 split_planes = bucket_size - 1;
-        BVHSplitBucket buckets[bucket_size];
 
-        // Fill the buckets for
-        for (const BVHPrimitive& primitive : primitive_span)
-        {
+        auto get_bucket_index = [&](const BVHPrimitive& primitive) {
             int32 bucket_index = int32(bucket_size * (primitive.aabb.GetCenter() - centroid_bounds.min)[axis] / extent);
             if (bucket_index == bucket_size)
             {
-                bucket_index = bucket_index - 1;
+                bucket_index = bucket_size - 1;
+            }
+
+            return bucket_index;
+        };
+
+        struct BVHSplitBuckets
+        {
+            BVHSplitBucket buckets[bucket_size];
+        };
+
+        // Fill the buckets for
+        auto fill_buckets = [&](size_t begin, size_t end) {
+            BVHSplitBuckets b;
+            for (size_t i = begin; i < end; ++i)
+            {
+                int32 bucket_index = get_bucket_index(primitive_span[i]);
+
+                b.buckets[bucket_index].count++;
+                b.buckets[bucket_index].bounds = AABB::Union(b.buckets[bucket_index].bounds, primitive_span[i].aabb);
             }
+            return b;
+        };
 
-            buckets[bucket_index].count++;
-            buckets[bucket_index].bounds = AABB::Union(buckets[bucket_index].bounds, primitive.aabb);
+        BVHSplitBuckets split_buckets;
+        if (parallel)
+        {
+            split_buckets = ParallelReduce(
+                primitive_span.size(), BVHSplitBuckets{}, fill_buckets,
+                [](const BVHSplitBuckets& b1, const BVHSplitBuckets& b2) {
+                    BVHSplitBuckets b;
+                    for (int32 i = 0; i < bucket_size; ++i)
+                    {
+                        b.buckets[i].count = b1.buckets[i].count + b2.buckets[i].count;
+                        b.buckets[i].bounds = AABB::Union(b1.buckets[i].bounds, b2.buckets[i].bounds);
+                    }
+                    return b;
+                }
+            );
+        }
+        else
+        {
+            split_buckets = fill_buckets(0, primitive_span.size());
         }
 
+        const BVHSplitBucket* buckets = split_buckets.buckets;
+
         AABB left_bound, right_bound;
         int32 left_count[split_planes], right_count[split_planes];
         Float left_area[split_planes], right_area[split_planes];
@@ -206,24 +395,23 @@ BVH::BuildNode* BVH::BuildRecursive(
             }
         }
 
-        constexpr Float traverse_cost = 0.5f;
         min_cost = traverse_cost + min_cost / span_bounds.GetSurfaceArea();
 
         const Float direct_leaf_cost = Float(primitive_count);
 
         if (min_cost < direct_leaf_cost)
         {
-            auto mid_iter = std::partition(primitive_span.begin(), primitive_span.end(), [=](const BVHPrimitive& prim) {
-                int32 bucket_index = int32(bucket_size * (prim.aabb.GetCenter() - centroid_bounds.min)[axis] / extent);
-                if (bucket_index == bucket_size)
-                {
-                    bucket_index = bucket_size - 1;
-                }
-
-                return bucket_index <= min_cost_split_bucket;
-            });
+            auto is_left = [&](const BVHPrimitive& prim) { return get_bucket_index(prim) <= min_cost_split_bucket; };
 
-            mid = int32(mid_iter - primitive_span.begin());
+            if (parallel)
+            {
+                mid = int32(ParallelPartition(primitive_span, is_left));
+            }
+            else
+            {
+                auto mid_iter = std::partition(primitive_span.begin(), primitive_span.end(), is_left);
+                mid = int32(mid_iter - primitive_span.begin());
+            }
         }
         else
         {
@@ -231,7 +419,7 @@ BVH::BuildNode* BVH::BuildRecursive(
             for (int32 i = 0; i < primitive_count; ++i)
             {
                 int32 index = int32(primitive_span[i].index);
-                ordered_prims[offset + i] = primitives[index];
+                ordered_prims[offset + i] = leaves.primitives[index];
             }
 
             node->InitLeaf(offset, primitive_count, span_bounds);
@@ -243,7 +431,7 @@ BVH::BuildNode* BVH::BuildRecursive(
     BuildNode* child1;
     BuildNode* child2;
 
-    if (primitive_count > 64 * 1024)
+    if (parallel)
     {
         ParallelFor(0, 2, [&](int i) {
             if (i == 0)
@@ -298,68 +486,464 @@ int32 BVH::FlattenBVH(BuildNode* node, int32* offset)
     return node_offset;
 }
 
-bool BVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+void BVHLeaves::BuildTriangles()
+{
+    size_t primitive_count = primitives.size();
+    types.resize(primitive_count);
+    triangles.resize(primitive_count);
+
+    ParallelFor(0, int32(primitive_count), [&](int32 i) {
+        const Triangle* triangle = dynamic_cast<const Triangle*>(primitives[i]->GetShape());
+        if (!triangle)
+        {
+            types[i] = generic;
+            return;
+        }
+
+        const Material* material = primitives[i]->GetMaterial();
+        types[i] = (material && material->HasAlpha()) ? alpha_tested_triangle : opaque_triangle;
+
+        TriangleVertices& tri = triangles[i];
+        triangle->GetVertices(&tri.p[0], &tri.p[1], &tri.p[2]);
+    });
+}
+
+BVHLeaves BVHLeaves::Gather(std::span<const int32> indices) const
+{
+    BVHLeaves gathered;
+    gathered.primitives.resize(indices.size());
+    gathered.types.resize(indices.size());
+    gathered.triangles.resize(indices.size());
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        int32 index = indices[i];
+        gathered.primitives[i] = primitives[index];
+        gathered.types[i] = types[index];
+        gathered.triangles[i] = triangles[index];
+    }
+
+    return gathered;
+}
+
+uint32 BVHLeaves::IntersectTriangles(
+    int32 index, int32 count, const TriangleIntersector& intersector, Float t_min, Float t_max, Float* t, Float* u, Float* v
+) const
+{
+    const Point3* vertices[triangle_batch_size];
+    for (int32 i = 0; i < count; ++i)
+    {
+        vertices[i] = triangles[index + i].p;
+    }
+
+    return intersector.Intersect4(vertices, count, t_min, t_max, t, u, v);
+}
+
+Float BVHLeaves::ClosestHitCallback::RayCastLeafCallback(const Ray& ray, Float t_min, Float t_max, int32 offset, int32 count)
 {
-    struct Callback
+    const int32 end = offset + count;
+    for (int32 i = offset; i < end;)
     {
-        Intersection* closest;
-        bool hit_closest;
-        Float t;
+        int32 run = 0;
+        while (run < triangle_batch_size && i + run < end && leaves->types[i + run] == opaque_triangle)
+        {
+            ++run;
+        }
+
+        // Single opaque triangles and the other primitives are tested one by one
+        if (run < 2)
+        {
+            t_max = RayCastCallback(ray, t_min, t_max, i);
+            ++i;
+            continue;
+        }
 
-        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        Float tri_t[triangle_batch_size], tri_u[triangle_batch_size], tri_v[triangle_batch_size];
+        uint32 mask = leaves->IntersectTriangles(i, run, intersector, t_min, t_max, tri_t, tri_u, tri_v);
+        while (mask)
         {
-            Intersection isect;
-            bool hit = object->Intersect(&isect, ray, t_min, t_max);
+            int32 lane = std::countr_zero(mask);
+            mask &= mask - 1;
 
-            if (hit)
+            if (tri_t[lane] <= t)
             {
-                BulbitAssert(isect.t <= t);
                 hit_closest = true;
-                t = isect.t;
-                *closest = isect;
+                t = tri_t[lane];
+                closest_triangle = i + lane;
+                u = tri_u[lane];
+                v = tri_v[lane];
             }
+        }
+
+        t_max = t;
+        i += run;
+    }
+
+    return t;
+}
 
-            // Keep traverse with smaller bounds
-            return t;
+Float BVHLeaves::AnyHitCallback::RayCastLeafCallback(const Ray& ray, Float t_min, Float t_max, int32 offset, int32 count)
+{
+    const int32 end = offset + count;
+    for (int32 i = offset; i < end;)
+    {
+        int32 run = 0;
+        while (run < triangle_batch_size && i + run < end && leaves->types[i + run] == opaque_triangle)
+        {
+            ++run;
         }
-    } callback;
 
-    callback.closest = isect;
-    callback.hit_closest = false;
-    callback.t = t_max;
+        // Single opaque triangles and the other primitives are tested one by one
+        if (run < 2)
+        {
+            if (RayCastCallback(ray, t_min, t_max, i) <= t_min)
+            {
+                return t_min;
+            }
+
+            ++i;
+            continue;
+        }
+
+        Float tri_t[triangle_batch_size], tri_u[triangle_batch_size], tri_v[triangle_batch_size];
+        if (leaves->IntersectTriangles(i, run, intersector, t_min, t_max, tri_t, tri_u, tri_v))
+        {
+            hit_any = true;
+
+            // Stop traversal
+            return t_min;
+        }
+
+        i += run;
+    }
+
+    return t_max;
+}
+
+bool BVHLeaves::ClosestHitCallback::Finish(const Ray& ray)
+{
+    if (closest_triangle >= 0)
+    {
+        const Primitive* primitive = leaves->primitives[closest_triangle];
+        const Triangle* triangle = static_cast<const Triangle*>(primitive->GetShape());
+
+        triangle->SetIntersection(closest, ray, t, u, v);
+        closest->primitive = primitive;
+    }
+
+    return hit_closest;
+}
+
+bool BVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    BulbitStatQuery(Stat::closest_hit_queries, 1);
+
+    BVHLeaves::ClosestHitCallback callback;
+    callback.Init(&leaves, isect, ray, t_max);
 
     RayCast(ray, t_min, t_max, &callback);
 
-    return callback.hit_closest;
+    return callback.Finish(ray);
 }
 
 bool BVH::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
 {
-    struct Callback
+    BulbitStatQuery(Stat::any_hit_queries, 1);
+
+    BVHLeaves::AnyHitCallback callback;
+    callback.Init(&leaves, ray);
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+void BVH::IntersectBatch(
+    std::span<Intersection> isects, std::span<bool> hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+) const
+{
+    BulbitAssert(isects.size() == rays.size() && hits.size() == rays.size() && t_max.size() == rays.size());
+    BulbitStatQuery(Stat::closest_hit_queries, rays.size());
+
+    for (size_t begin = 0; begin < rays.size(); begin += packet_size)
+    {
+        int32 count = int32(std::min<size_t>(packet_size, rays.size() - begin));
+
+        BVHLeaves::ClosestHitCallback callbacks[packet_size];
+        Float packet_t_max[packet_size];
+        for (int32 i = 0; i < count; ++i)
+        {
+            callbacks[i].Init(&leaves, &isects[begin + i], rays[begin + i], t_max[begin + i]);
+            packet_t_max[i] = t_max[begin + i];
+        }
+
+        RayCastPacket(rays.subspan(begin, count), t_min, packet_t_max, callbacks);
+
+        for (int32 i = 0; i < count; ++i)
+        {
+            hits[begin + i] = callbacks[i].Finish(rays[begin + i]);
+        }
+    }
+}
+
+void BVH::IntersectAnyBatch(std::span<bool> hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max) const
+{
+    BulbitAssert(hits.size() == rays.size() && t_max.size() == rays.size());
+    BulbitStatQuery(Stat::any_hit_queries, rays.size());
+
+    for (size_t begin = 0; begin < rays.size(); begin += packet_size)
     {
-        bool hit_any;
+        int32 count = int32(std::min<size_t>(packet_size, rays.size() - begin));
+
+        BVHLeaves::AnyHitCallback callbacks[packet_size];
+        Float packet_t_max[packet_size];
+        for (int32 i = 0; i < count; ++i)
+        {
+            callbacks[i].Init(&leaves, rays[begin + i]);
+            packet_t_max[i] = t_max[begin + i];
+        }
 
-        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, Intersectable* object)
+        RayCastPacket(rays.subspan(begin, count), t_min, packet_t_max, callbacks);
+
+        for (int32 i = 0; i < count; ++i)
         {
-            bool hit = object->IntersectAny(ray, t_min, t_max);
+            hits[begin + i] = callbacks[i].hit_any;
+        }
+    }
+}
+
+// Packet traversal for coherent rays.
+// Whole subtrees are culled with an interval arithmetic bound over every ray in the packet,
+// and each node is entered from the first ray that actually hits it (Wald et al. 2007).
+// Packets whose direction signs disagree cannot share the traversal order, they fall back to single ray traversal.
+// So do the packets whose rays turn out to barely share any leaves.
+template <typename T>
+void BVH::RayCastPacket(std::span<const Ray> rays, Float t_min, Float* t_max, T* callbacks) const
+{
+    const int32 count = int32(rays.size());
+    BulbitAssert(count <= packet_size);
+
+    Vec3 inv_dir[packet_size];
+    bool active[packet_size];
+
+    const int32 is_dir_neg[3] = { int32(rays[0].d.x < 0), int32(rays[0].d.y < 0), int32(rays[0].d.z < 0) };
+
+    // Interval bounds of the origins and inverse directions
+    Vec3 o_min(infinity), o_max(-infinity);
+    Vec3 inv_min(infinity), inv_max(-infinity);
 
-            if (hit)
+    bool coherent = true;
+    for (int32 i = 0; i < count; ++i)
+    {
+        const Ray& r = rays[i];
+        inv_dir[i].Set(1 / r.d.x, 1 / r.d.y, 1 / r.d.z);
+        active[i] = true;
+
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            if (int32(inv_dir[i][axis] < 0) != is_dir_neg[axis] || !std::isfinite(inv_dir[i][axis]))
             {
-                hit_any = true;
+                coherent = false;
+            }
+        }
 
-                // Stop traversal
-                return t_min;
+        o_min = Min(o_min, r.o);
+        o_max = Max(o_max, r.o);
+        inv_min = Min(inv_min, inv_dir[i]);
+        inv_max = Max(inv_max, inv_dir[i]);
+    }
+
+    if (!coherent)
+    {
+        for (int32 i = 0; i < count; ++i)
+        {
+            RayCast(rays[i], t_min, t_max[i], &callbacks[i]);
+        }
+        return;
+    }
+
+    Float packet_t_max = -infinity;
+    for (int32 i = 0; i < count; ++i)
+    {
+        packet_t_max = std::max(packet_t_max, t_max[i]);
+    }
+
+    // Conservative test, fails only if none of the rays in the packet can hit the box
+    auto test_packet = [&](const AABB& aabb) -> bool {
+        Float t_enter = t_min;
+        Float t_exit = packet_t_max;
+
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            Float near_plane = aabb[is_dir_neg[axis]][axis];
+            Float far_plane = aabb[1 - is_dir_neg[axis]][axis];
+
+            // Interval product of [plane - o_max, plane - o_min] * [inv_min, inv_max]
+            Float n0 = (near_plane - o_max[axis]) * inv_min[axis];
+            Float n1 = (near_plane - o_max[axis]) * inv_max[axis];
+            Float n2 = (near_plane - o_min[axis]) * inv_min[axis];
+            Float n3 = (near_plane - o_min[axis]) * inv_max[axis];
+
+            Float f0 = (far_plane - o_max[axis]) * inv_min[axis];
+            Float f1 = (far_plane - o_max[axis]) * inv_max[axis];
+            Float f2 = (far_plane - o_min[axis]) * inv_min[axis];
+            Float f3 = (far_plane - o_min[axis]) * inv_max[axis];
+
+            t_enter = std::max(t_enter, std::min(std::min(n0, n1), std::min(n2, n3)));
+            t_exit = std::min(t_exit, std::max(std::max(f0, f1), std::max(f2, f3)));
+        }
+
+        return t_enter <= t_exit;
+    };
+
+    struct StackEntry
+    {
+        int32 index;
+        int32 first;
+    };
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, 0);
+
+    // Counters for detecting packets that turn out to be incoherent at the leaves
+    int32 leaf_visits = 0;
+    int32 leaf_ray_hits = 0;
+
+    while (stack.Count() > 0)
+    {
+        if (leaf_visits == incoherent_check_leaves && leaf_ray_hits < incoherent_check_leaves * min_rays_per_leaf)
+        {
+            // Rays rarely share leaves, finish the remaining rays one by one with their shortened intervals
+            for (int32 r = 0; r < count; ++r)
+            {
+                if (active[r])
+                {
+                    RayCast(rays[r], t_min, t_max[r], &callbacks[r]);
+                }
             }
+            return;
+        }
+
+        StackEntry entry = stack.Pop();
+        const LinearBVHNode& node = nodes[entry.index];
+
+        // A test of the whole packet counts as one visit
+        BulbitStatIncrement(Stat::bvh_nodes_visited);
+
+        if (!test_packet(node.aabb))
+        {
+            continue;
+        }
 
-            return t_max;
+        // Find the first active ray that hits the node
+        int32 first = entry.first;
+        while (first < count &&
+               (!active[first] || !node.aabb.TestRay(rays[first].o, t_min, t_max[first], inv_dir[first], is_dir_neg)))
+        {
+            ++first;
         }
-    } callback;
 
-    callback.hit_any = false;
+        if (first == count)
+        {
+            continue;
+        }
 
-    RayCast(ray, t_min, t_max, &callback);
+        if (node.primitive_count > 0)
+        {
+            // Leaf node
+            for (int32 r = first; r < count; ++r)
+            {
+                if (!active[r])
+                {
+                    continue;
+                }
 
-    return callback.hit_any;
+                if (r != first && !node.aabb.TestRay(rays[r].o, t_min, t_max[r], inv_dir[r], is_dir_neg))
+                {
+                    continue;
+                }
+
+                ++leaf_ray_hits;
+                BulbitStatAdd(Stat::bvh_primitive_tests, node.primitive_count);
+
+                Float t =
+                    callbacks[r].RayCastLeafCallback(rays[r], t_min, t_max[r], node.primitives_offset, node.primitive_count);
+                if (t <= t_min)
+                {
+                    active[r] = false;
+                }
+                else
+                {
+                    // Shorten the ray
+                    t_max[r] = t;
+                }
+            }
+
+            ++leaf_visits;
+
+            // Tighten the packet interval
+            packet_t_max = -infinity;
+            for (int32 r = 0; r < count; ++r)
+            {
+                if (active[r])
+                {
+                    packet_t_max = std::max(packet_t_max, t_max[r]);
+                }
+            }
+        }
+        else
+        {
+            // Internal node
+
+            // Ordered traversal
+            // Put far child on stack first
+            int32 child1 = entry.index + 1;
+            int32 child2 = node.child2_offset;
+
+            if (is_dir_neg[node.axis])
+            {
+                stack.Emplace(child1, first);
+                stack.Emplace(child2, first);
+            }
+            else
+            {
+                stack.Emplace(child2, first);
+                stack.Emplace(child1, first);
+            }
+        }
+    }
+}
+
+// Expected cost of a random ray query relative to the root, with the same traversal cost used by the builders
+Float BVH::GetSAHCost() const
+{
+    Float root_area = nodes[0].aabb.GetSurfaceArea();
+    if (root_area == 0)
+    {
+        return Float(nodes[0].primitive_count);
+    }
+
+    return GetSubtreeCost(0, node_count) / root_area;
+}
+
+// Surface area weighted cost of the nodes in [begin, end), not normalized
+Float BVH::GetSubtreeCost(int32 begin, int32 end) const
+{
+    Float cost = 0;
+    for (int32 i = begin; i < end; ++i)
+    {
+        Float area = nodes[i].aabb.GetSurfaceArea();
+        if (nodes[i].primitive_count > 0)
+        {
+            cost += area * nodes[i].primitive_count;
+        }
+        else
+        {
+            cost += area * traverse_cost;
+        }
+    }
+
+    return cost;
 }
 
 AABB BVH::GetAABB() const
@@ -0,0 +1,567 @@
+#include "bulbit/bvh.h"
+#include "bulbit/parallel_for.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace bulbit
+{
+
+// Linear BVH (LBVH)
+// Primitives are sorted along the Morton curve of their centroids and each node splits its range
+// at the highest bit where the codes differ, so the build is a parallel radix sort followed by a linear pass.
+// https://research.nvidia.com/publication/2012-06_maximizing-parallelism-construction-bvhs-octrees-and-k-d-trees
+//
+// The optional treelet pass restores most of the SAH quality by rebuilding small treelets with their optimal topology.
+// https://research.nvidia.com/publication/2013-07_fast-parallel-construction-high-quality-bounding-volume-hierarchies
+
+namespace
+{
+
+constexpr int32 morton_bits = 10;
+constexpr int32 radix_bits = 10;
+constexpr int32 radix_bucket_count = 1 << radix_bits;
+constexpr int32 radix_pass_count = 3 * morton_bits / radix_bits;
+
+constexpr int32 sort_chunk_size = 16 * 1024;
+
+// Subtrees smaller than this are processed on the calling thread
+constexpr int32 parallel_subtree_threshold = 4 * 1024;
+
+constexpr int32 treelet_leaf_count = 7;
+constexpr int32 treelet_subset_count = 1 << treelet_leaf_count;
+
+constexpr int32 max_leaf_primitives = 8;
+
+struct MortonPrimitive
+{
+    uint32 code;
+    int32 index;
+};
+
+// Inserts two zero bits between each of the lower 10 bits
+uint32 LeftShift3(uint32 x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x30000ff;
+    x = (x | (x << 8)) & 0x300f00f;
+    x = (x | (x << 4)) & 0x30c30c3;
+    x = (x | (x << 2)) & 0x9249249;
+    return x;
+}
+
+uint32 EncodeMorton3(const Vec3& v)
+{
+    const Float scale = 1 << morton_bits;
+    uint32 x = uint32(Clamp(v.x * scale, Float(0), scale - 1));
+    uint32 y = uint32(Clamp(v.y * scale, Float(0), scale - 1));
+    uint32 z = uint32(Clamp(v.z * scale, Float(0), scale - 1));
+
+    return (LeftShift3(z) << 2) | (LeftShift3(y) << 1) | LeftShift3(x);
+}
+
+int32 GetSortChunkCount(size_t count)
+{
+    return int32((count + sort_chunk_size - 1) / sort_chunk_size);
+}
+
+// Least significant digit radix sort, each pass counts and scatters the chunks in parallel
+void RadixSort(std::vector<MortonPrimitive>& primitives)
+{
+    const size_t count = primitives.size();
+    const int32 chunk_count = GetSortChunkCount(count);
+
+    std::vector<MortonPrimitive> sorted(count);
+    std::vector<int32> offsets(size_t(chunk_count) * radix_bucket_count);
+
+    for (int32 pass = 0; pass < radix_pass_count; ++pass)
+    {
+        const int32 shift = pass * radix_bits;
+        auto get_bucket = [shift](const MortonPrimitive& p) { return (p.code >> shift) & (radix_bucket_count - 1); };
+
+        ParallelFor(0, chunk_count, [&](int32 chunk) {
+            int32* histogram = &offsets[size_t(chunk) * radix_bucket_count];
+            std::fill(histogram, histogram + radix_bucket_count, 0);
+
+            size_t begin = size_t(chunk) * sort_chunk_size;
+            size_t end = std::min(begin + sort_chunk_size, count);
+            for (size_t i = begin; i < end; ++i)
+            {
+                histogram[get_bucket(primitives[i])]++;
+            }
+        });
+
+        // Each chunk writes its part of a bucket after the same bucket of the preceding chunks, which keeps the sort stable
+        int32 sum = 0;
+        for (int32 bucket = 0; bucket < radix_bucket_count; ++bucket)
+        {
+            for (int32 chunk = 0; chunk < chunk_count; ++chunk)
+            {
+                int32& offset = offsets[size_t(chunk) * radix_bucket_count + bucket];
+                int32 bucket_count = offset;
+                offset = sum;
+                sum += bucket_count;
+            }
+        }
+
+        ParallelFor(0, chunk_count, [&](int32 chunk) {
+            int32* offset = &offsets[size_t(chunk) * radix_bucket_count];
+
+            size_t begin = size_t(chunk) * sort_chunk_size;
+            size_t end = std::min(begin + sort_chunk_size, count);
+            for (size_t i = begin; i < end; ++i)
+            {
+                sorted[offset[get_bucket(primitives[i])]++] = primitives[i];
+            }
+        });
+
+        primitives.swap(sorted);
+    }
+}
+
+} // namespace
+
+struct BVH::LinearBuild
+{
+    // Binary tree with a single primitive per leaf, stored so that the subtree of a range [begin, end) at index i
+    // occupies [i, i + 2 * (end - begin) - 1), which lets both children be built independently
+    struct Node
+    {
+        AABB aabb;
+
+        // Leaf nodes have no children and reference the primitive in the unsorted order
+        int32 children[2];
+        int32 primitive;
+
+        // Number of primitives below this node
+        int32 primitive_count;
+
+        // Surface area weighted SAH cost of the subtree
+        Float cost;
+
+        // Number of nodes of the subtree once it is flattened
+        int32 flat_count;
+
+        // Whether the subtree is flattened into a single leaf
+        bool collapse;
+
+        bool IsLeaf() const
+        {
+            return children[0] < 0;
+        }
+    };
+
+    BVH* bvh;
+    std::vector<AABB> aabbs;
+    std::vector<MortonPrimitive> morton_primitives;
+    std::vector<Node> nodes;
+
+    std::vector<Primitive*> ordered_prims;
+
+    void BuildHierarchy(int32 index, int32 begin, int32 end);
+    void UpdateCost(Node& node) const;
+    void Restructure(int32 index, bool treelet_optimization);
+    void RestructureTreelet(Node& root);
+    void Emit(int32 index, int32 flat_offset, int32 primitives_offset);
+    void GatherPrimitives(int32 index, int32* primitives_offset);
+};
+
+void BVH::BuildLinear(bool treelet_optimization)
+{
+    const int32 primitive_count = int32(leaves.primitives.size());
+    if (primitive_count == 0)
+    {
+        // Empty bounds never intersect
+        node_count = 1;
+        nodes = new LinearBVHNode[node_count];
+        nodes[0].aabb = AABB();
+        nodes[0].primitives_offset = 0;
+        nodes[0].primitive_count = 0;
+        nodes[0].child2_offset = 0;
+        return;
+    }
+
+    LinearBuild build;
+    build.bvh = this;
+    build.aabbs.resize(primitive_count);
+
+    // Primitive bounds and the centroid bounds for the Morton code quantization
+    const int32 chunk_count = GetSortChunkCount(primitive_count);
+    std::vector<AABB> chunk_centroid_bounds(chunk_count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 begin = chunk * sort_chunk_size;
+        int32 end = std::min(begin + sort_chunk_size, primitive_count);
+
+        AABB centroid_bounds;
+        for (int32 i = begin; i < end; ++i)
+        {
+            build.aabbs[i] = leaves.primitives[i]->GetAABB();
+            centroid_bounds = AABB::Union(centroid_bounds, build.aabbs[i].GetCenter());
+        }
+
+        chunk_centroid_bounds[chunk] = centroid_bounds;
+    });
+
+    AABB centroid_bounds;
+    for (const AABB& bounds : chunk_centroid_bounds)
+    {
+        centroid_bounds = AABB::Union(centroid_bounds, bounds);
+    }
+
+    Vec3 extents = centroid_bounds.GetExtents();
+    Vec3 inv_extents(
+        extents.x > 0 ? 1 / extents.x : 0, extents.y > 0 ? 1 / extents.y : 0, extents.z > 0 ? 1 / extents.z : 0
+    );
+
+    build.morton_primitives.resize(primitive_count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 begin = chunk * sort_chunk_size;
+        int32 end = std::min(begin + sort_chunk_size, primitive_count);
+
+        for (int32 i = begin; i < end; ++i)
+        {
+            Vec3 offset = build.aabbs[i].GetCenter() - centroid_bounds.min;
+            build.morton_primitives[i].code = EncodeMorton3(offset * inv_extents);
+            build.morton_primitives[i].index = i;
+        }
+    });
+
+    RadixSort(build.morton_primitives);
+
+    build.nodes.resize(2 * size_t(primitive_count) - 1);
+    build.BuildHierarchy(0, 0, primitive_count);
+
+    // Compute the subtree costs bottom up, restructuring the treelets on the way if requested
+    build.Restructure(0, treelet_optimization);
+
+    node_count = build.nodes[0].flat_count;
+    nodes = new LinearBVHNode[node_count];
+
+    build.ordered_prims.resize(primitive_count);
+    build.Emit(0, 0, 0);
+
+    leaves.primitives.swap(build.ordered_prims);
+}
+
+void BVH::LinearBuild::BuildHierarchy(int32 index, int32 begin, int32 end)
+{
+    Node& node = nodes[index];
+    node.collapse = false;
+
+    if (end - begin == 1)
+    {
+        int32 primitive = morton_primitives[begin].index;
+
+        node.aabb = aabbs[primitive];
+        node.children[0] = -1;
+        node.children[1] = -1;
+        node.primitive = primitive;
+        node.primitive_count = 1;
+        return;
+    }
+
+    // Split where the highest differing bit of the range flips, or in the middle if all codes are equal
+    uint32 first_code = morton_primitives[begin].code;
+    uint32 last_code = morton_primitives[end - 1].code;
+
+    int32 split;
+    if (first_code == last_code)
+    {
+        split = (begin + end) / 2;
+    }
+    else
+    {
+        uint32 split_bit = std::bit_floor(first_code ^ last_code);
+        auto iter = std::partition_point(
+            morton_primitives.begin() + begin, morton_primitives.begin() + end,
+            [split_bit](const MortonPrimitive& p) { return (p.code & split_bit) == 0; }
+        );
+        split = int32(iter - morton_primitives.begin());
+    }
+
+    node.children[0] = index + 1;
+    node.children[1] = index + 2 * (split - begin);
+    node.primitive = -1;
+    node.primitive_count = end - begin;
+
+    if (end - begin > parallel_subtree_threshold)
+    {
+        ParallelFor(0, 2, [&](int32 i) {
+            if (i == 0)
+            {
+                BuildHierarchy(node.children[0], begin, split);
+            }
+            else
+            {
+                BuildHierarchy(node.children[1], split, end);
+            }
+        });
+    }
+    else
+    {
+        BuildHierarchy(node.children[0], begin, split);
+        BuildHierarchy(node.children[1], split, end);
+    }
+
+    node.aabb = AABB::Union(nodes[node.children[0]].aabb, nodes[node.children[1]].aabb);
+}
+
+// Picks the cheaper of splitting and collapsing the node into a leaf, the children costs must be up to date
+void BVH::LinearBuild::UpdateCost(Node& node) const
+{
+    Float area = node.aabb.GetSurfaceArea();
+
+    if (node.IsLeaf())
+    {
+        node.cost = area;
+        node.flat_count = 1;
+        node.collapse = false;
+        return;
+    }
+
+    const Node& child1 = nodes[node.children[0]];
+    const Node& child2 = nodes[node.children[1]];
+
+    node.cost = traverse_cost * area + child1.cost + child2.cost;
+    node.flat_count = 1 + child1.flat_count + child2.flat_count;
+    node.collapse = false;
+
+    Float leaf_cost = area * node.primitive_count;
+    if (node.primitive_count <= max_leaf_primitives && leaf_cost <= node.cost)
+    {
+        node.cost = leaf_cost;
+        node.flat_count = 1;
+        node.collapse = true;
+    }
+}
+
+void BVH::LinearBuild::Restructure(int32 index, bool treelet_optimization)
+{
+    Node& node = nodes[index];
+    if (!node.IsLeaf())
+    {
+        if (node.primitive_count > parallel_subtree_threshold)
+        {
+            ParallelFor(0, 2, [&](int32 i) { Restructure(node.children[i], treelet_optimization); });
+        }
+        else
+        {
+            Restructure(node.children[0], treelet_optimization);
+            Restructure(node.children[1], treelet_optimization);
+        }
+
+        // Smaller subtrees are covered entirely by the treelets of their ancestors
+        if (treelet_optimization && node.primitive_count >= treelet_leaf_count)
+        {
+            RestructureTreelet(node);
+            return;
+        }
+    }
+
+    UpdateCost(node);
+}
+
+// Grows a treelet below the root by expanding its largest leaves, then rebuilds the treelet with the topology
+// that minimizes the SAH cost, found by dynamic programming over all subsets of the treelet leaves.
+// The treelet internal nodes are reused for the new topology, the subtrees below the treelet leaves are kept as is.
+void BVH::LinearBuild::RestructureTreelet(Node& root)
+{
+    int32 leaves[treelet_leaf_count];
+    int32 internals[treelet_leaf_count - 1];
+
+    int32 leaf_count = 2;
+    int32 internal_count = 1;
+    leaves[0] = root.children[0];
+    leaves[1] = root.children[1];
+    internals[0] = int32(&root - nodes.data());
+
+    while (leaf_count < treelet_leaf_count)
+    {
+        int32 largest = -1;
+        Float largest_area = -1;
+        for (int32 i = 0; i < leaf_count; ++i)
+        {
+            const Node& leaf = nodes[leaves[i]];
+            if (leaf.IsLeaf() || leaf.collapse)
+            {
+                continue;
+            }
+
+            Float area = leaf.aabb.GetSurfaceArea();
+            if (area > largest_area)
+            {
+                largest = i;
+                largest_area = area;
+            }
+        }
+
+        if (largest < 0)
+        {
+            break;
+        }
+
+        const Node& expanded = nodes[leaves[largest]];
+        internals[internal_count++] = leaves[largest];
+        leaves[largest] = expanded.children[0];
+        leaves[leaf_count++] = expanded.children[1];
+    }
+
+    AABB bounds[treelet_subset_count];
+    Float costs[treelet_subset_count];
+    int32 counts[treelet_subset_count];
+    int32 partitions[treelet_subset_count];
+    bool collapses[treelet_subset_count];
+
+    for (int32 i = 0; i < leaf_count; ++i)
+    {
+        const Node& leaf = nodes[leaves[i]];
+
+        int32 subset = 1 << i;
+        bounds[subset] = leaf.aabb;
+        costs[subset] = leaf.cost;
+        counts[subset] = leaf.primitive_count;
+    }
+
+    // Subsets are smaller than the set in value, so they are solved before it
+    const int32 full_set = (1 << leaf_count) - 1;
+    for (int32 set = 1; set <= full_set; ++set)
+    {
+        if (std::has_single_bit(uint32(set)))
+        {
+            continue;
+        }
+
+        int32 lowest = set & -set;
+        bounds[set] = AABB::Union(bounds[set ^ lowest], bounds[lowest]);
+        counts[set] = counts[set ^ lowest] + counts[lowest];
+
+        // Each partition is visited once by keeping the lowest leaf on the left side
+        const int32 rest = set ^ lowest;
+
+        Float best_cost = infinity;
+        int32 best_partition = 0;
+        for (int32 right = rest; right > 0; right = (right - 1) & rest)
+        {
+            int32 left = set ^ right;
+
+            Float cost = costs[left] + costs[right];
+            // Branchless select, the comparison is unpredictable
+            bool better = cost < best_cost;
+            best_cost = better ? cost : best_cost;
+            best_partition = better ? left : best_partition;
+        }
+
+        Float area = bounds[set].GetSurfaceArea();
+        Float split_cost = traverse_cost * area + best_cost;
+        Float leaf_cost = area * counts[set];
+
+        partitions[set] = best_partition;
+        collapses[set] = counts[set] <= max_leaf_primitives && leaf_cost <= split_cost;
+        costs[set] = collapses[set] ? leaf_cost : split_cost;
+    }
+
+    // Rebuild the treelet top down, the root keeps its node since it is referenced by its parent
+    int32 next_internal = 0;
+    auto rebuild = [&](auto&& rebuild, int32 set) -> int32 {
+        if (std::has_single_bit(uint32(set)))
+        {
+            return leaves[std::countr_zero(uint32(set))];
+        }
+
+        int32 index = internals[next_internal++];
+        int32 child1 = rebuild(rebuild, partitions[set]);
+        int32 child2 = rebuild(rebuild, set ^ partitions[set]);
+
+        Node& node = nodes[index];
+        node.aabb = bounds[set];
+        node.children[0] = child1;
+        node.children[1] = child2;
+        node.primitive_count = counts[set];
+        node.cost = costs[set];
+        node.collapse = collapses[set];
+        node.flat_count = node.collapse ? 1 : 1 + nodes[child1].flat_count + nodes[child2].flat_count;
+
+        return index;
+    };
+
+    rebuild(rebuild, full_set);
+    BulbitAssert(next_internal == internal_count);
+}
+
+// Writes the subtree into the flat node array in depth first order, the same layout FlattenBVH produces
+void BVH::LinearBuild::Emit(int32 index, int32 flat_offset, int32 primitives_offset)
+{
+    const Node& node = nodes[index];
+    LinearBVHNode& linear_node = bvh->nodes[flat_offset];
+    linear_node.aabb = node.aabb;
+
+    if (node.IsLeaf() || node.collapse)
+    {
+        linear_node.primitives_offset = primitives_offset;
+        linear_node.primitive_count = uint16(node.primitive_count);
+
+        int32 offset = primitives_offset;
+        GatherPrimitives(index, &offset);
+        return;
+    }
+
+    // The ordered traversal visits the first child first along the positive axis direction
+    int32 child1 = node.children[0];
+    int32 child2 = node.children[1];
+
+    Vec3 d = nodes[child2].aabb.GetCenter() - nodes[child1].aabb.GetCenter();
+    int32 axis = 0;
+    if (std::abs(d.y) > std::abs(d.x))
+    {
+        axis = 1;
+    }
+    if (std::abs(d.z) > std::abs(d[axis]))
+    {
+        axis = 2;
+    }
+
+    if (d[axis] < 0)
+    {
+        std::swap(child1, child2);
+    }
+
+    linear_node.axis = uint8(axis);
+    linear_node.primitive_count = 0;
+    linear_node.child2_offset = flat_offset + 1 + nodes[child1].flat_count;
+
+    int32 child2_primitives_offset = primitives_offset + nodes[child1].primitive_count;
+
+    if (node.primitive_count > parallel_subtree_threshold)
+    {
+        ParallelFor(0, 2, [&](int32 i) {
+            if (i == 0)
+            {
+                Emit(child1, flat_offset + 1, primitives_offset);
+            }
+            else
+            {
+                Emit(child2, linear_node.child2_offset, child2_primitives_offset);
+            }
+        });
+    }
+    else
+    {
+        Emit(child1, flat_offset + 1, primitives_offset);
+        Emit(child2, linear_node.child2_offset, child2_primitives_offset);
+    }
+}
+
+void BVH::LinearBuild::GatherPrimitives(int32 index, int32* primitives_offset)
+{
+    const Node& node = nodes[index];
+    if (node.IsLeaf())
+    {
+        ordered_prims[(*primitives_offset)++] = bvh->leaves.primitives[node.primitive];
+        return;
+    }
+
+    GatherPrimitives(node.children[0], primitives_offset);
+    GatherPrimitives(node.children[1], primitives_offset);
+}
+
+} // namespace bulbit
@@ -0,0 +1,263 @@
+#include "bulbit/bvh.h"
+#include "bulbit/parallel_for.h"
+#include "bulbit/shapes.h"
+
+#include <algorithm>
+
+namespace bulbit
+{
+
+// The nodes are stored in the depth first order, so a subtree occupies [index, end) and every child comes after its parent.
+// Walking a range backwards therefore visits the children before their parents.
+int32 BVH::GetSubtreeEnd(int32 index) const
+{
+    while (nodes[index].primitive_count == 0)
+    {
+        index = nodes[index].child2_offset;
+    }
+
+    return index + 1;
+}
+
+void BVH::InitRefitSubtrees(int32 index)
+{
+    int32 end = GetSubtreeEnd(index);
+    if (end - index <= refit_subtree_size)
+    {
+        // Reference cost of the bounds as they were built
+        Float root_area = nodes[0].aabb.GetSurfaceArea();
+        Float cost = root_area > 0 ? GetSubtreeCost(index, end) / root_area : 0;
+
+        refit_subtrees.push_back(RefitSubtree{ index, end, cost });
+        return;
+    }
+
+    refit_top_nodes.push_back(index);
+
+    InitRefitSubtrees(index + 1);
+    InitRefitSubtrees(nodes[index].child2_offset);
+}
+
+void BVH::RefitNodes(int32 begin, int32 end)
+{
+    for (int32 i = end - 1; i >= begin; --i)
+    {
+        LinearBVHNode& node = nodes[i];
+        if (node.primitive_count == 0)
+        {
+            node.aabb = AABB::Union(nodes[i + 1].aabb, nodes[node.child2_offset].aabb);
+            continue;
+        }
+
+        AABB aabb;
+        for (int32 j = 0; j < node.primitive_count; ++j)
+        {
+            int32 index = node.primitives_offset + j;
+            aabb = AABB::Union(aabb, leaves.primitives[index]->GetAABB());
+
+            // Update the cached vertices as well
+            if (leaves.types[index] != BVHLeaves::generic)
+            {
+                const Triangle* triangle = static_cast<const Triangle*>(leaves.primitives[index]->GetShape());
+
+                BVHLeaves::TriangleVertices& tri = leaves.triangles[index];
+                triangle->GetVertices(&tri.p[0], &tri.p[1], &tri.p[2]);
+            }
+        }
+
+        // Spatial split references are no longer clipped, the leaf encloses the whole primitives
+        node.aabb = aabb;
+    }
+}
+
+int32 BVH::Refit(Float rebuild_threshold)
+{
+    if (leaves.primitives.empty())
+    {
+        return 0;
+    }
+
+    if (refit_subtrees.empty())
+    {
+        InitRefitSubtrees(0);
+    }
+
+    const int32 subtree_count = int32(refit_subtrees.size());
+    std::vector<bool> rebuild(subtree_count, false);
+    int32 rebuild_count = 0;
+
+    // Subtrees are refitted independently, the top nodes are updated afterwards from their children
+    std::vector<Float> costs(subtree_count);
+    ParallelFor(0, subtree_count, [&](int32 i) {
+        const RefitSubtree& subtree = refit_subtrees[i];
+        RefitNodes(subtree.begin, subtree.end);
+
+        if (rebuild_threshold < infinity)
+        {
+            costs[i] = GetSubtreeCost(subtree.begin, subtree.end);
+        }
+    });
+
+    if (rebuild_threshold < infinity)
+    {
+        // Bounds of the whole tree before the top nodes are refitted
+        AABB root_aabb;
+        for (const RefitSubtree& subtree : refit_subtrees)
+        {
+            root_aabb = AABB::Union(root_aabb, nodes[subtree.begin].aabb);
+        }
+
+        Float root_area = root_aabb.GetSurfaceArea();
+        for (int32 i = 0; i < subtree_count; ++i)
+        {
+            costs[i] = root_area > 0 ? costs[i] / root_area : 0;
+        }
+
+        for (int32 i = 0; i < subtree_count; ++i)
+        {
+            if (costs[i] > refit_subtrees[i].cost * rebuild_threshold)
+            {
+                rebuild[i] = true;
+                ++rebuild_count;
+            }
+        }
+    }
+
+    if (rebuild_count > 0)
+    {
+        RebuildSubtrees(rebuild);
+    }
+
+    for (auto it = refit_top_nodes.rbegin(); it != refit_top_nodes.rend(); ++it)
+    {
+        LinearBVHNode& node = nodes[*it];
+        node.aabb = AABB::Union(nodes[*it + 1].aabb, nodes[node.child2_offset].aabb);
+    }
+
+    if (rebuild_count > 0)
+    {
+        // Rebuilt subtrees are the new reference
+        Float root_area = nodes[0].aabb.GetSurfaceArea();
+        for (int32 i = 0; i < subtree_count; ++i)
+        {
+            if (rebuild[i])
+            {
+                const RefitSubtree& subtree = refit_subtrees[i];
+                refit_subtrees[i].cost = root_area > 0 ? GetSubtreeCost(subtree.begin, subtree.end) / root_area : 0;
+            }
+        }
+    }
+
+    return rebuild_count;
+}
+
+// Replaces the marked subtrees with freshly built ones and lays out the whole tree again.
+// The primitives are put in the depth first order of the leaves on the way
+void BVH::RebuildSubtrees(const std::vector<bool>& rebuild)
+{
+    const int32 subtree_count = int32(refit_subtrees.size());
+
+    std::vector<std::unique_ptr<BVH>> rebuilt(subtree_count);
+    size_t new_node_count = node_count;
+    for (int32 i = 0; i < subtree_count; ++i)
+    {
+        if (!rebuild[i])
+        {
+            continue;
+        }
+
+        const RefitSubtree& subtree = refit_subtrees[i];
+
+        std::vector<Primitive*> subtree_prims;
+        for (int32 j = subtree.begin; j < subtree.end; ++j)
+        {
+            const LinearBVHNode& node = nodes[j];
+            for (int32 k = 0; k < node.primitive_count; ++k)
+            {
+                subtree_prims.push_back(leaves.primitives[node.primitives_offset + k]);
+            }
+        }
+
+        // Drop the duplicated references of spatial splits
+        std::sort(subtree_prims.begin(), subtree_prims.end());
+        subtree_prims.erase(std::unique(subtree_prims.begin(), subtree_prims.end()), subtree_prims.end());
+
+        rebuilt[i] = std::make_unique<BVH>(subtree_prims, options);
+        new_node_count += rebuilt[i]->node_count - (subtree.end - subtree.begin);
+    }
+
+    LinearBVHNode* new_nodes = new LinearBVHNode[new_node_count];
+    BVHLeaves new_leaves;
+    new_leaves.primitives.reserve(leaves.primitives.size());
+    new_leaves.types.reserve(leaves.primitives.size());
+    new_leaves.triangles.reserve(leaves.primitives.size());
+
+    // New indices of the top nodes and the subtree roots
+    std::vector<int32> new_indices(node_count, -1);
+
+    int32 offset = 0;
+    int32 subtree_index = 0;
+    for (int32 i = 0; i < node_count;)
+    {
+        if (subtree_index == subtree_count || refit_subtrees[subtree_index].begin != i)
+        {
+            // Top node, the second child is linked after all nodes are placed
+            new_indices[i] = offset;
+            new_nodes[offset++] = nodes[i];
+            ++i;
+            continue;
+        }
+
+        RefitSubtree& subtree = refit_subtrees[subtree_index];
+        new_indices[i] = offset;
+        i = subtree.end;
+
+        const BVH* source = rebuild[subtree_index] ? rebuilt[subtree_index].get() : this;
+        int32 begin = rebuild[subtree_index] ? 0 : subtree.begin;
+        int32 end = rebuild[subtree_index] ? source->node_count : subtree.end;
+
+        subtree.begin = offset;
+        subtree.end = offset + (end - begin);
+
+        for (int32 j = begin; j < end; ++j)
+        {
+            LinearBVHNode node = source->nodes[j];
+            if (node.primitive_count > 0)
+            {
+                int32 primitives_offset = int32(new_leaves.primitives.size());
+                for (int32 k = 0; k < node.primitive_count; ++k)
+                {
+                    new_leaves.primitives.push_back(source->leaves.primitives[node.primitives_offset + k]);
+                    new_leaves.types.push_back(source->leaves.types[node.primitives_offset + k]);
+                    new_leaves.triangles.push_back(source->leaves.triangles[node.primitives_offset + k]);
+                }
+                node.primitives_offset = primitives_offset;
+            }
+            else
+            {
+                node.child2_offset += offset - begin;
+            }
+
+            new_nodes[offset + (j - begin)] = node;
+        }
+
+        offset = subtree.end;
+        ++subtree_index;
+    }
+
+    BulbitAssert(size_t(offset) == new_node_count);
+
+    for (int32& top_node : refit_top_nodes)
+    {
+        new_nodes[new_indices[top_node]].child2_offset = new_indices[nodes[top_node].child2_offset];
+        top_node = new_indices[top_node];
+    }
+
+    delete[] nodes;
+    nodes = new_nodes;
+    node_count = int32(new_node_count);
+
+    leaves = std::move(new_leaves);
+}
+
+} // namespace bulbit
@@ -0,0 +1,529 @@
+#include "bulbit/bvh.h"
+#include "bulbit/parallel_for.h"
+#include "bulbit/shapes.h"
+
+namespace bulbit
+{
+
+// Spatial split BVH (SBVH)
+// Besides the object splits over the primitive centroids, each node also tries to split space with a plane.
+// Primitives straddling the plane are referenced by both children with their bounds clipped to each side,
+// which removes most of the child overlap that large or diagonal triangles cause.
+// https://www.nvidia.com/docs/IO/77714/sbvh.pdf
+
+struct BVH::SpatialSplitBuild
+{
+    ThreadLocal<Allocator>& thread_allocators;
+    std::atomic<int32>* total_nodes;
+    std::atomic<int32>* ordered_prims_offset;
+    std::vector<Primitive*>& ordered_prims;
+
+    // Triangle vertices of each primitive for exact clipping
+    struct TriangleVertices
+    {
+        Point3 p[3];
+        bool valid;
+    };
+    std::vector<TriangleVertices> triangles;
+
+    // Number of references the spatial splits can still add
+    std::atomic<int32> duplicate_budget;
+
+    Float root_area;
+};
+
+namespace
+{
+
+constexpr int32 object_bucket_count = 12;
+constexpr int32 spatial_bin_count = 16;
+
+// Spatial splits are only tried if the children of the best object split overlap more than this, relative to the root area
+constexpr Float overlap_threshold = Float(1e-5);
+
+bool IsEmpty(const AABB& aabb)
+{
+    return aabb.min.x > aabb.max.x || aabb.min.y > aabb.max.y || aabb.min.z > aabb.max.z;
+}
+
+Float GetArea(const AABB& aabb)
+{
+    return IsEmpty(aabb) ? 0 : aabb.GetSurfaceArea();
+}
+
+// Same padding as Triangle::GetAABB()
+AABB Pad(const AABB& aabb)
+{
+    if (IsEmpty(aabb))
+    {
+        return aabb;
+    }
+
+    const Vec3 aabb_offset{ epsilon * 10 };
+    return AABB(aabb.min - aabb_offset, aabb.max + aabb_offset);
+}
+
+AABB Overlap(const AABB& aabb1, const AABB& aabb2)
+{
+    return AABB(Max(aabb1.min, aabb2.min), Min(aabb1.max, aabb2.max));
+}
+
+// Bounds of the part of the triangle within the slab [lo, hi] along the axis
+AABB ClipTriangle(const Point3 p[3], int32 axis, Float lo, Float hi)
+{
+    AABB clipped;
+    for (int32 i = 0; i < 3; ++i)
+    {
+        const Point3& a = p[i];
+        const Point3& b = p[(i + 1) % 3];
+
+        if (a[axis] >= lo && a[axis] <= hi)
+        {
+            clipped = AABB::Union(clipped, a);
+        }
+
+        // Add the points where the edge crosses the slab planes
+        for (Float plane : { lo, hi })
+        {
+            if ((a[axis] < plane && plane < b[axis]) || (b[axis] < plane && plane < a[axis]))
+            {
+                Float t = (plane - a[axis]) / (b[axis] - a[axis]);
+
+                Point3 q = a + (b - a) * t;
+                q[axis] = plane;
+
+                clipped = AABB::Union(clipped, q);
+            }
+        }
+    }
+
+    return Pad(clipped);
+}
+
+// Chops the triangle into the bins [first, last] along the axis, where the bin i covers [lo + i * width, lo + (i + 1) * width]
+// Unpadded bounds of each piece are added to the chopped array
+void ChopTriangle(const Point3 p[3], int32 axis, Float lo, Float width, int32 first, int32 last, AABB* chopped)
+{
+    for (int32 i = 0; i < 3; ++i)
+    {
+        Point3 a = p[i];
+        Point3 b = p[(i + 1) % 3];
+        if (a[axis] > b[axis])
+        {
+            std::swap(a, b);
+        }
+
+        int32 bin_a = Clamp(int32((a[axis] - lo) / width), first, last);
+        int32 bin_b = Clamp(int32((b[axis] - lo) / width), first, last);
+
+        // Walk along the edge, splitting it at the bin boundaries
+        Point3 prev = a;
+        for (int32 bin = bin_a; bin < bin_b; ++bin)
+        {
+            Float plane = lo + (bin + 1) * width;
+            Float t = (plane - a[axis]) / (b[axis] - a[axis]);
+
+            Point3 q = a + (b - a) * t;
+            q[axis] = plane;
+
+            chopped[bin] = AABB::Union(AABB::Union(chopped[bin], prev), q);
+            prev = q;
+        }
+
+        chopped[bin_b] = AABB::Union(AABB::Union(chopped[bin_b], prev), b);
+    }
+}
+
+// Returns the bounds of the reference clipped to the slab [lo, hi] along the axis
+template <typename T>
+AABB ClipReference(const std::vector<T>& triangles, size_t index, const AABB& aabb, int32 axis, Float lo, Float hi)
+{
+    AABB slab = aabb;
+    slab.min[axis] = std::max(slab.min[axis], lo);
+    slab.max[axis] = std::min(slab.max[axis], hi);
+
+    if (IsEmpty(slab) || !triangles[index].valid)
+    {
+        return slab;
+    }
+
+    return Overlap(ClipTriangle(triangles[index].p, axis, lo, hi), slab);
+}
+
+} // namespace
+
+BVH::BuildNode* BVH::BuildSpatial(
+    ThreadLocal<Allocator>& thread_allocators,
+    std::vector<BVHPrimitive>& references,
+    std::atomic<int32>* total_nodes,
+    std::atomic<int32>* ordered_prims_offset,
+    std::vector<Primitive*>& ordered_prims,
+    Float duplication_budget
+)
+{
+    size_t primitive_count = references.size();
+    int32 max_duplicates = int32(primitive_count * duplication_budget);
+
+    SpatialSplitBuild build{ thread_allocators, total_nodes, ordered_prims_offset, ordered_prims };
+    build.duplicate_budget = max_duplicates;
+
+    build.triangles.resize(primitive_count);
+    ParallelFor(0, int32(primitive_count), [&](int32 i) {
+        const Triangle* triangle = dynamic_cast<const Triangle*>(leaves.primitives[i]->GetShape());
+
+        build.triangles[i].valid = triangle != nullptr;
+        if (triangle)
+        {
+            triangle->GetVertices(&build.triangles[i].p[0], &build.triangles[i].p[1], &build.triangles[i].p[2]);
+        }
+    });
+
+    AABB root_bounds;
+    for (const BVHPrimitive& reference : references)
+    {
+        root_bounds = AABB::Union(root_bounds, reference.aabb);
+    }
+    build.root_area = GetArea(root_bounds);
+
+    // Reserve the room for the duplicated references
+    ordered_prims.resize(primitive_count + max_duplicates);
+
+    BuildNode* root = BuildSpatialRecursive(build, references);
+
+    ordered_prims.resize(ordered_prims_offset->load());
+
+    return root;
+}
+
+BVH::BuildNode* BVH::BuildSpatialRecursive(SpatialSplitBuild& build, std::vector<BVHPrimitive>& references)
+{
+    Allocator allocator = build.thread_allocators.Get();
+    BuildNode* node = allocator.new_object<BuildNode>();
+
+    build.total_nodes->fetch_add(1);
+    int32 reference_count = int32(references.size());
+
+    AABB bounds, centroid_bounds;
+    for (const BVHPrimitive& reference : references)
+    {
+        bounds = AABB::Union(bounds, reference.aabb);
+        centroid_bounds = AABB::Union(centroid_bounds, reference.aabb.GetCenter());
+    }
+
+    auto create_leaf = [&]() {
+        int32 offset = build.ordered_prims_offset->fetch_add(reference_count);
+        BulbitAssert(size_t(offset + reference_count) <= build.ordered_prims.size());
+
+        for (int32 i = 0; i < reference_count; ++i)
+        {
+            build.ordered_prims[offset + i] = leaves.primitives[references[i].index];
+        }
+
+        node->InitLeaf(offset, reference_count, bounds);
+        return node;
+    };
+
+    if (bounds.GetSurfaceArea() == 0 || reference_count == 1)
+    {
+        return create_leaf();
+    }
+
+    const Float area = bounds.GetSurfaceArea();
+
+    // Find the best object split along the longest centroid extent
+    Vec3 extents = centroid_bounds.GetExtents();
+    int32 object_axis = 0;
+    if (extents.y > extents.x)
+    {
+        object_axis = 1;
+    }
+    if (extents.z > extents[object_axis])
+    {
+        object_axis = 2;
+    }
+
+    Float object_cost = infinity;
+    int32 object_split = -1;
+    AABB object_left_bounds, object_right_bounds;
+
+    const Float object_extent = extents[object_axis];
+    auto get_bucket_index = [&](const BVHPrimitive& reference) {
+        int32 bucket_index =
+            int32(object_bucket_count * (reference.aabb.GetCenter() - centroid_bounds.min)[object_axis] / object_extent);
+        return std::min(bucket_index, object_bucket_count - 1);
+    };
+
+    if (object_extent > 0)
+    {
+        struct ObjectBucket
+        {
+            int32 count = 0;
+            AABB bounds;
+        };
+
+        ObjectBucket buckets[object_bucket_count];
+        for (const BVHPrimitive& reference : references)
+        {
+            int32 bucket_index = get_bucket_index(reference);
+            buckets[bucket_index].count++;
+            buckets[bucket_index].bounds = AABB::Union(buckets[bucket_index].bounds, reference.aabb);
+        }
+
+        AABB right_bounds[object_bucket_count];
+        right_bounds[object_bucket_count - 1] = buckets[object_bucket_count - 1].bounds;
+        for (int32 i = object_bucket_count - 2; i >= 0; --i)
+        {
+            right_bounds[i] = AABB::Union(right_bounds[i + 1], buckets[i].bounds);
+        }
+
+        AABB left_bound;
+        int32 left_count = 0;
+        for (int32 i = 0; i < object_bucket_count - 1; ++i)
+        {
+            left_bound = AABB::Union(left_bound, buckets[i].bounds);
+            left_count += buckets[i].count;
+            int32 right_count = reference_count - left_count;
+
+            if (left_count == 0 || right_count == 0)
+            {
+                continue;
+            }
+
+            Float cost = traverse_cost + (left_count * GetArea(left_bound) + right_count * GetArea(right_bounds[i + 1])) / area;
+            if (cost < object_cost)
+            {
+                object_cost = cost;
+                object_split = i;
+                object_left_bounds = left_bound;
+                object_right_bounds = right_bounds[i + 1];
+            }
+        }
+    }
+
+    // Find the best spatial split, only worth it if the object split children overlap
+    Float spatial_cost = infinity;
+    int32 spatial_axis = -1;
+    Float spatial_position = 0;
+
+    bool try_spatial_split = build.duplicate_budget.load() > 0;
+    if (try_spatial_split && object_split >= 0)
+    {
+        Float overlap = GetArea(Overlap(object_left_bounds, object_right_bounds));
+        try_spatial_split = overlap > overlap_threshold * build.root_area;
+    }
+
+    if (try_spatial_split)
+    {
+        struct SpatialBin
+        {
+            AABB bounds;
+            int32 entries = 0;
+            int32 exits = 0;
+        };
+
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            const Float lo = bounds.min[axis];
+            const Float bin_width = (bounds.max[axis] - lo) / spatial_bin_count;
+            if (bin_width <= 0)
+            {
+                continue;
+            }
+
+            auto get_bin_index = [&](Float position) {
+                return Clamp(int32((position - lo) / bin_width), 0, spatial_bin_count - 1);
+            };
+
+            SpatialBin bins[spatial_bin_count];
+            for (const BVHPrimitive& reference : references)
+            {
+                int32 first = get_bin_index(reference.aabb.min[axis]);
+                int32 last = std::max(get_bin_index(reference.aabb.max[axis]), first);
+
+                if (first == last)
+                {
+                    bins[first].bounds = AABB::Union(bins[first].bounds, reference.aabb);
+                }
+                else
+                {
+                    // Chop the reference into the bins it covers
+                    const SpatialSplitBuild::TriangleVertices& triangle = build.triangles[reference.index];
+
+                    AABB chopped[spatial_bin_count];
+                    if (triangle.valid)
+                    {
+                        ChopTriangle(triangle.p, axis, lo, bin_width, first, last, chopped);
+                    }
+
+                    for (int32 b = first; b <= last; ++b)
+                    {
+                        AABB slab = reference.aabb;
+                        if (b != first)
+                        {
+                            slab.min[axis] = lo + b * bin_width;
+                        }
+                        if (b != last)
+                        {
+                            slab.max[axis] = lo + (b + 1) * bin_width;
+                        }
+
+                        AABB clipped = triangle.valid ? Overlap(Pad(chopped[b]), slab) : slab;
+                        if (!IsEmpty(clipped))
+                        {
+                            bins[b].bounds = AABB::Union(bins[b].bounds, clipped);
+                        }
+                    }
+                }
+
+                bins[first].entries++;
+                bins[last].exits++;
+            }
+
+            AABB right_bounds[spatial_bin_count];
+            right_bounds[spatial_bin_count - 1] = bins[spatial_bin_count - 1].bounds;
+            for (int32 i = spatial_bin_count - 2; i >= 0; --i)
+            {
+                right_bounds[i] = AABB::Union(right_bounds[i + 1], bins[i].bounds);
+            }
+
+            AABB left_bound;
+            int32 left_count = 0;
+            int32 right_count = reference_count;
+            for (int32 i = 0; i < spatial_bin_count - 1; ++i)
+            {
+                left_bound = AABB::Union(left_bound, bins[i].bounds);
+                left_count += bins[i].entries;
+                right_count -= bins[i].exits;
+
+                if (left_count == 0 || right_count == 0)
+                {
+                    continue;
+                }
+
+                Float cost = traverse_cost + (left_count * GetArea(left_bound) + right_count * GetArea(right_bounds[i + 1])) / area;
+                if (cost < spatial_cost)
+                {
+                    spatial_cost = cost;
+                    spatial_axis = axis;
+                    spatial_position = lo + (i + 1) * bin_width;
+                }
+            }
+        }
+    }
+
+    const Float leaf_cost = Float(reference_count);
+    if (std::min(object_cost, spatial_cost) >= leaf_cost)
+    {
+        return create_leaf();
+    }
+
+    std::vector<BVHPrimitive> left, right;
+    int32 axis = object_axis;
+
+    if (spatial_cost < object_cost)
+    {
+        for (const BVHPrimitive& reference : references)
+        {
+            if (reference.aabb.max[spatial_axis] <= spatial_position)
+            {
+                left.push_back(reference);
+            }
+            else if (reference.aabb.min[spatial_axis] >= spatial_position)
+            {
+                right.push_back(reference);
+            }
+            else
+            {
+                // Straddling reference goes to both sides with its bounds clipped
+                AABB left_bounds =
+                    ClipReference(build.triangles, reference.index, reference.aabb, spatial_axis, -infinity, spatial_position);
+                AABB right_bounds =
+                    ClipReference(build.triangles, reference.index, reference.aabb, spatial_axis, spatial_position, infinity);
+
+                if (!IsEmpty(left_bounds))
+                {
+                    left.emplace_back(reference.index, left_bounds);
+                }
+                if (!IsEmpty(right_bounds))
+                {
+                    right.emplace_back(reference.index, right_bounds);
+                }
+            }
+        }
+
+        int32 duplicates = int32(left.size() + right.size()) - reference_count;
+        bool accepted = !left.empty() && !right.empty();
+
+        if (accepted && duplicates > 0)
+        {
+            // Claim the duplicates from the memory budget
+            if (build.duplicate_budget.fetch_sub(duplicates) < duplicates)
+            {
+                build.duplicate_budget.fetch_add(duplicates);
+                accepted = false;
+            }
+        }
+
+        if (accepted)
+        {
+            axis = spatial_axis;
+        }
+        else
+        {
+            left.clear();
+            right.clear();
+
+            if (object_split < 0 || object_cost >= leaf_cost)
+            {
+                return create_leaf();
+            }
+        }
+    }
+
+    if (left.empty())
+    {
+        for (const BVHPrimitive& reference : references)
+        {
+            if (get_bucket_index(reference) <= object_split)
+            {
+                left.push_back(reference);
+            }
+            else
+            {
+                right.push_back(reference);
+            }
+        }
+    }
+
+    // Release the references of this node before going deeper
+    references.clear();
+    references.shrink_to_fit();
+
+    BuildNode* child1;
+    BuildNode* child2;
+
+    if (reference_count > parallel_build_threshold)
+    {
+        ParallelFor(0, 2, [&](int i) {
+            if (i == 0)
+            {
+                child1 = BuildSpatialRecursive(build, left);
+            }
+            else
+            {
+                child2 = BuildSpatialRecursive(build, right);
+            }
+        });
+    }
+    else
+    {
+        child1 = BuildSpatialRecursive(build, left);
+        child2 = BuildSpatialRecursive(build, right);
+    }
+
+    node->InitInternal(axis, child1, child2);
+
+    return node;
+}
+
+} // namespace bulbit
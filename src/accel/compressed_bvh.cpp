@@ -0,0 +1,452 @@
+#include "bulbit/compressed_bvh.h"
+
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BULBIT_COMPRESSED_BVH_SSE
+#include <immintrin.h>
+#endif
+
+namespace bulbit
+{
+
+namespace
+{
+
+// Outward rounding to single precision, a no-op unless Float is double
+inline float RoundDown(Float v)
+{
+    float f = float(v);
+    return Float(f) > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+inline float RoundUp(Float v)
+{
+    float f = float(v);
+    return Float(f) < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+// 2^exponent, built from the bits directly
+inline float GetScale(int32 exponent)
+{
+    return std::bit_cast<float>(uint32(exponent + 127) << 23);
+}
+
+} // namespace
+
+CompressedBVH::CompressedBVH(const std::vector<Primitive*>& primitives, const BVHBuildOptions& options)
+{
+    // The binary tree is only needed during the collapse
+    BVH bvh(primitives, options);
+    aabb = bvh.GetAABB();
+
+    std::vector<int32> primitive_order;
+    primitive_order.reserve(bvh.GetPrimitiveCount());
+
+    nodes.emplace_back();
+    Collapse(bvh, GetBuildEntry(bvh, 0), 0, primitive_order);
+
+    BulbitAssert(primitive_order.size() == size_t(bvh.GetPrimitiveCount()));
+
+    // Leaf children of a node must be contiguous, put the leaf data in the order they were visited
+    leaves = bvh.GetLeaves().Gather(primitive_order);
+}
+
+CompressedBVH::~CompressedBVH() noexcept {}
+
+CompressedBVH::BuildEntry CompressedBVH::GetBuildEntry(const BVH& bvh, int32 bvh_node) const
+{
+    const BVH::LinearBVHNode& node = bvh.GetNodes()[bvh_node];
+    if (node.primitive_count > 0)
+    {
+        return BuildEntry{ -1, node.primitives_offset, node.primitive_count, node.aabb };
+    }
+    else
+    {
+        return BuildEntry{ bvh_node, 0, 0, node.aabb };
+    }
+}
+
+bool CompressedBVH::IsInternal(const BuildEntry& entry) const
+{
+    return entry.node >= 0 || entry.count > max_leaf_count;
+}
+
+void CompressedBVH::Open(const BVH& bvh, const BuildEntry& entry, BuildEntry* child1, BuildEntry* child2) const
+{
+    if (entry.node >= 0)
+    {
+        *child1 = GetBuildEntry(bvh, entry.node + 1);
+        *child2 = GetBuildEntry(bvh, bvh.GetNodes()[entry.node].child2_offset);
+    }
+    else
+    {
+        // Leaf too large for the 8-bit count, split the range in half under the same bounds
+        int32 half = entry.count / 2;
+        *child1 = BuildEntry{ -1, entry.offset, half, entry.aabb };
+        *child2 = BuildEntry{ -1, entry.offset + half, entry.count - half, entry.aabb };
+    }
+}
+
+void CompressedBVH::Collapse(const BVH& bvh, const BuildEntry& entry, int32 index, std::vector<int32>& primitive_order)
+{
+    BuildEntry children[width];
+    int32 child_count = 0;
+
+    if (!IsInternal(entry))
+    {
+        // Root is a leaf
+        children[child_count++] = entry;
+    }
+    else
+    {
+        Open(bvh, entry, &children[0], &children[1]);
+        child_count = 2;
+
+        // Pull up grandchildren by opening the internal child with the largest surface area
+        while (child_count < width)
+        {
+            int32 best = -1;
+            Float best_area = -1;
+            for (int32 i = 0; i < child_count; ++i)
+            {
+                if (IsInternal(children[i]))
+                {
+                    Float area = children[i].aabb.GetSurfaceArea();
+                    if (area > best_area)
+                    {
+                        best = i;
+                        best_area = area;
+                    }
+                }
+            }
+
+            if (best < 0)
+            {
+                break;
+            }
+
+            BuildEntry opened = children[best];
+            Open(bvh, opened, &children[best], &children[child_count++]);
+        }
+    }
+
+    int32 internal_count = 0;
+    for (int32 i = 0; i < child_count; ++i)
+    {
+        internal_count += IsInternal(children[i]) ? 1 : 0;
+    }
+
+    const int32 child_offset = int32(nodes.size());
+    nodes.resize(nodes.size() + internal_count);
+
+    CompressedNode& node = nodes[index];
+    node.child_offset = child_offset;
+    node.primitives_offset = int32(primitive_order.size());
+    node.internal_mask = 0;
+
+    // Smallest grid that spans the node bounds with 255 steps
+    float scales[3];
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        float lo = RoundDown(entry.aabb.min[axis]);
+        float hi = RoundUp(entry.aabb.max[axis]);
+
+        int32 exponent;
+        std::frexp((hi - lo) / 255, &exponent);
+        exponent = Clamp(exponent, -126, 127);
+
+        while (exponent < 127 && lo + 255 * GetScale(exponent) < hi)
+        {
+            ++exponent;
+        }
+
+        node.origin[axis] = lo;
+        node.exponent[axis] = int8(exponent);
+        scales[axis] = GetScale(exponent);
+    }
+
+    uint8* lo_q[3] = { node.lo_x, node.lo_y, node.lo_z };
+    uint8* hi_q[3] = { node.hi_x, node.hi_y, node.hi_z };
+
+    for (int32 i = 0; i < width; ++i)
+    {
+        if (i >= child_count)
+        {
+            // Empty slot, inverted bounds
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                lo_q[axis][i] = 255;
+                hi_q[axis][i] = 0;
+            }
+            node.counts[i] = 0;
+            continue;
+        }
+
+        const BuildEntry& child = children[i];
+
+        // Round outward and step further if the decoded bounds still fall inside the child bounds
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            const float origin = node.origin[axis];
+            const float scale = scales[axis];
+
+            float child_lo = RoundDown(child.aabb.min[axis]);
+            float child_hi = RoundUp(child.aabb.max[axis]);
+
+            int32 lo = Clamp(int32(std::floor((child_lo - origin) / scale)), 0, 255);
+            while (lo > 0 && origin + float(lo) * scale > child_lo)
+            {
+                --lo;
+            }
+
+            int32 hi = Clamp(int32(std::ceil((child_hi - origin) / scale)), 0, 255);
+            while (hi < 255 && origin + float(hi) * scale < child_hi)
+            {
+                ++hi;
+            }
+
+            lo_q[axis][i] = uint8(lo);
+            hi_q[axis][i] = uint8(hi);
+        }
+
+        if (IsInternal(child))
+        {
+            node.internal_mask |= uint8(1 << i);
+            node.counts[i] = 0;
+        }
+        else
+        {
+            node.counts[i] = uint8(child.count);
+            for (int32 j = 0; j < child.count; ++j)
+            {
+                primitive_order.push_back(child.offset + j);
+            }
+        }
+    }
+
+    // The node reference is not valid across the recursion, the node array may grow
+    int32 child_index = child_offset;
+    for (int32 i = 0; i < child_count; ++i)
+    {
+        if (IsInternal(children[i]))
+        {
+            Collapse(bvh, children[i], child_index++, primitive_order);
+        }
+    }
+}
+
+template <typename T>
+void CompressedBVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
+{
+    float o[3], inv_dir[3];
+    bool is_dir_neg[3];
+    for (int32 i = 0; i < 3; ++i)
+    {
+        o[i] = float(r.o[i]);
+        inv_dir[i] = float(1 / r.d[i]);
+        is_dir_neg[i] = inv_dir[i] < 0;
+    }
+
+    struct StackEntry
+    {
+        int32 index;
+        int32 count;
+        float t;
+    };
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, 0, float(t_min));
+
+    // Added to the statistics once per ray
+    [[maybe_unused]] int32 nodes_visited = 0;
+    [[maybe_unused]] int32 primitive_tests = 0;
+
+    while (stack.Count() > 0)
+    {
+        StackEntry entry = stack.Pop();
+
+        // Ray was shortened after this entry was pushed
+        if (entry.t > t_max)
+        {
+            continue;
+        }
+
+        if (entry.count > 0)
+        {
+            // Leaf child
+            primitive_tests += entry.count;
+
+            Float t = callback->RayCastLeafCallback(r, t_min, t_max, entry.index, entry.count);
+            if (t <= t_min)
+            {
+                break;
+            }
+            else
+            {
+                // Shorten the ray
+                t_max = t;
+            }
+
+            continue;
+        }
+
+        const CompressedNode& node = nodes[entry.index];
+        ++nodes_visited;
+
+        // Decode the child bounds and run the slab test on all lanes.
+        // q * scale is exact, so the decoded planes match the ones checked by the builder with or without FMA.
+        alignas(32) float t_near[width];
+        uint32 mask;
+
+        const uint8* lo_q[3] = { node.lo_x, node.lo_y, node.lo_z };
+        const uint8* hi_q[3] = { node.hi_x, node.hi_y, node.hi_z };
+
+#if defined(BULBIT_COMPRESSED_BVH_SSE)
+        {
+            const __m128i zero = _mm_setzero_si128();
+
+            // Widens 8 quantized values into two vectors of 4 floats
+            auto decode = [zero](const uint8* q, __m128 origin, __m128 scale, __m128* lo, __m128* hi) {
+                __m128i q16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q)), zero);
+                *lo = _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q16, zero)), scale));
+                *hi = _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(q16, zero)), scale));
+            };
+
+            __m128 t0_lo = _mm_set1_ps(float(t_min)), t0_hi = t0_lo;
+            __m128 t1_lo = _mm_set1_ps(float(t_max)), t1_hi = t1_lo;
+
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                const __m128 origin = _mm_set1_ps(node.origin[axis]);
+                const __m128 scale = _mm_set1_ps(GetScale(node.exponent[axis]));
+                const __m128 ray_o = _mm_set1_ps(o[axis]);
+                const __m128 ray_inv_dir = _mm_set1_ps(inv_dir[axis]);
+
+                __m128 near_lo, near_hi, far_lo, far_hi;
+                decode(is_dir_neg[axis] ? hi_q[axis] : lo_q[axis], origin, scale, &near_lo, &near_hi);
+                decode(is_dir_neg[axis] ? lo_q[axis] : hi_q[axis], origin, scale, &far_lo, &far_hi);
+
+                t0_lo = _mm_max_ps(t0_lo, _mm_mul_ps(_mm_sub_ps(near_lo, ray_o), ray_inv_dir));
+                t0_hi = _mm_max_ps(t0_hi, _mm_mul_ps(_mm_sub_ps(near_hi, ray_o), ray_inv_dir));
+                t1_lo = _mm_min_ps(t1_lo, _mm_mul_ps(_mm_sub_ps(far_lo, ray_o), ray_inv_dir));
+                t1_hi = _mm_min_ps(t1_hi, _mm_mul_ps(_mm_sub_ps(far_hi, ray_o), ray_inv_dir));
+            }
+
+            _mm_store_ps(t_near, t0_lo);
+            _mm_store_ps(t_near + 4, t0_hi);
+
+            mask = uint32(_mm_movemask_ps(_mm_cmple_ps(t0_lo, t1_lo)));
+            mask |= uint32(_mm_movemask_ps(_mm_cmple_ps(t0_hi, t1_hi))) << 4;
+
+            // Leaf children have non-zero counts
+            __m128i counts = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(node.counts));
+            uint32 empty_counts = uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(counts, zero))) & 0xff;
+            mask &= node.internal_mask | (~empty_counts & 0xff);
+        }
+#else
+        {
+            alignas(32) float t_far[width];
+            for (int32 i = 0; i < width; ++i)
+            {
+                t_near[i] = float(t_min);
+                t_far[i] = float(t_max);
+            }
+
+            for (int32 axis = 0; axis < 3; ++axis)
+            {
+                const float origin = node.origin[axis];
+                const float scale = GetScale(node.exponent[axis]);
+
+                const uint8* near_q = is_dir_neg[axis] ? hi_q[axis] : lo_q[axis];
+                const uint8* far_q = is_dir_neg[axis] ? lo_q[axis] : hi_q[axis];
+
+                for (int32 i = 0; i < width; ++i)
+                {
+                    float t0 = (origin + float(near_q[i]) * scale - o[axis]) * inv_dir[axis];
+                    float t1 = (origin + float(far_q[i]) * scale - o[axis]) * inv_dir[axis];
+
+                    t_near[i] = std::max(t_near[i], t0);
+                    t_far[i] = std::min(t_far[i], t1);
+                }
+            }
+
+            mask = 0;
+            for (int32 i = 0; i < width; ++i)
+            {
+                bool occupied = (node.internal_mask & (1 << i)) || node.counts[i] > 0;
+                mask |= uint32(occupied && t_near[i] <= t_far[i]) << i;
+            }
+        }
+#endif
+
+        // Sort the hit children by the entry distance in descending order,
+        // so that the nearest child is popped first
+        int32 hits[width];
+        int32 hit_count = 0;
+        while (mask)
+        {
+            int32 lane = std::countr_zero(mask);
+            mask &= mask - 1;
+
+            int32 j = hit_count++;
+            while (j > 0 && t_near[hits[j - 1]] < t_near[lane])
+            {
+                hits[j] = hits[j - 1];
+                --j;
+            }
+            hits[j] = lane;
+        }
+
+        for (int32 i = 0; i < hit_count; ++i)
+        {
+            int32 lane = hits[i];
+            uint32 preceding = (1u << lane) - 1;
+
+            if (node.internal_mask & (1 << lane))
+            {
+                int32 child = node.child_offset + std::popcount(node.internal_mask & preceding);
+                stack.Emplace(child, 0, t_near[lane]);
+            }
+            else
+            {
+                int32 offset = node.primitives_offset;
+                for (int32 j = 0; j < lane; ++j)
+                {
+                    offset += node.counts[j];
+                }
+
+                stack.Emplace(offset, int32(node.counts[lane]), t_near[lane]);
+            }
+        }
+    }
+
+    BulbitStatAdd(Stat::bvh_nodes_visited, nodes_visited);
+    BulbitStatAdd(Stat::bvh_primitive_tests, primitive_tests);
+}
+
+bool CompressedBVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    BulbitStatQuery(Stat::closest_hit_queries, 1);
+
+    BVHLeaves::ClosestHitCallback callback;
+    callback.Init(&leaves, isect, ray, t_max);
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.Finish(ray);
+}
+
+bool CompressedBVH::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    BulbitStatQuery(Stat::any_hit_queries, 1);
+
+    BVHLeaves::AnyHitCallback callback;
+    callback.Init(&leaves, ray);
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+} // namespace bulbit
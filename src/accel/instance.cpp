@@ -0,0 +1,54 @@
+#include "bulbit/instance.h"
+
+namespace bulbit
+{
+
+Instance::Instance(const Intersectable* blas, const Transform& transform)
+    : Primitive(nullptr, nullptr, MediumInterface{})
+    , blas{ blas }
+    , transform{ transform }
+{
+    // World bounds of the transformed object bounds
+    AABB object_aabb = blas->GetAABB();
+    for (int32 i = 0; i < 8; ++i)
+    {
+        Point3 corner((i & 1) ? object_aabb.max.x : object_aabb.min.x, (i & 2) ? object_aabb.max.y : object_aabb.min.y,
+                      (i & 4) ? object_aabb.max.z : object_aabb.min.z);
+
+        aabb = AABB::Union(aabb, Mul(transform, corner));
+    }
+}
+
+AABB Instance::GetAABB() const
+{
+    return aabb;
+}
+
+bool Instance::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    if (!blas->Intersect(isect, ToObject(ray), t_min, t_max))
+    {
+        return false;
+    }
+
+    // The ray parameter is preserved, so only the surface attributes are brought back to the world space
+    isect->point = Mul(transform, isect->point);
+
+    // Normals transform with the inverse transpose, tangents with the transform itself
+    isect->normal = Normalize(transform.q.Rotate(isect->normal / transform.s));
+    isect->shading.normal = Normalize(transform.q.Rotate(isect->shading.normal / transform.s));
+
+    // Non-uniform scaling skews the tangent, make it orthogonal to the shading normal again
+    Vec3 tangent = transform.q.Rotate(isect->shading.tangent * transform.s);
+    tangent -= Dot(tangent, isect->shading.normal) * isect->shading.normal;
+    isect->shading.tangent = Normalize(tangent);
+
+    return true;
+}
+
+bool Instance::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    return blas->IntersectAny(ToObject(ray), t_min, t_max);
+}
+
+} // namespace bulbit
@@ -0,0 +1,378 @@
+#include "bulbit/wide_bvh.h"
+
+#include <bit>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BULBIT_WIDE_BVH_SSE
+#include <immintrin.h>
+#endif
+
+namespace bulbit
+{
+
+namespace
+{
+
+struct RayData
+{
+    float o[3];
+    float inv_dir[3];
+    int32 is_dir_neg[3];
+};
+
+// Child bounds are stored in single precision,
+// so round them outward to keep the node boxes conservative in double precision builds
+inline float RoundDown(Float v)
+{
+    float f = float(v);
+    if (Float(f) > v)
+    {
+        f = std::nextafter(f, -std::numeric_limits<float>::infinity());
+    }
+    return f;
+}
+
+inline float RoundUp(Float v)
+{
+    float f = float(v);
+    if (Float(f) < v)
+    {
+        f = std::nextafter(f, std::numeric_limits<float>::infinity());
+    }
+    return f;
+}
+
+// Tests the ray against N child boxes at once.
+// Returns the bit mask of the hit children and writes the entry distances to t_near.
+template <int32 N>
+inline uint32 TestChildren(
+    const float* near_x,
+    const float* near_y,
+    const float* near_z,
+    const float* far_x,
+    const float* far_y,
+    const float* far_z,
+    const RayData& ray,
+    float t_min,
+    float t_max,
+    float* t_near
+)
+{
+#if defined(BULBIT_WIDE_BVH_SSE)
+    if constexpr (N == 4)
+    {
+        const __m128 ox = _mm_set1_ps(ray.o[0]);
+        const __m128 oy = _mm_set1_ps(ray.o[1]);
+        const __m128 oz = _mm_set1_ps(ray.o[2]);
+        const __m128 idx = _mm_set1_ps(ray.inv_dir[0]);
+        const __m128 idy = _mm_set1_ps(ray.inv_dir[1]);
+        const __m128 idz = _mm_set1_ps(ray.inv_dir[2]);
+
+        __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_x), ox), idx);
+        __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_y), oy), idy);
+        __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_z), oz), idz);
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_x), ox), idx);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_y), oy), idy);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_z), oz), idz);
+
+        __m128 t0 = _mm_max_ps(_mm_max_ps(t0x, t0y), _mm_max_ps(t0z, _mm_set1_ps(t_min)));
+        __m128 t1 = _mm_min_ps(_mm_min_ps(t1x, t1y), _mm_min_ps(t1z, _mm_set1_ps(t_max)));
+
+        _mm_store_ps(t_near, t0);
+        return uint32(_mm_movemask_ps(_mm_cmple_ps(t0, t1)));
+    }
+#if defined(__AVX__)
+    else if constexpr (N == 8)
+    {
+        const __m256 ox = _mm256_set1_ps(ray.o[0]);
+        const __m256 oy = _mm256_set1_ps(ray.o[1]);
+        const __m256 oz = _mm256_set1_ps(ray.o[2]);
+        const __m256 idx = _mm256_set1_ps(ray.inv_dir[0]);
+        const __m256 idy = _mm256_set1_ps(ray.inv_dir[1]);
+        const __m256 idz = _mm256_set1_ps(ray.inv_dir[2]);
+
+        __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_x), ox), idx);
+        __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_y), oy), idy);
+        __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_z), oz), idz);
+        __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_x), ox), idx);
+        __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_y), oy), idy);
+        __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_z), oz), idz);
+
+        __m256 t0 = _mm256_max_ps(_mm256_max_ps(t0x, t0y), _mm256_max_ps(t0z, _mm256_set1_ps(t_min)));
+        __m256 t1 = _mm256_min_ps(_mm256_min_ps(t1x, t1y), _mm256_min_ps(t1z, _mm256_set1_ps(t_max)));
+
+        _mm256_store_ps(t_near, t0);
+        return uint32(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+    }
+#endif
+    else
+    {
+        // Two 4-wide tests for 8-wide nodes without AVX
+        uint32 lo = TestChildren<4>(near_x, near_y, near_z, far_x, far_y, far_z, ray, t_min, t_max, t_near);
+        uint32 hi = TestChildren<4>(
+            near_x + 4, near_y + 4, near_z + 4, far_x + 4, far_y + 4, far_z + 4, ray, t_min, t_max, t_near + 4
+        );
+
+        return lo | (hi << 4);
+    }
+#else
+    // Scalar fallback
+    uint32 mask = 0;
+    for (int32 i = 0; i < N; ++i)
+    {
+        float t0x = (near_x[i] - ray.o[0]) * ray.inv_dir[0];
+        float t0y = (near_y[i] - ray.o[1]) * ray.inv_dir[1];
+        float t0z = (near_z[i] - ray.o[2]) * ray.inv_dir[2];
+        float t1x = (far_x[i] - ray.o[0]) * ray.inv_dir[0];
+        float t1y = (far_y[i] - ray.o[1]) * ray.inv_dir[1];
+        float t1z = (far_z[i] - ray.o[2]) * ray.inv_dir[2];
+
+        float t0 = std::max(std::max(t0x, t0y), std::max(t0z, t_min));
+        float t1 = std::min(std::min(t1x, t1y), std::min(t1z, t_max));
+
+        t_near[i] = t0;
+        if (t0 <= t1)
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+#endif
+}
+
+} // namespace
+
+template <int32 N>
+WideBVH<N>::WideBVH(const std::vector<Primitive*>& _primitives)
+{
+    // Build the binary SAH tree first and collapse it into wide nodes
+    BVH bvh(_primitives);
+
+    leaves = bvh.GetLeaves();
+    aabb = bvh.GetAABB();
+
+    Collapse(bvh, 0);
+}
+
+template <int32 N>
+WideBVH<N>::~WideBVH() noexcept
+{
+}
+
+template <int32 N>
+int32 WideBVH<N>::Collapse(const BVH& bvh, int32 bvh_node)
+{
+    const BVH::LinearBVHNode* bvh_nodes = bvh.GetNodes();
+
+    int32 children[N];
+    int32 child_count = 0;
+
+    if (bvh_nodes[bvh_node].primitive_count > 0)
+    {
+        // Root is a leaf
+        children[child_count++] = bvh_node;
+    }
+    else
+    {
+        children[child_count++] = bvh_node + 1;
+        children[child_count++] = bvh_nodes[bvh_node].child2_offset;
+
+        // Pull up grandchildren by opening the internal child with the largest surface area
+        while (child_count < N)
+        {
+            int32 best = -1;
+            Float best_area = -1;
+            for (int32 i = 0; i < child_count; ++i)
+            {
+                const BVH::LinearBVHNode& child = bvh_nodes[children[i]];
+                if (child.primitive_count == 0)
+                {
+                    Float area = child.aabb.GetSurfaceArea();
+                    if (area > best_area)
+                    {
+                        best = i;
+                        best_area = area;
+                    }
+                }
+            }
+
+            if (best < 0)
+            {
+                break;
+            }
+
+            int32 node = children[best];
+            children[best] = node + 1;
+            children[child_count++] = bvh_nodes[node].child2_offset;
+        }
+    }
+
+    int32 index = int32(nodes.size());
+    nodes.emplace_back();
+
+    for (int32 i = 0; i < N; ++i)
+    {
+        // Do not hold the reference across the recursion, the node array may grow
+        WideNode& node = nodes[index];
+
+        if (i >= child_count)
+        {
+            node.min_x[i] = node.min_y[i] = node.min_z[i] = std::numeric_limits<float>::infinity();
+            node.max_x[i] = node.max_y[i] = node.max_z[i] = -std::numeric_limits<float>::infinity();
+            node.children[i] = empty_child;
+            node.counts[i] = 0;
+            continue;
+        }
+
+        const BVH::LinearBVHNode& child = bvh_nodes[children[i]];
+
+        node.min_x[i] = RoundDown(child.aabb.min.x);
+        node.min_y[i] = RoundDown(child.aabb.min.y);
+        node.min_z[i] = RoundDown(child.aabb.min.z);
+        node.max_x[i] = RoundUp(child.aabb.max.x);
+        node.max_y[i] = RoundUp(child.aabb.max.y);
+        node.max_z[i] = RoundUp(child.aabb.max.z);
+
+        if (child.primitive_count > 0)
+        {
+            node.children[i] = child.primitives_offset;
+            node.counts[i] = child.primitive_count;
+        }
+        else
+        {
+            node.counts[i] = 0;
+
+            int32 child_index = Collapse(bvh, children[i]);
+            nodes[index].children[i] = child_index;
+        }
+    }
+
+    return index;
+}
+
+template <int32 N>
+template <typename T>
+void WideBVH<N>::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
+{
+    RayData ray;
+    for (int32 i = 0; i < 3; ++i)
+    {
+        ray.o[i] = float(r.o[i]);
+        ray.inv_dir[i] = float(1 / r.d[i]);
+        ray.is_dir_neg[i] = int32(ray.inv_dir[i] < 0);
+    }
+
+    struct StackEntry
+    {
+        int32 index;
+        int32 count;
+        float t;
+    };
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, 0, float(t_min));
+
+    // Added to the statistics once per ray
+    [[maybe_unused]] int32 nodes_visited = 0;
+    [[maybe_unused]] int32 primitive_tests = 0;
+
+    while (stack.Count() > 0)
+    {
+        StackEntry entry = stack.Pop();
+
+        // Ray was shortened after this entry was pushed
+        if (entry.t > t_max)
+        {
+            continue;
+        }
+
+        if (entry.count > 0)
+        {
+            // Leaf child
+            primitive_tests += entry.count;
+
+            Float t = callback->RayCastLeafCallback(r, t_min, t_max, entry.index, entry.count);
+            if (t <= t_min)
+            {
+                break;
+            }
+            else
+            {
+                // Shorten the ray
+                t_max = t;
+            }
+
+            continue;
+        }
+
+        const WideNode& node = nodes[entry.index];
+        ++nodes_visited;
+
+        alignas(32) float t_near[N];
+        uint32 mask = TestChildren<N>(
+            ray.is_dir_neg[0] ? node.max_x : node.min_x, ray.is_dir_neg[1] ? node.max_y : node.min_y,
+            ray.is_dir_neg[2] ? node.max_z : node.min_z, ray.is_dir_neg[0] ? node.min_x : node.max_x,
+            ray.is_dir_neg[1] ? node.min_y : node.max_y, ray.is_dir_neg[2] ? node.min_z : node.max_z, ray, float(t_min),
+            float(t_max), t_near
+        );
+
+        // Sort the hit children by the entry distance in descending order,
+        // so that the nearest child is popped first
+        int32 hits[N];
+        int32 hit_count = 0;
+        while (mask)
+        {
+            int32 lane = std::countr_zero(mask);
+            mask &= mask - 1;
+
+            int32 j = hit_count++;
+            while (j > 0 && t_near[hits[j - 1]] < t_near[lane])
+            {
+                hits[j] = hits[j - 1];
+                --j;
+            }
+            hits[j] = lane;
+        }
+
+        for (int32 i = 0; i < hit_count; ++i)
+        {
+            int32 lane = hits[i];
+            stack.Emplace(node.children[lane], int32(node.counts[lane]), t_near[lane]);
+        }
+    }
+
+    BulbitStatAdd(Stat::bvh_nodes_visited, nodes_visited);
+    BulbitStatAdd(Stat::bvh_primitive_tests, primitive_tests);
+}
+
+template <int32 N>
+bool WideBVH<N>::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    BulbitStatQuery(Stat::closest_hit_queries, 1);
+
+    BVHLeaves::ClosestHitCallback callback;
+    callback.Init(&leaves, isect, ray, t_max);
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.Finish(ray);
+}
+
+template <int32 N>
+bool WideBVH<N>::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    BulbitStatQuery(Stat::any_hit_queries, 1);
+
+    BVHLeaves::AnyHitCallback callback;
+    callback.Init(&leaves, ray);
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+} // namespace bulbit
@@ -26,13 +26,12 @@ OrthographicCamera::OrthographicCamera(
     lower_left = origin - horizontal / 2 - vertical / 2;
 }
 
-Float OrthographicCamera::SampleRay(Ray* ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const
+Float OrthographicCamera::GenerateRay(Ray* ray, const Point2& film_position, const Point2& u1) const
 {
     BulbitNotUsed(u1);
 
-    Point2 pixel_offset = filter->Sample(u0) + Point2(Float(0.5), Float(0.5));
-    Point3 pixel_center = lower_left + horizontal * (pixel.x + pixel_offset.x) / resolution.x +
-                          vertical * (pixel.y + pixel_offset.y) / resolution.y;
+    Point3 pixel_center =
+        lower_left + horizontal * film_position.x / resolution.x + vertical * film_position.y / resolution.y;
 
     ray->o = pixel_center;
     ray->d = -w;
@@ -36,11 +36,10 @@ PerspectiveCamera::PerspectiveCamera(
     lens_radius = aperture / 2;
 }
 
-Float PerspectiveCamera::SampleRay(Ray* ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const
+Float PerspectiveCamera::GenerateRay(Ray* ray, const Point2& film_position, const Point2& u1) const
 {
-    Point2 pixel_offset = filter->Sample(u0) + Point2(Float(0.5), Float(0.5));
-    Point3 pixel_center = lower_left + horizontal * (pixel.x + pixel_offset.x) / resolution.x +
-                          vertical * (pixel.y + pixel_offset.y) / resolution.y;
+    Point3 pixel_center =
+        lower_left + horizontal * film_position.x / resolution.x + vertical * film_position.y / resolution.y;
 
     Point3 aperture_sample = lens_radius * SampleUniformUnitDiskXY(u1);
     Point3 camera_offset = u * aperture_sample.x + v * aperture_sample.y;
@@ -12,13 +12,12 @@ SphericalCamera::SphericalCamera(
 {
 }
 
-Float SphericalCamera::SampleRay(Ray* ray, const Point2i& pixel, const Point2& u0, const Point2& u1) const
+Float SphericalCamera::GenerateRay(Ray* ray, const Point2& film_position, const Point2& u1) const
 {
-    BulbitNotUsed(pixel);
     BulbitNotUsed(u1);
 
-    Float theta = (1 - u0[1] / Float(resolution.y)) * pi;
-    Float phi = u0[0] / Float(resolution.x) * two_pi;
+    Float theta = (1 - film_position.y / Float(resolution.y)) * pi;
+    Float phi = film_position.x / Float(resolution.x) * two_pi;
 
     ray->o = origin;
     ray->d = SphericalDirection(theta, phi);
@@ -1,62 +1,23 @@
 #include "bulbit/shapes.h"
+#include "bulbit/triangle_intersector.h"
 
 namespace bulbit
 {
 
-// Möller-Trumbore algorithm
 bool Triangle::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
 {
     const Point3& p0 = mesh->positions[v[0]];
     const Point3& p1 = mesh->positions[v[1]];
     const Point3& p2 = mesh->positions[v[2]];
 
-    Vec3 e1 = p1 - p0;
-    Vec3 e2 = p2 - p0;
-
-    Vec3 d = ray.d;
-    Float l = d.Normalize();
-    Vec3 pvec = Cross(d, e2);
-
-    Float det = Dot(e1, pvec);
-    // bool backface = det < epsilon;
-
-    // Ray and triangle are parallel
-    if (std::fabs(det) < epsilon)
-    {
-        return false;
-    }
-
-    Float invDet = 1 / det;
-
-    Vec3 tvec = ray.o - p0;
-    Float u = Dot(tvec, pvec) * invDet;
-    if (u < 0 || u > 1)
-    {
-        return false;
-    }
-
-    Vec3 qvec = Cross(tvec, e1);
-    Float v = Dot(d, qvec) * invDet;
-    if (v < 0 || u + v > 1)
-    {
-        return false;
-    }
-
-    Float t = Dot(e2, qvec) * invDet / l;
-    if (t < t_min || t > t_max)
+    Float t, tu, tv;
+    if (!TriangleIntersector(ray).Intersect(p0, p1, p2, t_min, t_max, &t, &tu, &tv))
     {
         return false;
     }
 
     // Found intersection
-    Float w = 1 - u - v;
-
-    isect->t = t;
-    isect->point = ray.At(t);
-    isect->uv = GetTexCoord(u, v, w);
-
-    Vec3 normal = Normalize(Cross(e1, e2));
-    SetFaceNormal(isect, ray.d, normal, GetNormal(u, v, w), GetTangent(u, v, w));
+    SetIntersection(isect, ray, t, tu, tv);
 
     return true;
 }
@@ -67,45 +28,28 @@ bool Triangle::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
     const Point3& p1 = mesh->positions[v[1]];
     const Point3& p2 = mesh->positions[v[2]];
 
-    Vec3 e1 = p1 - p0;
-    Vec3 e2 = p2 - p0;
-
-    Vec3 d = ray.d;
-    Float l = d.Normalize();
-    Vec3 pvec = Cross(d, e2);
-
-    Float det = Dot(e1, pvec);
-    // bool backface = det < epsilon;
-
-    // Ray and triangle are parallel
-    if (std::fabs(det) < epsilon)
-    {
-        return false;
-    }
+    Float t, tu, tv;
+    return TriangleIntersector(ray).Intersect(p0, p1, p2, t_min, t_max, &t, &tu, &tv);
+}
 
-    Float invDet = 1 / det;
+// Fills out the intersection from the hit distance and barycentric coordinates
+void Triangle::SetIntersection(Intersection* isect, const Ray& ray, Float t, Float tu, Float tv) const
+{
+    const Point3& p0 = mesh->positions[v[0]];
+    const Point3& p1 = mesh->positions[v[1]];
+    const Point3& p2 = mesh->positions[v[2]];
 
-    Vec3 tvec = ray.o - p0;
-    Float u = Dot(tvec, pvec) * invDet;
-    if (u < 0 || u > 1)
-    {
-        return false;
-    }
+    Vec3 e1 = p1 - p0;
+    Vec3 e2 = p2 - p0;
 
-    Vec3 qvec = Cross(tvec, e1);
-    Float v = Dot(d, qvec) * invDet;
-    if (v < 0 || u + v > 1)
-    {
-        return false;
-    }
+    Float tw = 1 - tu - tv;
 
-    Float t = Dot(e2, qvec) * invDet / l;
-    if (t < t_min || t > t_max)
-    {
-        return false;
-    }
+    isect->t = t;
+    isect->point = ray.At(t);
+    isect->uv = GetTexCoord(tu, tv, tw);
 
-    return true;
+    Vec3 normal = Normalize(Cross(e1, e2));
+    SetFaceNormal(isect, ray.d, normal, GetNormal(tu, tv, tw), GetTangent(tu, tv, tw));
 }
 
 ShapeSample Triangle::Sample(const Point2& u0) const
@@ -0,0 +1,110 @@
+#include "bulbit/triangle_intersector.h"
+
+#if !defined(BULBIT_DOUBLE_PRECISION) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BULBIT_TRIANGLE_SSE
+#include <immintrin.h>
+#endif
+
+namespace bulbit
+{
+
+uint32 TriangleIntersector::Intersect4(
+    const Point3* const triangles[4], int32 count, Float t_min, Float t_max, Float out_t[4], Float out_u[4], Float out_v[4]
+) const
+{
+    BulbitAssert(count > 0 && count <= 4);
+
+#if defined(BULBIT_TRIANGLE_SSE)
+    // Unused lanes repeat the last triangle and are masked out at the end
+    const Point3* tris[4];
+    for (int32 i = 0; i < 4; ++i)
+    {
+        tris[i] = triangles[std::min(i, count - 1)];
+    }
+
+    // Transpose the vertices into one register per component, the first eight floats of each triangle are
+    // loaded as two vectors and only z of the last vertex is gathered
+    __m128 r0[4], r1[4];
+    for (int32 i = 0; i < 4; ++i)
+    {
+        const float* f = &tris[i][0].x;
+        r0[i] = _mm_loadu_ps(f);
+        r1[i] = _mm_loadu_ps(f + 4);
+    }
+
+    _MM_TRANSPOSE4_PS(r0[0], r0[1], r0[2], r0[3]);
+    _MM_TRANSPOSE4_PS(r1[0], r1[1], r1[2], r1[3]);
+
+    __m128 p[3][3] = {
+        { r0[0], r0[1], r0[2] },
+        { r0[3], r1[0], r1[1] },
+        { r1[2], r1[3], _mm_setr_ps(tris[0][2].z, tris[1][2].z, tris[2][2].z, tris[3][2].z) },
+    };
+
+    const __m128 shear_x = _mm_set1_ps(sx);
+    const __m128 shear_y = _mm_set1_ps(sy);
+    const __m128 shear_z = _mm_set1_ps(sz);
+
+    const __m128 ox = _mm_set1_ps(o[kx]);
+    const __m128 oy = _mm_set1_ps(o[ky]);
+    const __m128 oz = _mm_set1_ps(o[kz]);
+
+    __m128 x[3], y[3], z[3];
+    for (int32 i = 0; i < 3; ++i)
+    {
+        __m128 pz = _mm_sub_ps(p[i][kz], oz);
+        x[i] = _mm_sub_ps(_mm_sub_ps(p[i][kx], ox), _mm_mul_ps(shear_x, pz));
+        y[i] = _mm_sub_ps(_mm_sub_ps(p[i][ky], oy), _mm_mul_ps(shear_y, pz));
+        z[i] = _mm_mul_ps(shear_z, pz);
+    }
+
+    const __m128 u = _mm_sub_ps(_mm_mul_ps(x[2], y[1]), _mm_mul_ps(y[2], x[1]));
+    const __m128 v = _mm_sub_ps(_mm_mul_ps(x[0], y[2]), _mm_mul_ps(y[0], x[2]));
+    const __m128 w = _mm_sub_ps(_mm_mul_ps(x[1], y[0]), _mm_mul_ps(y[1], x[0]));
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 any_neg = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+    const __m128 any_pos = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+    const __m128 any_zero = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(u, zero), _mm_cmpeq_ps(v, zero)), _mm_cmpeq_ps(w, zero));
+
+    const __m128 det = _mm_add_ps(_mm_add_ps(u, v), w);
+    const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1), det);
+    const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(u, z[0]), _mm_mul_ps(v, z[1])), _mm_mul_ps(w, z[2])), inv_det);
+
+    __m128 valid = _mm_andnot_ps(_mm_and_ps(any_neg, any_pos), _mm_cmpneq_ps(det, zero));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(t, _mm_set1_ps(t_min)), _mm_cmple_ps(t, _mm_set1_ps(t_max))));
+
+    _mm_storeu_ps(out_t, t);
+    _mm_storeu_ps(out_u, _mm_mul_ps(v, inv_det));
+    _mm_storeu_ps(out_v, _mm_mul_ps(w, inv_det));
+
+    const uint32 lanes = (1u << count) - 1;
+    const uint32 edge_lanes = uint32(_mm_movemask_ps(any_zero)) & lanes;
+    uint32 mask = uint32(_mm_movemask_ps(valid)) & lanes & ~edge_lanes;
+
+    // Rays through an edge or a vertex are decided by the scalar test in double precision
+    for (int32 i = 0; i < count; ++i)
+    {
+        if ((edge_lanes & (1 << i)) &&
+            Intersect(tris[i][0], tris[i][1], tris[i][2], t_min, t_max, &out_t[i], &out_u[i], &out_v[i]))
+        {
+            mask |= 1 << i;
+        }
+    }
+
+    return mask;
+#else
+    uint32 mask = 0;
+    for (int32 i = 0; i < count; ++i)
+    {
+        if (Intersect(triangles[i][0], triangles[i][1], triangles[i][2], t_min, t_max, &out_t[i], &out_u[i], &out_v[i]))
+        {
+            mask |= 1 << i;
+        }
+    }
+
+    return mask;
+#endif
+}
+
+} // namespace bulbit
@@ -3,10 +3,94 @@
 #include "bulbit/async_job.h"
 #include "bulbit/parallel_for.h"
 #include "bulbit/progress.h"
+#include "bulbit/stats.h"
+
+#include <fstream>
 
 namespace bulbit
 {
 
+// Sampling options a checkpoint can only be resumed with
+struct CheckpointHeader
+{
+    static constexpr uint32 magic_number = 0x504b4342; // "BCKP"
+    static constexpr uint32 version_number = 1;
+
+    uint32 magic = magic_number;
+    uint32 version = version_number;
+
+    int32 samples_per_pixel;
+    Point2i region_min, region_max;
+    int32 sample_begin;
+    int32 sample_end;
+    int32 first_pass_samples;
+    int32 pass_samples;
+    Float max_error;
+
+    // Samples taken by every pixel that is not converged
+    int32 sample_count;
+};
+
+// Writes to a temporary file first, a render killed while writing keeps the previous checkpoint
+static bool WriteCheckpoint(const std::filesystem::path& filename, const CheckpointHeader& header, const Film& film)
+{
+    std::filesystem::path temp = filename;
+    temp += ".tmp";
+
+    {
+        std::ofstream out(temp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(CheckpointHeader));
+        film.Write(out);
+
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, filename, error);
+
+    return !error;
+}
+
+static bool ReadCheckpoint(const std::filesystem::path& filename, CheckpointHeader* header, Film* film)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    CheckpointHeader stored;
+    in.read(reinterpret_cast<char*>(&stored), sizeof(CheckpointHeader));
+    if (!in || stored.magic != header->magic || stored.version != header->version ||
+        stored.samples_per_pixel != header->samples_per_pixel || stored.region_min != header->region_min ||
+        stored.region_max != header->region_max || stored.sample_begin != header->sample_begin ||
+        stored.sample_end != header->sample_end || stored.first_pass_samples != header->first_pass_samples ||
+        stored.pass_samples != header->pass_samples || stored.max_error != header->max_error)
+    {
+        return false;
+    }
+
+    if (!film->Read(in))
+    {
+        return false;
+    }
+
+    header->sample_count = stored.sample_count;
+    return true;
+}
+
+// Clips the tile to the region, false if nothing is left
+static bool ClipTile(AABB2i* tile, const AABB2i& region)
+{
+    tile->min = Max(tile->min, region.min);
+    tile->max = Min(tile->max, region.max);
+
+    return tile->min.x < tile->max.x && tile->min.y < tile->max.y;
+}
+
 UniDirectionalRayIntegrator::UniDirectionalRayIntegrator(
     const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler
 )
@@ -15,45 +99,385 @@ UniDirectionalRayIntegrator::UniDirectionalRayIntegrator(
 {
 }
 
+void UniDirectionalRayIntegrator::SetAdaptiveSampling(const AdaptiveSamplingOptions& options)
+{
+    BulbitAssert(options.min_samples > 1 && options.round_samples > 0);
+    adaptive_sampling = options;
+}
+
+void UniDirectionalRayIntegrator::SetProgressiveRendering(const ProgressiveRenderingOptions& options)
+{
+    BulbitAssert(options.pass_samples >= 0 && options.time_budget >= 0);
+    progressive_rendering = options;
+}
+
+void UniDirectionalRayIntegrator::SetCheckpointing(const CheckpointOptions& options)
+{
+    BulbitAssert(options.interval >= 0);
+    checkpoint = options;
+}
+
+void UniDirectionalRayIntegrator::SetRenderPartition(const RenderPartitionOptions& options)
+{
+    BulbitAssert(options.sample_begin >= 0 && (options.sample_end == 0 || options.sample_end > options.sample_begin));
+    partition = options;
+}
+
+void UniDirectionalRayIntegrator::SetTiling(const TilingOptions& options)
+{
+    BulbitAssert(options.size > 0 && options.min_size >= 0);
+    tiling = options;
+}
+
+void UniDirectionalRayIntegrator::SetReconstructionFilter(const Filter* filter)
+{
+    reconstruction_filter = filter;
+}
+
+// Quarters the tiles while there are fewer than a few per thread, as long as the quarters are at least min_size pixels wide.
+// The quarters of a tile stay next to each other, the order of the tiles is kept
+static std::vector<AABB2i> SplitTiles(std::vector<AABB2i> tiles, int32 min_size)
+{
+    const size_t tiles_per_thread = 4;
+
+    ThreadPool* thread_pool = ThreadPool::global_thread_pool.get();
+    const size_t target_count = tiles_per_thread * (thread_pool ? thread_pool->WorkerCount() : 1);
+
+    while (min_size > 0 && tiles.size() < target_count)
+    {
+        std::vector<AABB2i> split;
+        split.reserve(tiles.size() * 4);
+
+        for (const AABB2i& tile : tiles)
+        {
+            Vec2i extents = tile.GetExtents();
+            if (extents.x < 2 * min_size || extents.y < 2 * min_size)
+            {
+                split.push_back(tile);
+                continue;
+            }
+
+            Point2i mid = tile.min + extents / 2;
+            split.emplace_back(tile.min, mid);
+            split.emplace_back(Point2i(mid.x, tile.min.y), Point2i(tile.max.x, mid.y));
+            split.emplace_back(Point2i(tile.min.x, mid.y), Point2i(mid.x, tile.max.y));
+            split.emplace_back(mid, tile.max);
+        }
+
+        if (split.size() == tiles.size())
+        {
+            break;
+        }
+
+        tiles = std::move(split);
+    }
+
+    return tiles;
+}
+
+// Adds the pixels inside the tile to the film, returns the tile if its samples reach into the margin.
+// The rows are saved for the snapshot of the last pass first, if there is one
+static std::unique_ptr<FilmTile> MergeTile(Film& film, FilmSnapshot* snapshot, std::unique_ptr<FilmTile> film_tile)
+{
+    if (snapshot)
+    {
+        snapshot->PrepareWrite(film_tile->interior.min.y, film_tile->interior.max.y);
+    }
+
+    film.MergeTile(*film_tile);
+
+    if (!film_tile->HasMargin())
+    {
+        return nullptr;
+    }
+
+    return film_tile;
+}
+
+// Adds the margins of the tiles of a pass in tile order, so that the filtered sums do not depend on the thread timing
+static void MergeTileMargins(Film& film, FilmSnapshot* snapshot, std::vector<std::unique_ptr<FilmTile>>& margins)
+{
+    for (std::unique_ptr<FilmTile>& margin : margins)
+    {
+        if (margin)
+        {
+            if (snapshot)
+            {
+                snapshot->PrepareWrite(margin->bounds.min.y, margin->bounds.max.y);
+            }
+
+            film.MergeTileMargin(*margin);
+            margin.reset();
+        }
+    }
+}
+
+// Samples per pixel of the passes of a render with a time budget or checkpoints but no pass size
+static constexpr int32 default_pass_samples = 4;
+
 std::unique_ptr<RenderingProgress> UniDirectionalRayIntegrator::Render(const Camera& camera)
 {
     Point2i resolution = camera.GetScreenResolution();
 
     const int32 spp = sampler_prototype->samples_per_pixel;
-    const int32 tile_size = 16;
 
-    std::unique_ptr<RenderingProgress> progress = std::make_unique<RenderingProgress>(resolution, tile_size);
+    std::unique_ptr<RenderingProgress> progress = std::make_unique<RenderingProgress>(resolution, tiling.size);
+
+    // Pixels and sample indices to render, see RenderPartitionOptions
+    AABB2i region(Point2i(0, 0), resolution);
+    if (partition.region.GetSurfaceArea() > 0)
+    {
+        ClipTile(&region, partition.region);
+    }
+
+    const int32 sample_range_begin = partition.sample_begin;
+    const int32 sample_range_end = partition.sample_end > 0 ? partition.sample_end : spp;
 
-    progress->job = RunAsync([=, this, &progress, &camera]() {
-        ParallelFor2D(
-            resolution,
-            [&](AABB2i tile) {
+    const bool adaptive = adaptive_sampling.max_error > 0;
+    const bool progressive = progressive_rendering.pass_samples > 0 || progressive_rendering.time_budget > 0;
+
+    if (!adaptive && !progressive && checkpoint.filename.empty())
+    {
+        std::vector<AABB2i> tiles;
+        for (AABB2i tile : GenerateTiles(resolution, tiling.size, tiling.order))
+        {
+            if (ClipTile(&tile, region))
+            {
+                tiles.push_back(tile);
+            }
+        }
+
+        // The progress counts the tiles rendered
+        tiles = SplitTiles(std::move(tiles), tiling.min_size);
+        progress->tile_count = int32(tiles.size());
+
+        // The render job and the tasks it submits count into the statistics of the render
+        StatScope stat_scope(&progress->statistics);
+        progress->job = RunAsync([=, this, progress = progress.get(), &camera]() {
+            std::vector<std::unique_ptr<FilmTile>> margins(tiles.size());
+            ParallelFor2D(tiles, [&](int32 i, AABB2i tile) {
                 // Thread local sampler for current tile
                 std::unique_ptr<Sampler> sampler = sampler_prototype->Clone();
+                std::unique_ptr<FilmTile> film_tile =
+                    RenderTile(camera, *sampler, tile, sample_range_begin, sample_range_end, nullptr);
+                margins[i] = MergeTile(progress->film, nullptr, std::move(film_tile));
+
+                progress->tile_done++;
+            });
+
+            MergeTileMargins(progress->film, nullptr, margins);
+
+            progress->done = true;
+            return true;
+        });
+
+        return progress;
+    }
+
+    // Samples per pixel of the first and the following passes
+    int32 first_pass_samples = spp;
+    int32 pass_samples = spp;
+    if (progressive_rendering.pass_samples > 0)
+    {
+        first_pass_samples = progressive_rendering.pass_samples;
+        pass_samples = progressive_rendering.pass_samples;
+    }
+    else if (progressive_rendering.time_budget > 0 || !checkpoint.filename.empty())
+    {
+        // A single pass of all the samples would leave nothing to return when the budget runs out,
+        // and nothing to save before the render ends
+        first_pass_samples = std::min(default_pass_samples, spp);
+        pass_samples = std::min(default_pass_samples, spp);
+    }
+    if (adaptive)
+    {
+        first_pass_samples = adaptive_sampling.min_samples;
+        if (progressive_rendering.pass_samples == 0)
+        {
+            pass_samples = adaptive_sampling.round_samples;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point deadline = clock::time_point::max();
+    if (progressive_rendering.time_budget > 0)
+    {
+        std::chrono::duration<double> budget(progressive_rendering.time_budget);
+        deadline = clock::now() + std::chrono::duration_cast<clock::duration>(budget);
+    }
+
+    // Counted into the statistics of the render, as above
+    StatScope stat_scope(&progress->statistics);
+    progress->job = RunAsync([=, this, progress = progress.get(), &camera]() {
+        std::vector<AABB2i> tiles;
+        for (AABB2i tile : GenerateTiles(resolution, tiling.size, tiling.order))
+        {
+            if (ClipTile(&tile, region))
+            {
+                tiles.push_back(tile);
+            }
+            else
+            {
+                progress->tile_done++;
+            }
+        }
+
+        CheckpointHeader header;
+        header.samples_per_pixel = spp;
+        header.region_min = region.min;
+        header.region_max = region.max;
+        header.sample_begin = sample_range_begin;
+        header.sample_end = sample_range_end;
+        header.first_pass_samples = first_pass_samples;
+        header.pass_samples = pass_samples;
+        header.max_error = adaptive_sampling.max_error;
+        header.sample_count = 0;
+
+        // The checkpoint of the last complete pass, written on its own thread
+        std::thread writer;
+        std::atomic<bool> writing = false;
+        clock::time_point last_checkpoint = clock::now();
+
+        int32 sample_begin = sample_range_begin;
+        if (!checkpoint.filename.empty() && ReadCheckpoint(checkpoint.filename, &header, &progress->film))
+        {
+            sample_begin = header.sample_count;
+            progress->UpdateSnapshot(sample_begin);
+        }
+
+        int32 snapshot_sample_count = sample_begin;
+        int32 written_sample_count = sample_begin;
 
-                for (Point2i pixel : tile)
+        // Pixels of an adaptive render that reached the error target, only updated between the passes
+        std::vector<uint8> converged_pixels;
+        if (adaptive)
+        {
+            converged_pixels.assign(resolution.x * resolution.y, false);
+        }
+
+        // Tiles finished before the checkpoint was written are done already
+        std::vector<int32> active_tiles;
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            if (sample_begin > sample_range_begin &&
+                (sample_begin == sample_range_end ||
+                 (adaptive && UpdateConvergence(progress->film, tiles[i], converged_pixels.data()))))
+            {
+                progress->tile_done++;
+            }
+            else
+            {
+                active_tiles.push_back(int32(i));
+            }
+        }
+
+        std::vector<uint8> converged;
+        std::vector<std::unique_ptr<FilmTile>> margins;
+        std::atomic<bool> timed_out = false;
+
+        while (!active_tiles.empty() && !timed_out)
+        {
+            int32 samples = sample_begin == sample_range_begin ? first_pass_samples : pass_samples;
+            int32 sample_end = std::min(sample_begin + samples, sample_range_end);
+
+            // Retirement goes by the tiles, the rendering by their quarters once few tiles are left
+            std::vector<AABB2i> pass_tiles;
+            pass_tiles.reserve(active_tiles.size());
+            for (int32 i : active_tiles)
+            {
+                pass_tiles.push_back(tiles[i]);
+            }
+            pass_tiles = SplitTiles(std::move(pass_tiles), tiling.min_size);
+
+            // The first pass always completes, so that every pixel of the film has samples
+            const bool first_pass = progress->GetNumPassDone() == 0;
+
+            converged.assign(active_tiles.size(), false);
+            margins.resize(pass_tiles.size());
+            ParallelFor2D(pass_tiles, [&](int32 i, AABB2i tile) {
+                // Tiles not started in time keep the samples of the previous passes
+                if (!first_pass && (timed_out || clock::now() >= deadline))
                 {
-                    for (int32 sample = 0; sample < spp; ++sample)
-                    {
-                        sampler->StartPixelSample(pixel, sample);
+                    timed_out = true;
+                    return;
+                }
+
+                const uint8* converged_mask = adaptive ? converged_pixels.data() : nullptr;
 
-                        Ray ray;
-                        Float weight = camera.SampleRay(&ray, pixel, sampler->Next2D(), sampler->Next2D());
+                std::unique_ptr<Sampler> sampler = sampler_prototype->Clone();
+                std::unique_ptr<FilmTile> film_tile =
+                    RenderTile(camera, *sampler, tile, sample_begin, sample_end, converged_mask);
+                margins[i] = MergeTile(progress->film, &progress->snapshot, std::move(film_tile));
+            });
 
-                        Spectrum L = Li(ray, camera.GetMedium(), *sampler);
+            MergeTileMargins(progress->film, &progress->snapshot, margins);
 
-                        if (!L.IsNullish())
-                        {
-                            progress->film.AddSample(pixel, weight * L, 1);
-                        }
+            // A pass cut short by the time budget is not a consistent snapshot
+            if (!timed_out)
+            {
+                // Retire the tiles that took all of their samples or whose pixels all converged. Done after the pass,
+                // since splatted samples of the neighbouring tiles reach into the tile borders
+                ParallelFor(0, int32(active_tiles.size()), [&](int32 i) {
+                    const AABB2i& tile = tiles[active_tiles[i]];
+                    if (sample_end == sample_range_end ||
+                        (adaptive && UpdateConvergence(progress->film, tile, converged_pixels.data())))
+                    {
+                        converged[i] = true;
+                        progress->tile_done++;
                     }
+                });
+
+                progress->UpdateSnapshot(sample_end);
+                snapshot_sample_count = sample_end;
+
+                std::chrono::duration<double> elapsed = clock::now() - last_checkpoint;
+                if (!checkpoint.filename.empty() && !writing && elapsed.count() >= checkpoint.interval)
+                {
+                    if (writer.joinable())
+                    {
+                        writer.join();
+                    }
+
+                    last_checkpoint = clock::now();
+
+                    // The snapshot is copied on the writer thread, it may be of a later pass by then
+                    writing = true;
+                    writer = std::thread([&, header]() mutable {
+                        Film film = progress->snapshot.Get(&header.sample_count);
+                        WriteCheckpoint(checkpoint.filename, header, film);
+                        written_sample_count = header.sample_count;
+                        writing = false;
+                    });
                 }
+            }
 
-                progress->tile_done++;
-            },
-            tile_size
-        );
+            // Keep the tiles that need more samples for the next pass
+            size_t count = 0;
+            for (size_t i = 0; i < active_tiles.size(); ++i)
+            {
+                if (!converged[i])
+                {
+                    active_tiles[count++] = active_tiles[i];
+                }
+            }
+
+            active_tiles.resize(count);
+            sample_begin = sample_end;
+        }
+
+        if (writer.joinable())
+        {
+            writer.join();
+        }
 
+        // Save the last complete pass, a render stopped by its time budget continues from there
+        if (!checkpoint.filename.empty() && snapshot_sample_count > written_sample_count)
+        {
+            Film film = progress->snapshot.Get(&header.sample_count);
+            WriteCheckpoint(checkpoint.filename, header, film);
+        }
+
+        progress->tile_done = progress->tile_count;
         progress->done = true;
         return true;
     });
@@ -61,4 +485,77 @@ std::unique_ptr<RenderingProgress> UniDirectionalRayIntegrator::Render(const Cam
     return progress;
 }
 
+std::unique_ptr<FilmTile> UniDirectionalRayIntegrator::RenderTile(
+    const Camera& camera,
+    Sampler& sampler,
+    const AABB2i& tile,
+    int32 sample_begin,
+    int32 sample_end,
+    const uint8* converged_pixels
+) const
+{
+    const Point2i& resolution = camera.GetScreenResolution();
+    std::unique_ptr<FilmTile> film_tile = std::make_unique<FilmTile>(tile, resolution, reconstruction_filter);
+
+    for (Point2i pixel : tile)
+    {
+        if (converged_pixels && converged_pixels[pixel.x + pixel.y * resolution.x])
+        {
+            continue;
+        }
+
+        BulbitStatAdd(Stat::camera_rays, sample_end - sample_begin);
+
+        for (int32 sample = sample_begin; sample < sample_end; ++sample)
+        {
+            sampler.StartPixelSample(pixel, sample);
+
+            Ray ray;
+            if (reconstruction_filter)
+            {
+                // Uniform position in the pixel, the filter weights the sample when it is splatted
+                Point2 u0 = sampler.Next2D();
+                Point2 u1 = sampler.Next2D();
+                Point2 film_position(pixel.x + u0.x, pixel.y + u0.y);
+
+                Float weight = camera.GenerateRay(&ray, film_position, u1);
+
+                Spectrum L = Li(ray, camera.GetMedium(), sampler);
+
+                if (!L.IsNullish())
+                {
+                    film_tile->AddSplat(film_position, weight * L);
+                }
+            }
+            else
+            {
+                Float weight = camera.SampleRay(&ray, pixel, sampler.Next2D(), sampler.Next2D());
+
+                Spectrum L = Li(ray, camera.GetMedium(), sampler);
+
+                if (!L.IsNullish())
+                {
+                    film_tile->AddSample(pixel, weight * L, 1);
+                }
+            }
+        }
+    }
+
+    return film_tile;
+}
+
+bool UniDirectionalRayIntegrator::UpdateConvergence(const Film& film, const AABB2i& tile, uint8* converged_pixels) const
+{
+    bool converged = true;
+    for (Point2i pixel : tile)
+    {
+        uint8& pixel_converged = converged_pixels[pixel.x + pixel.y * film.resolution.x];
+
+        pixel_converged = film.EstimateRelativeError(pixel) <= adaptive_sampling.max_error;
+        converged &= bool(pixel_converged);
+    }
+
+    return converged;
+}
+
 } // namespace bulbit
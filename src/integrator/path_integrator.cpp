@@ -1,7 +1,9 @@
 #include "bulbit/bxdfs.h"
+#include "bulbit/hash.h"
 #include "bulbit/integrators.h"
 #include "bulbit/lights.h"
 #include "bulbit/material.h"
+#include "bulbit/stats.h"
 
 namespace bulbit
 {
@@ -10,7 +12,8 @@ PathIntegrator::PathIntegrator(
     const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, int32 max_bounces, bool regularize_bsdf
 )
     : UniDirectionalRayIntegrator(accel, std::move(lights), sampler)
-    , light_sampler{ all_lights }
+    , light_sampler{ CreateLightSampler(LightSamplerType::uniform, all_lights, accel->GetAABB()) }
+    , light_candidates{ 1 }
     , max_bounces{ max_bounces }
     , regularize_bsdf{ regularize_bsdf }
 {
@@ -36,6 +39,17 @@ PathIntegrator::PathIntegrator(
     }
 }
 
+void PathIntegrator::SetLightSampler(LightSamplerType type)
+{
+    light_sampler = CreateLightSampler(type, all_lights, accel->GetAABB());
+}
+
+void PathIntegrator::SetLightCandidates(int32 candidates)
+{
+    BulbitAssert(candidates > 0);
+    light_candidates = candidates;
+}
+
 Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
 {
     BulbitNotUsed(primary_medium);
@@ -47,6 +61,7 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
     Float eta_scale = 1;
     Ray ray = primary_ray;
     Float prev_bsdf_pdf = 0;
+    Intersection prev_isect;
 
     while (true)
     {
@@ -65,7 +80,7 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
                 // Evaluate BSDF sample MIS for infinite light
                 for (Light* light : infinite_lights)
                 {
-                    Float light_pdf = light->EvaluatePDF(ray) * light_sampler.EvaluatePMF(light);
+                    Float light_pdf = light->EvaluatePDF(ray) * light_sampler->EvaluatePMF(prev_isect, light);
                     Float mis_weight = PowerHeuristic(1, prev_bsdf_pdf, 1, light_pdf);
 
                     L += beta * mis_weight * light->Le(ray);
@@ -89,7 +104,8 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
                 // Evaluate BSDF sample with MIS for area light
                 AreaLight* area_light = area_lights.at(isect.primitive);
 
-                Float light_pdf = isect.primitive->GetShape()->PDF(isect, ray) * light_sampler.EvaluatePMF(area_light);
+                Float light_pdf = isect.primitive->GetShape()->PDF(isect, ray);
+                light_pdf *= light_sampler->EvaluatePMF(prev_isect, area_light);
                 Float mis_weight = PowerHeuristic(1, prev_bsdf_pdf, 1, light_pdf);
 
                 L += beta * mis_weight * Le;
@@ -137,8 +153,9 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
             eta_scale *= Sqr(bsdf_sample.eta);
         }
 
-        // Save bsdf pdf for MIS
+        // Save bsdf pdf and the scattering point for MIS
         prev_bsdf_pdf = bsdf_sample.pdf;
+        prev_isect = isect;
         beta *= bsdf_sample.f * AbsDot(isect.shading.normal, bsdf_sample.wi) / bsdf_sample.pdf;
         ray = Ray(isect.point, bsdf_sample.wi);
 
@@ -149,6 +166,7 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
             Float p = beta.MaxComponent() * eta_scale;
             if (p < 1 && sampler.Next1D() > p)
             {
+                BulbitStatIncrement(Stat::russian_roulette_terminations);
                 break;
             }
 
@@ -156,6 +174,8 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
         }
     }
 
+    BulbitStatRecord(StatHistogram::path_length, bounce);
+
     return L;
 }
 
@@ -163,10 +183,15 @@ Spectrum PathIntegrator::SampleDirectLight(
     const Vec3& wo, const Intersection& isect, BSDF* bsdf, Sampler& sampler, const Spectrum& beta
 ) const
 {
+    if (light_candidates > 1)
+    {
+        return ResampleDirectLight(wo, isect, bsdf, sampler, beta);
+    }
+
     Float u0 = sampler.Next1D();
     Point2 u12 = sampler.Next2D();
     SampledLight sampled_light;
-    if (!light_sampler.Sample(&sampled_light, isect, u0))
+    if (!light_sampler->Sample(&sampled_light, isect, u0))
     {
         return Spectrum::black;
     }
@@ -198,4 +223,66 @@ Spectrum PathIntegrator::SampleDirectLight(
     }
 }
 
+// Talbot et al. 2005, the candidates are weighted by the luminance of their unshadowed contribution over their pdf.
+// The chosen sample y is weighted by sum(w) / (M * target(y)), an unbiased estimate of the inverse of its pdf.
+// The MIS weights against the BSDF sampling use the pdf of the candidates, so they still sum to one with Li()
+Spectrum PathIntegrator::ResampleDirectLight(
+    const Vec3& wo, const Intersection& isect, BSDF* bsdf, Sampler& sampler, const Spectrum& beta
+) const
+{
+    struct Candidate
+    {
+        LightSample light_sample;
+        Spectrum contribution = Spectrum::black;
+    };
+
+    WeightedReservoirSampler<Candidate> wrs(Hash(isect.point, sampler.Next1D()));
+
+    for (int32 i = 0; i < light_candidates; ++i)
+    {
+        Float u0 = sampler.Next1D();
+        Point2 u12 = sampler.Next2D();
+        SampledLight sampled_light;
+        if (!light_sampler->Sample(&sampled_light, isect, u0))
+        {
+            continue;
+        }
+
+        LightSample light_sample = sampled_light.light->Sample_Li(isect, u12);
+        Float bsdf_pdf = bsdf->PDF(wo, light_sample.wi);
+        if (light_sample.Li.IsBlack() || bsdf_pdf == 0 || light_sample.pdf == 0)
+        {
+            continue;
+        }
+
+        Float light_pdf = light_sample.pdf / sampled_light.weight;
+        Spectrum f_cos = bsdf->f(wo, light_sample.wi) * AbsDot(isect.shading.normal, light_sample.wi);
+
+        Float mis_weight = sampled_light.light->IsDeltaLight() ? 1 : PowerHeuristic(1, light_pdf, 1, bsdf_pdf);
+        Spectrum contribution = mis_weight * light_sample.Li * f_cos;
+
+        Float target = contribution.Luminance();
+        if (target > 0)
+        {
+            wrs.Add(Candidate{ light_sample, contribution }, target / light_pdf);
+        }
+    }
+
+    if (!wrs.HasSample())
+    {
+        return Spectrum::black;
+    }
+
+    // Trace only the shadow ray of the chosen sample
+    const Candidate& candidate = wrs.GetSample();
+    Ray shadow_ray(isect.point, candidate.light_sample.wi);
+    if (IntersectAny(shadow_ray, Ray::epsilon, candidate.light_sample.visibility))
+    {
+        return Spectrum::black;
+    }
+
+    Float inv_pdf = wrs.GetWeightSum() / (light_candidates * candidate.contribution.Luminance());
+    return beta * candidate.contribution * inv_pdf;
+}
+
 } // namespace bulbit
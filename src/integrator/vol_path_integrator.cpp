@@ -4,6 +4,7 @@
 #include "bulbit/material.h"
 #include "bulbit/media.h"
 #include "bulbit/random.h"
+#include "bulbit/stats.h"
 
 namespace bulbit
 {
@@ -12,7 +13,7 @@ VolPathIntegrator::VolPathIntegrator(
     const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, int32 max_bounces, bool regularize_bsdf
 )
     : UniDirectionalRayIntegrator(accel, std::move(lights), sampler)
-    , light_sampler{ all_lights }
+    , light_sampler{ CreateLightSampler(LightSamplerType::uniform, all_lights, accel->GetAABB()) }
     , max_bounces{ max_bounces }
     , regularize_bsdf{ regularize_bsdf }
 {
@@ -38,6 +39,11 @@ VolPathIntegrator::VolPathIntegrator(
     }
 }
 
+void VolPathIntegrator::SetLightSampler(LightSamplerType type)
+{
+    light_sampler = CreateLightSampler(type, all_lights, accel->GetAABB());
+}
+
 Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
 {
     int32 wavelength = std::min<int32>(int32(sampler.Next1D() * 3), 2);
@@ -56,7 +62,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
 
     const Medium* medium = primary_medium;
 
-    Point3 last_scattering_vertex;
+    Intersection last_scattering_vertex;
 
     while (true)
     {
@@ -136,7 +142,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
                         // Add direct light
                         Intersection medium_isect{ .point = p };
                         L += SampleDirectLight(wo, medium_isect, medium, nullptr, ms.phase, wavelength, sampler, beta, r_u);
-                        last_scattering_vertex = p;
+                        last_scattering_vertex = medium_isect;
 
                         // Sample phase function to find next path direction
                         PhaseFunctionSample phase_sample;
@@ -217,8 +223,8 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
             {
                 for (Light* light : infinite_lights)
                 {
-                    Ray r(last_scattering_vertex, ray.d);
-                    Float light_pdf = light->EvaluatePDF(ray) * light_sampler.EvaluatePMF(light);
+                    Ray r(last_scattering_vertex.point, ray.d);
+                    Float light_pdf = light->EvaluatePDF(ray) * light_sampler->EvaluatePMF(last_scattering_vertex, light);
                     r_l *= light_pdf;
                     L += beta * light->Le(ray) / (r_u + r_l).Average();
                 }
@@ -239,8 +245,8 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
                 // Add emission from area light source
                 AreaLight* area_light = area_lights.at(isect.primitive);
 
-                Ray r(last_scattering_vertex, ray.d);
-                Float light_pdf = area_light->EvaluatePDF(r) * light_sampler.EvaluatePMF(area_light);
+                Ray r(last_scattering_vertex.point, ray.d);
+                Float light_pdf = area_light->EvaluatePDF(r) * light_sampler->EvaluatePMF(last_scattering_vertex, area_light);
                 r_l *= light_pdf;
                 L += beta * Le / (r_u + r_l).Average();
             }
@@ -274,7 +280,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
         {
             L += SampleDirectLight(wo, isect, nullptr, &bsdf, nullptr, wavelength, sampler, beta, r_u);
         }
-        last_scattering_vertex = isect.point;
+        last_scattering_vertex = isect;
 
         BSDFSample bsdf_sample;
         if (!bsdf.Sample_f(&bsdf_sample, wo, sampler.Next1D(), sampler.Next2D()))
@@ -322,7 +328,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
 
             // Add subsurface scattered direct light
             L += SampleDirectLight(bssrdf_sample.wo, bssrdf_sample.pi, nullptr, &Sw, nullptr, wavelength, sampler, beta, r_u);
-            last_scattering_vertex = bssrdf_sample.pi.point;
+            last_scattering_vertex = bssrdf_sample.pi;
 
             // Handle subsurface scattering for indirect light
             if (!Sw.Sample_f(&bsdf_sample, bssrdf_sample.wo, sampler.Next1D(), sampler.Next2D()))
@@ -348,6 +354,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
             Float p = rr.MaxComponent();
             if (p < 1 && sampler.Next1D() > p)
             {
+                BulbitStatIncrement(Stat::russian_roulette_terminations);
                 break;
             }
 
@@ -355,6 +362,8 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
         }
     }
 
+    BulbitStatRecord(StatHistogram::path_length, bounce);
+
     return L;
 }
 
@@ -373,7 +382,7 @@ Spectrum VolPathIntegrator::SampleDirectLight(
     Float u0 = sampler.Next1D();
     Point2 u12 = sampler.Next2D();
     SampledLight sampled_light;
-    if (!light_sampler.Sample(&sampled_light, isect, u0))
+    if (!light_sampler->Sample(&sampled_light, isect, u0))
     {
         return Spectrum::black;
     }
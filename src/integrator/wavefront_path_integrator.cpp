@@ -0,0 +1,569 @@
+#include "bulbit/bxdfs.h"
+#include "bulbit/integrators.h"
+#include "bulbit/lights.h"
+#include "bulbit/material.h"
+
+#include "bulbit/async_job.h"
+#include "bulbit/parallel_for.h"
+#include "bulbit/progress.h"
+#include "bulbit/stats.h"
+
+namespace bulbit
+{
+
+// States of the paths in flight and the queues between the stages, stored as separate arrays.
+// The ray queue is indexed by the queue position, the entries refer to their path with ray_paths
+struct WavefrontPathIntegrator::Wavefront
+{
+    Wavefront(int32 capacity, const Sampler* sampler_prototype);
+
+    const int32 capacity;
+
+    // Paths [path_begin, path_end) of the whole image, a path is a sample of the pixel pixels[index / spp]
+    int64 path_begin, path_end;
+    int32 spp;
+    const Point2i* pixels;
+
+    // Path states
+    std::vector<std::unique_ptr<Sampler>> samplers;
+    std::unique_ptr<Float[]> camera_weights;
+    std::unique_ptr<Spectrum[]> L;
+    std::unique_ptr<Spectrum[]> beta;
+    std::unique_ptr<int32[]> bounces;
+    std::unique_ptr<bool[]> specular_bounces;
+    std::unique_ptr<bool[]> any_non_specular_bounces;
+    std::unique_ptr<Float[]> eta_scales;
+    std::unique_ptr<Float[]> prev_bsdf_pdfs;
+    std::unique_ptr<Point3[]> prev_points;
+    std::unique_ptr<Vec3[]> prev_normals;
+
+    // Rays to trace for the next bounce
+    int32 ray_count;
+    std::unique_ptr<Ray[]> rays;
+    std::unique_ptr<int32[]> ray_paths;
+    std::unique_ptr<Float[]> ray_t_max;
+    std::unique_ptr<Intersection[]> isects;
+    std::unique_ptr<bool[]> hits;
+    std::unique_ptr<bool[]> continued;
+
+    // Queue positions of the hit rays, grouped by material type
+    int32 shade_count;
+    std::unique_ptr<int32[]> shade_order;
+
+    // The material sort counts and scatters chunks of the queue of this size in parallel
+    static constexpr int32 sort_chunk_size = 4 * 1024;
+
+    // Per chunk material counts, turned into the write offsets of the chunks
+    std::vector<int32> sort_offsets;
+
+    // Shadow rays and their unoccluded contributions.
+    // Written at the queue position of the shaded ray and compacted before tracing
+    int32 shadow_count;
+    std::unique_ptr<Ray[]> shadow_rays;
+    std::unique_ptr<int32[]> shadow_paths;
+    std::unique_ptr<Float[]> shadow_t_max;
+    std::unique_ptr<Spectrum[]> shadow_Ld;
+    std::unique_ptr<bool[]> shadow_valid;
+    std::unique_ptr<bool[]> occluded;
+};
+
+WavefrontPathIntegrator::Wavefront::Wavefront(int32 capacity, const Sampler* sampler_prototype)
+    : capacity{ capacity }
+    , path_begin{ 0 }
+    , path_end{ 0 }
+    , spp{ sampler_prototype->samples_per_pixel }
+    , pixels{ nullptr }
+    , ray_count{ 0 }
+    , shade_count{ 0 }
+    , shadow_count{ 0 }
+{
+    samplers.resize(capacity);
+    for (int32 i = 0; i < capacity; ++i)
+    {
+        samplers[i] = sampler_prototype->Clone();
+    }
+
+    camera_weights = std::make_unique<Float[]>(capacity);
+    L = std::make_unique<Spectrum[]>(capacity);
+    beta = std::make_unique<Spectrum[]>(capacity);
+    bounces = std::make_unique<int32[]>(capacity);
+    specular_bounces = std::make_unique<bool[]>(capacity);
+    any_non_specular_bounces = std::make_unique<bool[]>(capacity);
+    eta_scales = std::make_unique<Float[]>(capacity);
+    prev_bsdf_pdfs = std::make_unique<Float[]>(capacity);
+    prev_points = std::make_unique<Point3[]>(capacity);
+    prev_normals = std::make_unique<Vec3[]>(capacity);
+
+    rays = std::make_unique<Ray[]>(capacity);
+    ray_paths = std::make_unique<int32[]>(capacity);
+    ray_t_max = std::make_unique<Float[]>(capacity);
+    isects = std::make_unique<Intersection[]>(capacity);
+    hits = std::make_unique<bool[]>(capacity);
+    continued = std::make_unique<bool[]>(capacity);
+
+    shade_order = std::make_unique<int32[]>(capacity);
+    sort_offsets.resize(size_t((capacity + sort_chunk_size - 1) / sort_chunk_size) * (int32(Materials::count) + 1));
+
+    shadow_rays = std::make_unique<Ray[]>(capacity);
+    shadow_paths = std::make_unique<int32[]>(capacity);
+    shadow_t_max = std::make_unique<Float[]>(capacity);
+    shadow_Ld = std::make_unique<Spectrum[]>(capacity);
+    shadow_valid = std::make_unique<bool[]>(capacity);
+    occluded = std::make_unique<bool[]>(capacity);
+
+    for (int32 i = 0; i < capacity; ++i)
+    {
+        ray_t_max[i] = infinity;
+    }
+}
+
+WavefrontPathIntegrator::WavefrontPathIntegrator(
+    const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, int32 max_bounces, bool regularize_bsdf
+)
+    : Integrator(accel, std::move(lights))
+    , sampler_prototype{ sampler }
+    , light_sampler{ CreateLightSampler(LightSamplerType::uniform, all_lights, accel->GetAABB()) }
+    , max_bounces{ max_bounces }
+    , regularize_bsdf{ regularize_bsdf }
+{
+    for (Light* light : all_lights)
+    {
+        switch (light->GetTypeIndex())
+        {
+        case Light::TypeIndexOf<UniformInfiniteLight>():
+        case Light::TypeIndexOf<ImageInfiniteLight>():
+        {
+            infinite_lights.push_back(light);
+        }
+        break;
+        case Light::TypeIndexOf<AreaLight>():
+        {
+            AreaLight* area_light = light->Cast<AreaLight>();
+            area_lights.emplace(area_light->GetPrimitive(), area_light);
+        }
+        break;
+        default:
+            break;
+        }
+    }
+}
+
+void WavefrontPathIntegrator::SetLightSampler(LightSamplerType type)
+{
+    light_sampler = CreateLightSampler(type, all_lights, accel->GetAABB());
+}
+
+std::unique_ptr<RenderingProgress> WavefrontPathIntegrator::Render(const Camera& camera)
+{
+    Point2i resolution = camera.GetScreenResolution();
+
+    const int32 spp = sampler_prototype->samples_per_pixel;
+    const int32 tile_size = 16;
+
+    std::unique_ptr<RenderingProgress> progress = std::make_unique<RenderingProgress>(resolution, tile_size);
+
+    // The render job and the tasks it submits count into the statistics of the render
+    StatScope stat_scope(&progress->statistics);
+    progress->job = RunAsync([=, this, progress = progress.get(), &camera]() {
+        // Pixels are visited tile by tile along a Hilbert curve, a wavefront smaller than the image covers a compact area.
+        // tile_path_ends tells when a tile is complete
+        std::vector<Point2i> pixels;
+        std::vector<int64> tile_path_ends;
+        pixels.reserve(size_t(resolution.x) * resolution.y);
+        tile_path_ends.reserve(progress->GetTileCount());
+
+        for (const AABB2i& tile : GenerateTiles(resolution, tile_size, TileOrder::hilbert))
+        {
+            for (Point2i pixel : tile)
+            {
+                pixels.push_back(pixel);
+            }
+
+            tile_path_ends.push_back(int64(pixels.size()) * spp);
+        }
+
+        const int64 path_count = int64(pixels.size()) * spp;
+
+        Wavefront wf(int32(std::min<int64>(max_wavefront_size, path_count)), sampler_prototype);
+        wf.pixels = pixels.data();
+
+        size_t tile_index = 0;
+        for (int64 begin = 0; begin < path_count; begin += wf.capacity)
+        {
+            wf.path_begin = begin;
+            wf.path_end = std::min<int64>(begin + wf.capacity, path_count);
+
+            GenerateCameraRays(wf, camera);
+
+            while (wf.ray_count > 0)
+            {
+                TraceClosestRays(wf);
+                HandleEscapedRays(wf);
+                SortByMaterial(wf);
+                ShadeHits(wf);
+                TraceShadowRays(wf);
+            }
+
+            AccumulateSamples(wf, progress->film);
+
+            while (tile_index < tile_path_ends.size() && tile_path_ends[tile_index] <= wf.path_end)
+            {
+                progress->tile_done++;
+                ++tile_index;
+            }
+        }
+
+        progress->done = true;
+        return true;
+    });
+
+    return progress;
+}
+
+void WavefrontPathIntegrator::GenerateCameraRays(Wavefront& wf, const Camera& camera) const
+{
+    const int32 count = int32(wf.path_end - wf.path_begin);
+    BulbitStatAdd(Stat::camera_rays, count);
+
+    ParallelFor(0, count, [&](int32 i) {
+        int64 index = wf.path_begin + i;
+        Point2i pixel = wf.pixels[index / wf.spp];
+        int32 sample = int32(index % wf.spp);
+
+        Sampler& sampler = *wf.samplers[i];
+        sampler.StartPixelSample(pixel, sample);
+
+        wf.camera_weights[i] = camera.SampleRay(&wf.rays[i], pixel, sampler.Next2D(), sampler.Next2D());
+        wf.ray_paths[i] = i;
+
+        wf.L[i] = Spectrum(0);
+        wf.beta[i] = Spectrum(1);
+        wf.bounces[i] = 0;
+        wf.specular_bounces[i] = false;
+        wf.any_non_specular_bounces[i] = false;
+        wf.eta_scales[i] = 1;
+        wf.prev_bsdf_pdfs[i] = 0;
+    });
+
+    wf.ray_count = count;
+}
+
+void WavefrontPathIntegrator::TraceClosestRays(Wavefront& wf) const
+{
+    ParallelFor(0, wf.ray_count, [&](int32 begin, int32 end) {
+        size_t count = end - begin;
+        IntersectBatch(
+            std::span(&wf.isects[begin], count), std::span(&wf.hits[begin], count), std::span(&wf.rays[begin], count),
+            Ray::epsilon, std::span(&wf.ray_t_max[begin], count)
+        );
+    });
+}
+
+void WavefrontPathIntegrator::HandleEscapedRays(Wavefront& wf) const
+{
+    if (infinite_lights.empty())
+    {
+        return;
+    }
+
+    ParallelFor(0, wf.ray_count, [&](int32 k) {
+        if (wf.hits[k])
+        {
+            return;
+        }
+
+        int32 path = wf.ray_paths[k];
+        const Ray& ray = wf.rays[k];
+        const Spectrum& beta = wf.beta[path];
+        Spectrum& L = wf.L[path];
+
+        if (wf.bounces[path] == 0 || wf.specular_bounces[path])
+        {
+            for (Light* light : infinite_lights)
+            {
+                L += beta * light->Le(ray);
+            }
+        }
+        else
+        {
+            // Evaluate BSDF sample MIS for infinite light
+            Intersection prev_isect{ .point = wf.prev_points[path], .normal = wf.prev_normals[path] };
+            for (Light* light : infinite_lights)
+            {
+                Float light_pdf = light->EvaluatePDF(ray) * light_sampler->EvaluatePMF(prev_isect, light);
+                Float mis_weight = PowerHeuristic(1, wf.prev_bsdf_pdfs[path], 1, light_pdf);
+
+                L += beta * mis_weight * light->Le(ray);
+            }
+        }
+    });
+}
+
+// Counting sort of the hit rays by the material type, primitives without a material go last
+void WavefrontPathIntegrator::SortByMaterial(Wavefront& wf) const
+{
+    constexpr int32 bin_count = int32(Materials::count) + 1;
+
+    auto material_bin = [&](int32 k) {
+        const Material* material = wf.isects[k].primitive->GetMaterial();
+        return material ? int32(material->GetTypeIndex()) : bin_count - 1;
+    };
+
+    const int32 chunk_count = (wf.ray_count + Wavefront::sort_chunk_size - 1) / Wavefront::sort_chunk_size;
+
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32* histogram = &wf.sort_offsets[size_t(chunk) * bin_count];
+        std::fill(histogram, histogram + bin_count, 0);
+
+        int32 begin = chunk * Wavefront::sort_chunk_size;
+        int32 end = std::min(begin + Wavefront::sort_chunk_size, wf.ray_count);
+        for (int32 k = begin; k < end; ++k)
+        {
+            if (wf.hits[k])
+            {
+                histogram[material_bin(k)]++;
+            }
+        }
+    });
+
+    // Each chunk writes its rays of a material after the same material of the preceding chunks,
+    // which keeps the queue order within a material
+    int32 sum = 0;
+    for (int32 bin = 0; bin < bin_count; ++bin)
+    {
+        for (int32 chunk = 0; chunk < chunk_count; ++chunk)
+        {
+            int32& offset = wf.sort_offsets[size_t(chunk) * bin_count + bin];
+            int32 bin_size = offset;
+            offset = sum;
+            sum += bin_size;
+        }
+    }
+
+    wf.shade_count = sum;
+
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32* offset = &wf.sort_offsets[size_t(chunk) * bin_count];
+
+        int32 begin = chunk * Wavefront::sort_chunk_size;
+        int32 end = std::min(begin + Wavefront::sort_chunk_size, wf.ray_count);
+        for (int32 k = begin; k < end; ++k)
+        {
+            if (wf.hits[k])
+            {
+                wf.shade_order[offset[material_bin(k)]++] = k;
+            }
+        }
+    });
+}
+
+// Same as one iteration of PathIntegrator::Li for the rays that hit a surface.
+// The next ray is written in place of the current one and the direct light is queued as a shadow ray
+void WavefrontPathIntegrator::ShadeHits(Wavefront& wf) const
+{
+    ParallelFor(0, wf.ray_count, [&](int32 k) {
+        wf.continued[k] = false;
+        wf.shadow_valid[k] = false;
+    });
+
+    ParallelFor(0, wf.shade_count, [&](int32 i) {
+        int32 k = wf.shade_order[i];
+        int32 path = wf.ray_paths[k];
+
+        Ray& ray = wf.rays[k];
+        Intersection& isect = wf.isects[k];
+        Sampler& sampler = *wf.samplers[path];
+
+        Spectrum& L = wf.L[path];
+        Spectrum& beta = wf.beta[path];
+        int32& bounce = wf.bounces[path];
+        Float prev_bsdf_pdf = wf.prev_bsdf_pdfs[path];
+
+        Vec3 wo = Normalize(-ray.d);
+
+        if (Spectrum Le = isect.Le(wo); !Le.IsBlack())
+        {
+            bool has_area_light = area_lights.contains(isect.primitive);
+            if (bounce == 0 || wf.specular_bounces[path] || !has_area_light)
+            {
+                L += beta * Le;
+            }
+            else if (has_area_light)
+            {
+                // Evaluate BSDF sample with MIS for area light
+                AreaLight* area_light = area_lights.at(isect.primitive);
+                Intersection prev_isect{ .point = wf.prev_points[path], .normal = wf.prev_normals[path] };
+
+                Float light_pdf = isect.primitive->GetShape()->PDF(isect, ray);
+                light_pdf *= light_sampler->EvaluatePMF(prev_isect, area_light);
+                Float mis_weight = PowerHeuristic(1, prev_bsdf_pdf, 1, light_pdf);
+
+                L += beta * mis_weight * Le;
+            }
+        }
+
+        if (bounce++ >= max_bounces)
+        {
+            return;
+        }
+
+        int8 mem[max_bxdf_size];
+        Resource res(mem, sizeof(mem));
+        Allocator alloc(&res);
+        BSDF bsdf;
+        if (!isect.GetBSDF(&bsdf, wo, alloc))
+        {
+            ray = Ray(isect.point, -wo);
+            --bounce;
+            wf.continued[k] = true;
+            return;
+        }
+
+        // Blur bsdf if possible
+        if (regularize_bsdf && wf.any_non_specular_bounces[path])
+        {
+            bsdf.Regularize();
+        }
+
+        // Sample direct light, the shadow ray is traced in the next stage
+        if (IsNonSpecular(bsdf.Flags()))
+        {
+            Float u0 = sampler.Next1D();
+            Point2 u12 = sampler.Next2D();
+            SampledLight sampled_light;
+            if (light_sampler->Sample(&sampled_light, isect, u0))
+            {
+                LightSample light_sample = sampled_light.light->Sample_Li(isect, u12);
+                Float bsdf_pdf = bsdf.PDF(wo, light_sample.wi);
+                if (!light_sample.Li.IsBlack() && bsdf_pdf != 0)
+                {
+                    Float light_pdf = light_sample.pdf / sampled_light.weight;
+                    Spectrum f_cos = bsdf.f(wo, light_sample.wi) * AbsDot(isect.shading.normal, light_sample.wi);
+
+                    if (sampled_light.light->IsDeltaLight())
+                    {
+                        wf.shadow_Ld[k] = beta * light_sample.Li * f_cos / light_pdf;
+                    }
+                    else
+                    {
+                        Float mis_weight = PowerHeuristic(1, light_pdf, 1, bsdf_pdf);
+                        wf.shadow_Ld[k] = beta * mis_weight * light_sample.Li * f_cos / light_pdf;
+                    }
+
+                    wf.shadow_rays[k] = Ray(isect.point, light_sample.wi);
+                    wf.shadow_t_max[k] = light_sample.visibility;
+                    wf.shadow_valid[k] = true;
+                }
+            }
+        }
+
+        BSDFSample bsdf_sample;
+        if (!bsdf.Sample_f(&bsdf_sample, wo, sampler.Next1D(), sampler.Next2D()))
+        {
+            return;
+        }
+
+        wf.specular_bounces[path] = bsdf_sample.IsSpecular();
+        wf.any_non_specular_bounces[path] |= !bsdf_sample.IsSpecular();
+        if (bsdf_sample.IsTransmission())
+        {
+            wf.eta_scales[path] *= Sqr(bsdf_sample.eta);
+        }
+
+        // Save bsdf pdf and the scattering point for MIS
+        wf.prev_bsdf_pdfs[path] = bsdf_sample.pdf;
+        wf.prev_points[path] = isect.point;
+        wf.prev_normals[path] = isect.normal;
+        beta *= bsdf_sample.f * AbsDot(isect.shading.normal, bsdf_sample.wi) / bsdf_sample.pdf;
+        ray = Ray(isect.point, bsdf_sample.wi);
+
+        // Terminate path with russian roulette
+        constexpr int32 min_bounces = 2;
+        if (bounce > min_bounces)
+        {
+            Float p = beta.MaxComponent() * wf.eta_scales[path];
+            if (p < 1 && sampler.Next1D() > p)
+            {
+                BulbitStatIncrement(Stat::russian_roulette_terminations);
+                return;
+            }
+
+            beta /= p;
+        }
+
+        wf.continued[k] = true;
+    });
+
+    // Compact the shadow rays and the continued paths, keeping the order of the queue
+    int32 shadow_count = 0;
+    int32 ray_count = 0;
+    for (int32 k = 0; k < wf.ray_count; ++k)
+    {
+        if (wf.shadow_valid[k])
+        {
+            wf.shadow_rays[shadow_count] = wf.shadow_rays[k];
+            wf.shadow_t_max[shadow_count] = wf.shadow_t_max[k];
+            wf.shadow_Ld[shadow_count] = wf.shadow_Ld[k];
+            wf.shadow_paths[shadow_count] = wf.ray_paths[k];
+            ++shadow_count;
+        }
+
+        if (wf.continued[k])
+        {
+            wf.rays[ray_count] = wf.rays[k];
+            wf.ray_paths[ray_count] = wf.ray_paths[k];
+            ++ray_count;
+        }
+    }
+
+    wf.shadow_count = shadow_count;
+    wf.ray_count = ray_count;
+}
+
+void WavefrontPathIntegrator::TraceShadowRays(Wavefront& wf) const
+{
+    // A path has at most one shadow ray per bounce, so the contributions can be added in parallel
+    ParallelFor(0, wf.shadow_count, [&](int32 begin, int32 end) {
+        size_t count = end - begin;
+        IntersectAnyBatch(
+            std::span(&wf.occluded[begin], count), std::span(&wf.shadow_rays[begin], count), Ray::epsilon,
+            std::span(&wf.shadow_t_max[begin], count)
+        );
+
+        for (int32 i = begin; i < end; ++i)
+        {
+            if (!wf.occluded[i])
+            {
+                wf.L[wf.shadow_paths[i]] += wf.shadow_Ld[i];
+            }
+        }
+    });
+}
+
+// Samples are added pixel by pixel in the sample order, so the sums match the tiled renderer bit for bit
+void WavefrontPathIntegrator::AccumulateSamples(Wavefront& wf, Film& film) const
+{
+    const int64 first_pixel = wf.path_begin / wf.spp;
+    const int64 last_pixel = (wf.path_end - 1) / wf.spp;
+
+    ParallelFor(0, int32(last_pixel - first_pixel + 1), [&](int32 i) {
+        int64 pixel_index = first_pixel + i;
+        int64 begin = std::max<int64>(pixel_index * wf.spp, wf.path_begin);
+        int64 end = std::min<int64>((pixel_index + 1) * wf.spp, wf.path_end);
+
+        for (int64 index = begin; index < end; ++index)
+        {
+            int32 path = int32(index - wf.path_begin);
+
+            const Spectrum& L = wf.L[path];
+            if (!L.IsNullish())
+            {
+                film.AddSample(wf.pixels[pixel_index], wf.camera_weights[path] * L, 1);
+            }
+
+            BulbitStatRecord(StatHistogram::path_length, wf.bounces[path]);
+        }
+    });
+}
+
+} // namespace bulbit
@@ -1,5 +1,6 @@
 #include "bulbit/lights.h"
 #include "bulbit/materials.h"
+#include "bulbit/shapes.h"
 
 namespace bulbit
 {
@@ -46,4 +47,100 @@ Spectrum AreaLight::Le(const Ray& ray) const
     return primitive->GetMaterial()->Le(isect, -ray.d);
 }
 
+// Surface of the shape and the average radiance emitted from its front and back, over a grid of texture coordinates.
+// Exact for constant emission. The normal is the front side of a triangle, the cone of normals of a sphere is the whole sphere
+static bool GetEmission(
+    const Primitive* primitive, Float* area, Vec3* normal, Float* cos_theta_o, Spectrum* front_l, Spectrum* back_l
+)
+{
+    const Shape* shape = primitive->GetShape();
+    if (const Triangle* triangle = dynamic_cast<const Triangle*>(shape))
+    {
+        Point3 p0, p1, p2;
+        triangle->GetVertices(&p0, &p1, &p2);
+
+        *normal = Cross(p1 - p0, p2 - p0);
+        *area = 0.5f * normal->Normalize();
+        *cos_theta_o = 1;
+    }
+    else if (const Sphere* sphere = dynamic_cast<const Sphere*>(shape))
+    {
+        *area = four_pi * Sqr(sphere->radius);
+        *normal = z_axis;
+        *cos_theta_o = -1;
+    }
+    else
+    {
+        return false;
+    }
+
+    constexpr int32 grid_size = 4;
+
+    Intersection isect{ .primitive = primitive, .point = shape->GetAABB().GetCenter(), .normal = *normal };
+    isect.shading.normal = *normal;
+
+    *front_l = Spectrum::black;
+    *back_l = Spectrum::black;
+    for (int32 j = 0; j < grid_size; ++j)
+    {
+        for (int32 i = 0; i < grid_size; ++i)
+        {
+            isect.uv = Point2((i + 0.5f) / grid_size, (j + 0.5f) / grid_size);
+
+            isect.front_face = true;
+            *front_l += primitive->GetMaterial()->Le(isect, *normal);
+            isect.front_face = false;
+            *back_l += primitive->GetMaterial()->Le(isect, -*normal);
+        }
+    }
+
+    *front_l /= Sqr(grid_size);
+    *back_l /= Sqr(grid_size);
+
+    return true;
+}
+
+Spectrum AreaLight::Phi(Float world_radius) const
+{
+    BulbitNotUsed(world_radius);
+
+    Float area, cos_theta_o;
+    Vec3 normal;
+    Spectrum front_l, back_l;
+    if (!GetEmission(primitive, &area, &normal, &cos_theta_o, &front_l, &back_l))
+    {
+        return Spectrum::black;
+    }
+
+    // Lambertian emission from either side
+    return pi * area * (front_l + back_l);
+}
+
+bool AreaLight::GetBounds(LightBounds* bounds) const
+{
+    Float area, cos_theta_o;
+    Vec3 normal;
+    Spectrum front_l, back_l;
+    if (!GetEmission(primitive, &area, &normal, &cos_theta_o, &front_l, &back_l))
+    {
+        return false;
+    }
+
+    Float front = front_l.MaxComponent();
+    Float back = back_l.MaxComponent();
+    if (front == 0 && back == 0)
+    {
+        return false;
+    }
+
+    bounds->aabb = primitive->GetShape()->GetAABB();
+    bounds->w = front > 0 ? normal : -normal;
+    bounds->phi = pi * area * (front + back);
+    bounds->cos_theta_o = cos_theta_o;
+    bounds->cos_theta_e = 0; // Lambertian emission falls off over the hemisphere
+    bounds->two_sided = front > 0 && back > 0;
+
+    return true;
+}
+
 } // namespace bulbit
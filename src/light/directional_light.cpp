@@ -32,4 +32,15 @@ Float DirectionalLight::EvaluatePDF(const Ray& ray) const
     return 0;
 }
 
+Spectrum DirectionalLight::Phi(Float world_radius) const
+{
+    return pi * Sqr(world_radius) * intensity;
+}
+
+bool DirectionalLight::GetBounds(LightBounds* bounds) const
+{
+    BulbitNotUsed(bounds);
+    return false;
+}
+
 } // namespace bulbit
@@ -1,5 +1,6 @@
 #include "bulbit/frame.h"
 #include "bulbit/lights.h"
+#include "bulbit/parallel_for.h"
 
 #include <memory>
 
@@ -16,8 +17,7 @@ ImageInfiniteLight::ImageInfiniteLight(const SpectrumImageTexture* l_map, const
     int32 height = l_map->GetHeight();
 
     std::unique_ptr<Float[]> image(new Float[width * height]);
-    for (int32 v = 0; v < height; ++v)
-    {
+    ParallelFor(0, height, [&](int32 v) {
         Float vp = (v + 0.5f) / height;
         Float sin_theta = std::sin(pi * vp);
 
@@ -26,7 +26,7 @@ ImageInfiniteLight::ImageInfiniteLight(const SpectrumImageTexture* l_map, const
             Float up = Float(u) / width;
             image[u + v * width] = (Float)std::fmax(0, sin_theta * l_map->Evaluate(Point2(up, vp)).Luminance());
         }
-    }
+    });
 
     distribution.reset(new Distribution2D(image.get(), width, height));
 }
@@ -90,4 +90,33 @@ Spectrum ImageInfiniteLight::Le(const Ray& ray) const
     return l_scale * l_map->Evaluate(uv);
 }
 
+Spectrum ImageInfiniteLight::Phi(Float world_radius) const
+{
+    int32 width = l_map->GetWidth();
+    int32 height = l_map->GetHeight();
+
+    // Radiance integrated over the sphere, the texels of the equirectangular map shrink with sin(theta)
+    Spectrum sum_l(0);
+    for (int32 v = 0; v < height; ++v)
+    {
+        Float vp = (v + 0.5f) / height;
+        Float sin_theta = std::sin(pi * vp);
+
+        for (int32 u = 0; u < width; ++u)
+        {
+            Float up = (u + 0.5f) / width;
+            sum_l += sin_theta * l_map->Evaluate(Point2(up, vp));
+        }
+    }
+
+    Float d_omega = (two_pi / width) * (pi / height);
+    return pi * Sqr(world_radius) * l_scale * d_omega * sum_l;
+}
+
+bool ImageInfiniteLight::GetBounds(LightBounds* bounds) const
+{
+    BulbitNotUsed(bounds);
+    return false;
+}
+
 } // namespace bulbit
@@ -0,0 +1,134 @@
+#include "bulbit/light.h"
+
+namespace bulbit
+{
+
+// Cosine of max(0, theta_a - theta_b)
+static Float CosSubClamped(Float sin_theta_a, Float cos_theta_a, Float sin_theta_b, Float cos_theta_b)
+{
+    if (cos_theta_a > cos_theta_b)
+    {
+        return 1;
+    }
+
+    return cos_theta_a * cos_theta_b + sin_theta_a * sin_theta_b;
+}
+
+// Sine of max(0, theta_a - theta_b)
+static Float SinSubClamped(Float sin_theta_a, Float cos_theta_a, Float sin_theta_b, Float cos_theta_b)
+{
+    if (cos_theta_a > cos_theta_b)
+    {
+        return 0;
+    }
+
+    return sin_theta_a * cos_theta_b - cos_theta_a * sin_theta_b;
+}
+
+// Smallest cone around the directions of both cones
+static void UnionCones(Vec3* w, Float* cos_theta, const Vec3& w1, Float cos_theta1, const Vec3& w2, Float cos_theta2)
+{
+    Float theta1 = std::acos(Clamp(cos_theta1, -1, 1));
+    Float theta2 = std::acos(Clamp(cos_theta2, -1, 1));
+    Float theta_d = std::acos(Clamp(Dot(w1, w2), -1, 1));
+
+    // One cone contains the other
+    if (std::min<Float>(theta_d + theta2, pi) <= theta1)
+    {
+        *w = w1;
+        *cos_theta = cos_theta1;
+        return;
+    }
+    if (std::min<Float>(theta_d + theta1, pi) <= theta2)
+    {
+        *w = w2;
+        *cos_theta = cos_theta2;
+        return;
+    }
+
+    Float theta_o = (theta1 + theta_d + theta2) / 2;
+    Vec3 axis = Cross(w1, w2);
+    if (theta_o >= pi || Length2(axis) == 0)
+    {
+        *w = z_axis;
+        *cos_theta = -1;
+        return;
+    }
+
+    // Rotate w1 towards w2, the axis is perpendicular to w1
+    axis.Normalize();
+    Float theta_r = theta_o - theta1;
+    *w = w1 * std::cos(theta_r) + Cross(axis, w1) * std::sin(theta_r);
+    *cos_theta = std::cos(theta_o);
+}
+
+Float LightBounds::Importance(const Point3& p, const Vec3& n) const
+{
+    Point3 pc = aabb.GetCenter();
+    Float d2 = Dist2(p, pc);
+    d2 = std::max(d2, Length(aabb.GetExtents()) / 2);
+
+    Vec3 wi = Normalize(p - pc);
+    Float cos_theta_w = Dot(w, wi);
+    if (two_sided)
+    {
+        cos_theta_w = std::abs(cos_theta_w);
+    }
+    Float sin_theta_w = SafeSqrt(1 - Sqr(cos_theta_w));
+
+    // Cone of the directions from p to the bounding sphere of the light
+    Point3 center;
+    Float radius;
+    aabb.ComputeBoundingSphere(&center, &radius);
+    Float cos_theta_b = -1;
+    if (Float dist2 = Dist2(p, center); dist2 > Sqr(radius))
+    {
+        cos_theta_b = SafeSqrt(1 - Sqr(radius) / dist2);
+    }
+    Float sin_theta_b = SafeSqrt(1 - Sqr(cos_theta_b));
+
+    // Smallest angle between the emission cone and the direction to p, over all points of the bounds
+    Float sin_theta_o = SafeSqrt(1 - Sqr(cos_theta_o));
+    Float cos_theta_x = CosSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    Float sin_theta_x = SinSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    Float cos_theta_p = CosSubClamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+    if (cos_theta_p <= cos_theta_e)
+    {
+        return 0;
+    }
+
+    Float importance = phi * cos_theta_p / d2;
+
+    // Cosine at the receiving point, either side since the surface may transmit
+    if (n != Vec3::zero)
+    {
+        Float cos_theta_i = AbsDot(wi, n);
+        Float sin_theta_i = SafeSqrt(1 - Sqr(cos_theta_i));
+        importance *= CosSubClamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+    }
+
+    return std::max<Float>(importance, 0);
+}
+
+LightBounds LightBounds::Union(const LightBounds& lb1, const LightBounds& lb2)
+{
+    if (lb1.phi == 0)
+    {
+        return lb2;
+    }
+    if (lb2.phi == 0)
+    {
+        return lb1;
+    }
+
+    LightBounds lb;
+    lb.aabb = AABB::Union(lb1.aabb, lb2.aabb);
+    UnionCones(&lb.w, &lb.cos_theta_o, lb1.w, lb1.cos_theta_o, lb2.w, lb2.cos_theta_o);
+    lb.phi = lb1.phi + lb2.phi;
+    lb.cos_theta_e = std::min(lb1.cos_theta_e, lb2.cos_theta_e);
+    lb.two_sided = lb1.two_sided || lb2.two_sided;
+
+    return lb;
+}
+
+} // namespace bulbit
@@ -33,4 +33,22 @@ Float PointLight::EvaluatePDF(const Ray& ray) const
     return 0;
 }
 
+Spectrum PointLight::Phi(Float world_radius) const
+{
+    BulbitNotUsed(world_radius);
+    return four_pi * intensity;
+}
+
+bool PointLight::GetBounds(LightBounds* bounds) const
+{
+    bounds->aabb = AABB(position, position);
+    bounds->w = z_axis;
+    bounds->phi = four_pi * intensity.MaxComponent();
+    bounds->cos_theta_o = -1; // Emits in all directions
+    bounds->cos_theta_e = 0;
+    bounds->two_sided = false;
+
+    return true;
+}
+
 } // namespace bulbit
@@ -35,4 +35,15 @@ Spectrum UniformInfiniteLight::Le(const Ray& ray) const
     return scale * l;
 }
 
+Spectrum UniformInfiniteLight::Phi(Float world_radius) const
+{
+    return four_pi * pi * Sqr(world_radius) * scale * l;
+}
+
+bool UniformInfiniteLight::GetBounds(LightBounds* bounds) const
+{
+    BulbitNotUsed(bounds);
+    return false;
+}
+
 } // namespace bulbit
@@ -0,0 +1,269 @@
+#include "bulbit/light_samplers.h"
+#include "bulbit/lights.h"
+#include "bulbit/sampling.h"
+
+#include <bit>
+
+namespace bulbit
+{
+
+BVHLightSampler::BVHLightSampler(std::span<Light*> lights)
+    : LightSampler(lights)
+{
+    std::vector<BVHLight> bvh_lights;
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        LightBounds bounds;
+        if (!lights[i]->GetBounds(&bounds))
+        {
+            unbounded_lights.push_back(lights[i]);
+        }
+        else if (bounds.phi > 0)
+        {
+            bvh_lights.push_back(BVHLight{ int32(i), bounds });
+        }
+
+        // Lights that emit nothing, e.g. degenerate triangles, are never chosen
+    }
+
+    if (!bvh_lights.empty())
+    {
+        nodes.reserve(2 * bvh_lights.size() - 1);
+        BuildNodes(bvh_lights, 0, 0);
+    }
+}
+
+// Orientation weighted SAH cost of a child, the measure of the solid angle of its emission times its power and surface area.
+// Kr favors splitting along the longest axis of the node
+static Float EvaluateCost(const LightBounds& lb, const AABB& node_bounds, int32 axis)
+{
+    Float theta_o = std::acos(Clamp(lb.cos_theta_o, -1, 1));
+    Float theta_e = std::acos(Clamp(lb.cos_theta_e, -1, 1));
+    Float theta_w = std::min<Float>(theta_o + theta_e, pi);
+    Float sin_theta_o = SafeSqrt(1 - Sqr(lb.cos_theta_o));
+
+    Float m_omega = two_pi * (1 - lb.cos_theta_o) + pi / 2 * (2 * theta_w * sin_theta_o - std::cos(theta_o - 2 * theta_w) -
+                                                              2 * theta_o * sin_theta_o + lb.cos_theta_o);
+
+    Vec3 extents = node_bounds.GetExtents();
+    Float kr = std::max({ extents.x, extents.y, extents.z }) / extents[axis];
+
+    return lb.phi * m_omega * kr * lb.aabb.GetSurfaceArea();
+}
+
+int32 BVHLightSampler::BuildNodes(std::span<BVHLight> bvh_lights, uint64 bit_trail, int32 depth)
+{
+    BulbitAssert(depth < 64);
+
+    if (bvh_lights.size() == 1)
+    {
+        int32 node_index = int32(nodes.size());
+        nodes.push_back(Node{ bvh_lights[0].bounds, bvh_lights[0].index, true });
+        bit_trails.emplace(lights[bvh_lights[0].index], bit_trail);
+        return node_index;
+    }
+
+    AABB bounds, centroid_bounds;
+    for (const BVHLight& bvh_light : bvh_lights)
+    {
+        bounds = AABB::Union(bounds, bvh_light.bounds.aabb);
+        centroid_bounds = AABB::Union(centroid_bounds, bvh_light.bounds.aabb.GetCenter());
+    }
+
+    // The bit trail has a bit for every level, a subtree split at the median from here on is ceil(log2(n)) levels deeper.
+    // The unbalanced SAH splits are only taken while such a subtree still fits into the 64 bits
+    const bool balanced = depth + int32(std::bit_width(bvh_lights.size() - 1)) >= 63;
+
+    constexpr int32 bucket_size = 12;
+
+    auto get_bucket_index = [&](const BVHLight& bvh_light, int32 axis) {
+        Float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        int32 bucket_index = int32(bucket_size * (bvh_light.bounds.aabb.GetCenter()[axis] - centroid_bounds.min[axis]) / extent);
+        return std::clamp(bucket_index, 0, bucket_size - 1);
+    };
+
+    // Find the cheapest bucket split over all axes
+    Float min_cost = infinity;
+    int32 min_cost_axis = -1;
+    int32 min_cost_bucket = -1;
+    for (int32 axis = 0; axis < 3 && !balanced; ++axis)
+    {
+        if (centroid_bounds.max[axis] == centroid_bounds.min[axis])
+        {
+            continue;
+        }
+
+        LightBounds buckets[bucket_size] = {};
+        for (const BVHLight& bvh_light : bvh_lights)
+        {
+            int32 b = get_bucket_index(bvh_light, axis);
+            buckets[b] = LightBounds::Union(buckets[b], bvh_light.bounds);
+        }
+
+        for (int32 i = 0; i < bucket_size - 1; ++i)
+        {
+            LightBounds left = {}, right = {};
+            for (int32 j = 0; j <= i; ++j)
+            {
+                left = LightBounds::Union(left, buckets[j]);
+            }
+            for (int32 j = i + 1; j < bucket_size; ++j)
+            {
+                right = LightBounds::Union(right, buckets[j]);
+            }
+
+            Float cost = EvaluateCost(left, bounds, axis) + EvaluateCost(right, bounds, axis);
+            if (cost > 0 && cost < min_cost)
+            {
+                min_cost = cost;
+                min_cost_axis = axis;
+                min_cost_bucket = i;
+            }
+        }
+    }
+
+    size_t mid = 0;
+    if (min_cost_axis != -1)
+    {
+        auto it = std::partition(bvh_lights.begin(), bvh_lights.end(), [&](const BVHLight& bvh_light) {
+            return get_bucket_index(bvh_light, min_cost_axis) <= min_cost_bucket;
+        });
+        mid = it - bvh_lights.begin();
+    }
+
+    if (mid == 0 || mid == bvh_lights.size())
+    {
+        // Median split along the longest axis of the centroids
+        Vec3 extents = centroid_bounds.GetExtents();
+        int32 axis = 0;
+        if (extents.y > extents[axis])
+        {
+            axis = 1;
+        }
+        if (extents.z > extents[axis])
+        {
+            axis = 2;
+        }
+
+        mid = bvh_lights.size() / 2;
+        std::nth_element(
+            bvh_lights.begin(), bvh_lights.begin() + mid, bvh_lights.end(), [axis](const BVHLight& a, const BVHLight& b) {
+                return a.bounds.aabb.GetCenter()[axis] < b.bounds.aabb.GetCenter()[axis];
+            }
+        );
+    }
+
+    // Reserve the node, the first child follows it
+    int32 node_index = int32(nodes.size());
+    nodes.push_back(Node{});
+
+    int32 child0 = BuildNodes(bvh_lights.subspan(0, mid), bit_trail, depth + 1);
+    int32 child1 = BuildNodes(bvh_lights.subspan(mid), bit_trail | (uint64(1) << depth), depth + 1);
+    BulbitAssert(child0 == node_index + 1);
+    BulbitNotUsed(child0);
+
+    nodes[node_index] = Node{ LightBounds::Union(nodes[node_index + 1].bounds, nodes[child1].bounds), child1, false };
+
+    return node_index;
+}
+
+Float BVHLightSampler::UnboundedProbability() const
+{
+    return Float(unbounded_lights.size()) / (unbounded_lights.size() + (nodes.empty() ? 0 : 1));
+}
+
+bool BVHLightSampler::Sample(SampledLight* sl, const Intersection& isect, Float u) const
+{
+    if (unbounded_lights.empty() && nodes.empty())
+    {
+        return false;
+    }
+
+    Float p_unbounded = UnboundedProbability();
+    if (u < p_unbounded)
+    {
+        size_t count = unbounded_lights.size();
+        size_t index = std::min(size_t(u / p_unbounded * count), count - 1);
+
+        sl->light = unbounded_lights[index];
+        sl->weight = count / p_unbounded;
+
+        return true;
+    }
+
+    u = std::min<Float>((u - p_unbounded) / (1 - p_unbounded), Float(1) - epsilon);
+
+    Float pmf = 1 - p_unbounded;
+    int32 node_index = 0;
+    while (true)
+    {
+        const Node& node = nodes[node_index];
+        if (node.is_leaf)
+        {
+            // A single light is the root, it has not been weighed against another
+            if (node_index > 0 || node.bounds.Importance(isect.point, isect.normal) > 0)
+            {
+                sl->light = lights[node.child_or_light_index];
+                sl->weight = 1 / pmf;
+                return true;
+            }
+
+            return false;
+        }
+
+        Float importances[2] = { nodes[node_index + 1].bounds.Importance(isect.point, isect.normal),
+                                 nodes[node.child_or_light_index].bounds.Importance(isect.point, isect.normal) };
+        if (importances[0] == 0 && importances[1] == 0)
+        {
+            return false;
+        }
+
+        Float node_pmf;
+        int32 child = SampleDiscrete(importances, u, &node_pmf, &u);
+
+        pmf *= node_pmf;
+        node_index = child == 0 ? node_index + 1 : node.child_or_light_index;
+    }
+}
+
+Float BVHLightSampler::EvaluatePMF(const Intersection& ref, const Light* light) const
+{
+    auto it = bit_trails.find(light);
+    if (it == bit_trails.end())
+    {
+        if (std::find(unbounded_lights.begin(), unbounded_lights.end(), light) == unbounded_lights.end())
+        {
+            return 0;
+        }
+
+        return 1 / Float(unbounded_lights.size() + (nodes.empty() ? 0 : 1));
+    }
+
+    // Follow the path of the light down from the root, taking the same choices as Sample()
+    uint64 bit_trail = it->second;
+    Float pmf = 1 - UnboundedProbability();
+    int32 node_index = 0;
+    while (true)
+    {
+        const Node& node = nodes[node_index];
+        if (node.is_leaf)
+        {
+            return node_index > 0 || node.bounds.Importance(ref.point, ref.normal) > 0 ? pmf : 0;
+        }
+
+        Float importances[2] = { nodes[node_index + 1].bounds.Importance(ref.point, ref.normal),
+                                 nodes[node.child_or_light_index].bounds.Importance(ref.point, ref.normal) };
+        if (importances[0] == 0 && importances[1] == 0)
+        {
+            return 0;
+        }
+
+        int32 child = bit_trail & 1;
+        pmf *= importances[child] / (importances[0] + importances[1]);
+
+        node_index = child == 0 ? node_index + 1 : node.child_or_light_index;
+        bit_trail >>= 1;
+    }
+}
+
+} // namespace bulbit
@@ -0,0 +1,22 @@
+#include "bulbit/light_samplers.h"
+
+namespace bulbit
+{
+
+std::unique_ptr<LightSampler> CreateLightSampler(LightSamplerType type, std::span<Light*> lights, const AABB& world_bounds)
+{
+    switch (type)
+    {
+    case LightSamplerType::uniform:
+        return std::make_unique<UniformLightSampler>(lights);
+    case LightSamplerType::power:
+        return std::make_unique<PowerLightSampler>(lights, world_bounds);
+    case LightSamplerType::bvh:
+        return std::make_unique<BVHLightSampler>(lights);
+    default:
+        BulbitAssert(false);
+        return nullptr;
+    }
+}
+
+} // namespace bulbit
@@ -0,0 +1,64 @@
+#include "bulbit/light_samplers.h"
+#include "bulbit/lights.h"
+
+namespace bulbit
+{
+
+PowerLightSampler::PowerLightSampler(std::span<Light*> lights, const AABB& world_bounds)
+    : LightSampler(lights)
+{
+    if (lights.empty())
+    {
+        return;
+    }
+
+    Point3 world_center;
+    Float world_radius;
+    world_bounds.ComputeBoundingSphere(&world_center, &world_radius);
+
+    std::vector<Float> powers(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        powers[i] = std::max<Float>(lights[i]->Phi(world_radius).Average(), 0);
+        light_indices.emplace(lights[i], int32(i));
+    }
+
+    alias_table = AliasTable(powers);
+}
+
+bool PowerLightSampler::Sample(SampledLight* sl, const Intersection& isect, Float u) const
+{
+    BulbitNotUsed(isect);
+
+    if (alias_table.Count() == 0)
+    {
+        return false;
+    }
+
+    Float pmf;
+    int32 index = alias_table.Sample(u, &pmf);
+    if (pmf == 0)
+    {
+        return false;
+    }
+
+    sl->light = lights[index];
+    sl->weight = 1 / pmf;
+
+    return true;
+}
+
+Float PowerLightSampler::EvaluatePMF(const Intersection& ref, const Light* light) const
+{
+    BulbitNotUsed(ref);
+
+    auto it = light_indices.find(light);
+    if (it == light_indices.end())
+    {
+        return 0;
+    }
+
+    return alias_table.PMF(it->second);
+}
+
+} // namespace bulbit
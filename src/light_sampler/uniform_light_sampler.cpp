@@ -26,8 +26,9 @@ bool UniformLightSampler::Sample(SampledLight* sl, const Intersection& isect, Fl
     return true;
 }
 
-Float UniformLightSampler::EvaluatePMF(const Light* light) const
+Float UniformLightSampler::EvaluatePMF(const Intersection& ref, const Light* light) const
 {
+    BulbitNotUsed(ref);
     BulbitNotUsed(light);
 
     if (lights.size() > 0)
@@ -51,6 +51,11 @@ Float ConductorMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool ConductorMaterial::HasAlpha() const
+{
+    return alpha != nullptr;
+}
+
 const SpectrumTexture* ConductorMaterial::GetNormalMap() const
 {
     return normalmap;
@@ -22,6 +22,11 @@ Float DielectricMaterial::GetAlpha(const Intersection& isect) const
     return 1;
 }
 
+bool DielectricMaterial::HasAlpha() const
+{
+    return false;
+}
+
 const SpectrumTexture* DielectricMaterial::GetNormalMap() const
 {
     return normalmap;
@@ -25,6 +25,11 @@ Float DiffuseLightMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool DiffuseLightMaterial::HasAlpha() const
+{
+    return alpha != nullptr;
+}
+
 const SpectrumTexture* DiffuseLightMaterial::GetNormalMap() const
 {
     return nullptr;
@@ -25,6 +25,11 @@ Float DiffuseMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool DiffuseMaterial::HasAlpha() const
+{
+    return alpha != nullptr;
+}
+
 const SpectrumTexture* DiffuseMaterial::GetNormalMap() const
 {
     return normalmap;
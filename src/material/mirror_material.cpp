@@ -25,6 +25,11 @@ Float MirrorMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool MirrorMaterial::HasAlpha() const
+{
+    return alpha != nullptr;
+}
+
 const SpectrumTexture* MirrorMaterial::GetNormalMap() const
 {
     return normalmap;
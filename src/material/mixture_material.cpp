@@ -27,6 +27,11 @@ Float MixtureMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool MixtureMaterial::HasAlpha() const
+{
+    return materials[0]->HasAlpha() || materials[1]->HasAlpha();
+}
+
 const SpectrumTexture* MixtureMaterial::GetNormalMap() const
 {
     BulbitAssert(false);
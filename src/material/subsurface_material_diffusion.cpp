@@ -29,6 +29,12 @@ Float SubsurfaceDiffusionMaterial::GetAlpha(const Intersection& isect) const
     BulbitNotUsed(isect);
     return 1;
 }
+
+bool SubsurfaceDiffusionMaterial::HasAlpha() const
+{
+    return false;
+}
+
 const SpectrumTexture* SubsurfaceDiffusionMaterial::GetNormalMap() const
 {
     return normalmap;
@@ -31,6 +31,12 @@ Float SubsurfaceRandomWalkMaterial::GetAlpha(const Intersection& isect) const
     BulbitNotUsed(isect);
     return 1;
 }
+
+bool SubsurfaceRandomWalkMaterial::HasAlpha() const
+{
+    return false;
+}
+
 const SpectrumTexture* SubsurfaceRandomWalkMaterial::GetNormalMap() const
 {
     return normalmap;
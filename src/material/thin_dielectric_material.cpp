@@ -16,6 +16,11 @@ Float ThinDielectricMaterial::GetAlpha(const Intersection& isect) const
     return 1;
 }
 
+bool ThinDielectricMaterial::HasAlpha() const
+{
+    return false;
+}
+
 const SpectrumTexture* ThinDielectricMaterial::GetNormalMap() const
 {
     return nullptr;
@@ -37,6 +37,11 @@ Float UnrealMaterial::GetAlpha(const Intersection& isect) const
     }
 }
 
+bool UnrealMaterial::HasAlpha() const
+{
+    return alpha != nullptr;
+}
+
 const SpectrumTexture* UnrealMaterial::GetNormalMap() const
 {
     return normalmap;
@@ -6,6 +6,7 @@ namespace bulbit
 
 IndependentSampler::IndependentSampler(int32 samples_per_pixel, int32 seed)
     : Sampler(samples_per_pixel)
+    , seed(seed)
 {
     rng.Seed(seed);
 }
@@ -0,0 +1,47 @@
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+namespace bulbit
+{
+
+SobolSampler::SobolSampler(int32 samples_per_pixel, int32 seed)
+    : Sampler(samples_per_pixel)
+    , seed(seed)
+{
+}
+
+void SobolSampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+
+    dimension = 0;
+}
+
+Float SobolSampler::Next1D()
+{
+    uint64 hash = Hash(seed, current_pixel, dimension);
+    uint32 index = PermutationElement(current_sample_index, samples_per_pixel, uint32(hash));
+
+    dimension += 1;
+
+    return SobolSample(index, 0, uint32(hash >> 32));
+}
+
+Point2 SobolSampler::Next2D()
+{
+    uint64 hash = Hash(seed, current_pixel, dimension);
+    uint32 index = PermutationElement(current_sample_index, samples_per_pixel, uint32(hash));
+
+    dimension += 2;
+
+    // Both dimensions share the index and keep their joint stratification
+    uint64 scramble = MixBits(hash);
+    return { SobolSample(index, 0, uint32(scramble)), SobolSample(index, 1, uint32(scramble >> 32)) };
+}
+
+std::unique_ptr<Sampler> SobolSampler::Clone() const
+{
+    return std::make_unique<SobolSampler>(samples_per_pixel, seed);
+}
+
+} // namespace bulbit
@@ -0,0 +1,92 @@
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+#include <bit>
+
+namespace bulbit
+{
+
+ZSobolSampler::ZSobolSampler(int32 samples_per_pixel, const Point2i& resolution, int32 seed)
+    : Sampler(samples_per_pixel)
+    , resolution(resolution)
+    , seed(seed)
+{
+    log2_samples_per_pixel = std::bit_width(uint32(samples_per_pixel - 1));
+
+    int32 log2_resolution = std::bit_width(uint32(std::max(resolution.x, resolution.y) - 1));
+    base4_digits = log2_resolution + (log2_samples_per_pixel + 1) / 2;
+}
+
+void ZSobolSampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+
+    morton_index = (EncodeMorton2(pixel.x, pixel.y) << log2_samples_per_pixel) | sample_index;
+    dimension = 0;
+}
+
+// Permutes every base 4 digit of the Morton index by a hash of the digits above it, so that the sample indices
+// of the pixels stay a permutation of each other while the order along the curve is shuffled for every dimension
+uint64 ZSobolSampler::GetSampleIndex() const
+{
+    // clang-format off
+    static const uint8 permutations[24][4] = {
+        { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 }, { 0, 3, 2, 1 }, { 0, 3, 1, 2 },
+        { 1, 0, 2, 3 }, { 1, 0, 3, 2 }, { 1, 2, 0, 3 }, { 1, 2, 3, 0 }, { 1, 3, 2, 0 }, { 1, 3, 0, 2 },
+        { 2, 1, 0, 3 }, { 2, 1, 3, 0 }, { 2, 0, 1, 3 }, { 2, 0, 3, 1 }, { 2, 3, 0, 1 }, { 2, 3, 1, 0 },
+        { 3, 1, 2, 0 }, { 3, 1, 0, 2 }, { 3, 2, 1, 0 }, { 3, 2, 0, 1 }, { 3, 0, 2, 1 }, { 3, 0, 1, 2 },
+    };
+    // clang-format on
+
+    uint64 sample_index = 0;
+
+    // With an odd power of two samples per pixel, the lowest digit is in base 2
+    bool odd_digit = log2_samples_per_pixel & 1;
+    int32 last_digit = odd_digit ? 1 : 0;
+    for (int32 i = base4_digits - 1; i >= last_digit; --i)
+    {
+        int32 digit_shift = 2 * i - (odd_digit ? 1 : 0);
+        int32 digit = (morton_index >> digit_shift) & 3;
+
+        uint64 higher_digits = morton_index >> (digit_shift + 2);
+        int32 p = (MixBits(higher_digits ^ (0x55555555u * dimension)) >> 24) % 24;
+
+        digit = permutations[p][digit];
+        sample_index |= uint64(digit) << digit_shift;
+    }
+
+    if (odd_digit)
+    {
+        int32 digit = morton_index & 1;
+        sample_index |= digit ^ (MixBits((morton_index >> 1) ^ (0x55555555u * dimension)) & 1);
+    }
+
+    return sample_index;
+}
+
+Float ZSobolSampler::Next1D()
+{
+    uint64 sample_index = GetSampleIndex();
+    uint32 hash = uint32(Hash(dimension, seed));
+
+    dimension += 1;
+
+    return SobolSample(sample_index, 0, hash);
+}
+
+Point2 ZSobolSampler::Next2D()
+{
+    uint64 sample_index = GetSampleIndex();
+    uint64 hash = Hash(dimension, seed);
+
+    dimension += 2;
+
+    return { SobolSample(sample_index, 0, uint32(hash)), SobolSample(sample_index, 1, uint32(hash >> 32)) };
+}
+
+std::unique_ptr<Sampler> ZSobolSampler::Clone() const
+{
+    return std::make_unique<ZSobolSampler>(samples_per_pixel, resolution, seed);
+}
+
+} // namespace bulbit
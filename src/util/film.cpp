@@ -0,0 +1,55 @@
+#include "bulbit/film.h"
+
+#include <fstream>
+
+namespace bulbit
+{
+
+static constexpr uint32 film_magic_number = 0x4d4c4642; // "BFLM"
+static constexpr uint32 film_version_number = 1;
+
+bool WriteFilm(const Film& film, const std::filesystem::path& filename)
+{
+    std::ofstream out(filename, std::ios::binary);
+
+    out.write(reinterpret_cast<const char*>(&film_magic_number), sizeof(uint32));
+    out.write(reinterpret_cast<const char*>(&film_version_number), sizeof(uint32));
+    film.Write(out);
+
+    return bool(out);
+}
+
+std::unique_ptr<Film> ReadFilm(const std::filesystem::path& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+
+    uint32 magic, version;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(uint32));
+    in.read(reinterpret_cast<char*>(&version), sizeof(uint32));
+    if (!in || magic != film_magic_number || version != film_version_number)
+    {
+        return nullptr;
+    }
+
+    // Film::Read() starts with the resolution as well
+    std::streampos position = in.tellg();
+
+    Point2i resolution;
+    in.read(reinterpret_cast<char*>(&resolution), sizeof(Point2i));
+    if (!in || resolution.x <= 0 || resolution.y <= 0)
+    {
+        return nullptr;
+    }
+
+    in.seekg(position);
+
+    std::unique_ptr<Film> film = std::make_unique<Film>(resolution);
+    if (!film->Read(in))
+    {
+        return nullptr;
+    }
+
+    return film;
+}
+
+} // namespace bulbit
@@ -6,29 +6,131 @@
 namespace bulbit
 {
 
+// Chase-Lev deque with a fixed capacity (Le et al. 2013, Correct and Efficient Work-Stealing for Weak Memory Models).
+// A full deque refuses the push
+class ThreadPool::TaskDeque
+{
+public:
+    static constexpr int64 capacity = 1024;
+
+    bool Push(const Task& task)
+    {
+        int64 b = bottom.load(std::memory_order_relaxed);
+        int64 t = top.load(std::memory_order_acquire);
+        if (b - t >= capacity)
+        {
+            return false;
+        }
+
+        Slot& slot = slots[b & (capacity - 1)];
+        slot.job.store(task.job, std::memory_order_relaxed);
+        slot.range.store(PackRange(task.begin, task.end), std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner side, takes the most recently pushed task
+    bool Pop(Task* task)
+    {
+        int64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Read(b, task);
+
+        bool taken = true;
+        if (t == b)
+        {
+            // Last task, race against the thieves for it
+            taken = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return taken;
+    }
+
+    // Thief side, takes the oldest task
+    bool Steal(Task* task)
+    {
+        int64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+        {
+            return false;
+        }
+
+        Read(t, task);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<ParallelJob*> job;
+        std::atomic<uint64> range;
+    };
+
+    static uint64 PackRange(int32 begin, int32 end)
+    {
+        return (uint64(uint32(begin)) << 32) | uint32(end);
+    }
+
+    void Read(int64 index, Task* task) const
+    {
+        const Slot& slot = slots[index & (capacity - 1)];
+        uint64 range = slot.range.load(std::memory_order_relaxed);
+
+        task->job = slot.job.load(std::memory_order_relaxed);
+        task->begin = int32(uint32(range >> 32));
+        task->end = int32(uint32(range));
+    }
+
+    // Owner and thieves work on the opposite ends, keep them on separate cache lines
+    alignas(64) std::atomic<int64> top = 0;
+    alignas(64) std::atomic<int64> bottom = 0;
+    Slot slots[capacity];
+};
+
+// Deque of the calling thread, set for the worker threads of the pool
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local int32 current_deque = -1;
+
 ThreadPool::ThreadPool(int32 worker_count)
+    : queued_tasks{ 0 }
+    , sleeping_workers{ 0 }
+    , shutdown{ false }
 {
     worker_count = std::max(worker_count, 2);
 
     // Calling thread also participates in executing parallel work,
     // so we launches one fewer than the requested number of threads.
+    deque_count = worker_count;
+    deques = std::make_unique<TaskDeque[]>(deque_count);
+
     for (int32 i = 0; i < worker_count - 1; ++i)
     {
-        threads.emplace_back(&ThreadPool::Worker, this);
+        threads.emplace_back(&ThreadPool::Worker, this, i);
     }
 }
 
 ThreadPool::~ThreadPool()
 {
-    if (threads.empty())
-    {
-        return;
-    }
-
     {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<std::mutex> lock(sleep_mutex);
         shutdown = true;
-        job_list_condition.notify_all();
+        wake_condition.notify_all();
     }
 
     for (std::thread& thread : threads)
@@ -37,123 +139,174 @@ ThreadPool::~ThreadPool()
     }
 }
 
-void ThreadPool::Worker()
+void ThreadPool::Worker(int32 index)
 {
-    std::unique_lock<std::mutex> lock(mutex);
+    current_pool = this;
+    current_deque = index;
 
-    while (!shutdown)
+    while (!shutdown.load(std::memory_order_relaxed))
     {
-        WorkOrWait(&lock);
+        if (RunTask())
+        {
+            continue;
+        }
+
+        // Stay awake for a while, new tasks tend to follow shortly
+        constexpr int32 spin_count = 64;
+        bool found = false;
+        for (int32 i = 0; i < spin_count && !found; ++i)
+        {
+            std::this_thread::yield();
+            found = queued_tasks.load(std::memory_order_relaxed) > 0;
+        }
+
+        if (found)
+        {
+            continue;
+        }
+
+        // A pusher that reads sleeping_workers == 0 pushed before the count is checked below, so no wake up is lost
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleeping_workers.fetch_add(1);
+        while (queued_tasks.load() == 0 && !shutdown.load())
+        {
+            wake_condition.wait(lock);
+        }
+        sleeping_workers.fetch_sub(1);
     }
 }
 
-void ThreadPool::WorkOrWait(std::unique_lock<std::mutex>* lock)
+int32 ThreadPool::GetDequeIndex() const
+{
+    return current_pool == this ? current_deque : deque_count - 1;
+}
+
+// Returns false if the deque is full, the caller then runs the task itself
+bool ThreadPool::Push(const Task& task)
 {
-    BulbitAssert(lock->owns_lock() == true);
+    int32 index = GetDequeIndex();
 
-    // Pick one job that still has work left
-    ParallelJob* job = job_list;
-    while (job && job->HaveWork() == false)
+    bool pushed;
+    if (index == deque_count - 1)
     {
-        job = job->next;
+        std::lock_guard<std::mutex> lock(external_mutex);
+        pushed = deques[index].Push(task);
     }
-
-    if (job)
+    else
     {
-        // Execute work for this job
-        job->active_workers++;
-        job->RunStep(lock);
-
-        // Detach from this job
-        BulbitAssert(lock->owns_lock() == false);
-        lock->lock();
-        job->active_workers--;
+        pushed = deques[index].Push(task);
+    }
 
-        // If the job is completed,
-        // we must signal condition variable for the thread that initially add the work.
-        // That initial thread may be waiting on the condition variable for other threads to finish their work on the job.
-        if (job->Finished())
-        {
-            job_list_condition.notify_all();
-        }
+    if (!pushed)
+    {
+        return false;
     }
-    else
+
+    queued_tasks.fetch_add(1);
+    if (sleeping_workers.load() > 0)
     {
-        // Wait for new work to arrive or the job to finish
-        job_list_condition.wait(*lock);
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake_condition.notify_one();
     }
+
+    return true;
 }
 
-bool ThreadPool::WorkOrReturn()
+bool ThreadPool::Pop(Task* task)
 {
-    // Return false if we do nothing
+    int32 index = GetDequeIndex();
 
-    std::unique_lock<std::mutex> lock(mutex);
-
-    ParallelJob* job = job_list;
-    while (job && job->HaveWork() == false)
+    bool popped;
+    if (index == deque_count - 1)
+    {
+        std::lock_guard<std::mutex> lock(external_mutex);
+        popped = deques[index].Pop(task);
+    }
+    else
     {
-        job = job->next;
+        popped = deques[index].Pop(task);
     }
 
-    if (job == nullptr)
+    if (popped)
     {
-        return false;
+        queued_tasks.fetch_sub(1);
     }
 
-    job->active_workers++;
-    job->RunStep(&lock);
+    return popped;
+}
 
-    BulbitAssert(lock.owns_lock() == false);
-    lock.lock();
-    job->active_workers--;
+bool ThreadPool::Steal(Task* task)
+{
+    if (queued_tasks.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
 
-    if (job->Finished())
+    // Start from the next deque so that the thieves spread over the victims
+    int32 index = GetDequeIndex();
+    for (int32 i = 1; i < deque_count; ++i)
     {
-        job_list_condition.notify_all();
+        int32 victim = (index + i) % deque_count;
+        if (deques[victim].Steal(task))
+        {
+            queued_tasks.fetch_sub(1);
+            return true;
+        }
     }
 
-    return true;
+    return false;
 }
 
-std::unique_lock<std::mutex> ThreadPool::AddJob(ParallelJob* job)
+// Splits the range until it is no longer than the grain size, pushing the upper halves for the thieves
+void ThreadPool::Execute(Task task)
 {
-    job->thread_pool = this;
-
-    std::unique_lock<std::mutex> lock(mutex);
-
-    // Link job to head of list
+    while (task.end - task.begin > task.job->grain_size)
     {
-        if (job_list)
+        int32 mid = task.begin + (task.end - task.begin) / 2;
+        if (!Push(Task{ task.job, mid, task.end }))
         {
-            job_list->prev = job;
+            break;
         }
 
-        job->next = job_list;
-        job_list = job;
+        task.end = mid;
     }
 
-    // Notify to all workers
-    job_list_condition.notify_all();
-
-    return lock;
+    task.job->Execute(task.begin, task.end);
 }
 
-void ThreadPool::RemoveJob(ParallelJob* job)
+void ThreadPool::Submit(ParallelJob* job, int32 begin, int32 end)
 {
-    // The lock must be held before calling this function
-    if (job->prev)
+    BulbitAssert(begin < end);
+
+    job->thread_pool = this;
+    job->stat_counters = GetCurrentStatCounters();
+    if (!Push(Task{ job, begin, end }))
     {
-        job->prev->next = job->next;
+        Execute(Task{ job, begin, end });
     }
-    else
+}
+
+bool ThreadPool::RunTask()
+{
+    Task task;
+    if (!Pop(&task) && !Steal(&task))
     {
-        job_list = job->next;
+        return false;
     }
 
-    if (job->next)
+    Execute(task);
+    return true;
+}
+
+void ThreadPool::Wait(ParallelJob* job)
+{
+    while (!job->Finished())
     {
-        job->next->prev = job->prev;
+        if (!RunTask())
+        {
+            // Remaining tasks of the job are running on the other threads
+            std::this_thread::yield();
+        }
     }
 }
 
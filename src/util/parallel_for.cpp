@@ -3,23 +3,6 @@
 namespace bulbit
 {
 
-void ParallelForLoop::RunStep(std::unique_lock<std::mutex>* lock)
-{
-    int32 index_begin = next_index;
-    int32 index_end = std::min(index_begin + chunk_size, end_index);
-    next_index = index_end;
-
-    // Remove job from list if all work has been started
-    if (HaveWork() == false)
-    {
-        thread_pool->RemoveJob(this);
-    }
-
-    // Release lock and execute loop iterations in [begin, end)
-    lock->unlock();
-    func(index_begin, index_end);
-}
-
 void ParallelFor(int32 begin, int32 end, std::function<void(int32, int32)> func, ThreadPool* thread_pool)
 {
     if (begin == end)
@@ -40,13 +23,154 @@ void ParallelFor(int32 begin, int32 end, std::function<void(int32, int32)> func,
     // It's safe to allocate loop on the stack
     // Because this ParallelFor() call does not return until all work for the loop is done.
     ParallelForLoop loop(begin, end, chunk_size, std::move(func));
-    std::unique_lock<std::mutex> lock = thread_pool->AddJob(&loop);
+    thread_pool->Submit(&loop, begin, end);
+
+    // Current thread also work on the job, or on other jobs while the last chunks are running elsewhere
+    thread_pool->Wait(&loop);
+}
+
+// Cell at distance d along the Hilbert curve filling an n by n grid, n is a power of two
+static Point2i HilbertCurve(int32 n, int32 d)
+{
+    Point2i p(0, 0);
+    for (int32 s = 1; s < n; s *= 2)
+    {
+        int32 rx = 1 & (d / 2);
+        int32 ry = 1 & (d ^ rx);
+
+        // Rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                p.x = s - 1 - p.x;
+                p.y = s - 1 - p.y;
+            }
+            std::swap(p.x, p.y);
+        }
+
+        p.x += s * rx;
+        p.y += s * ry;
+        d /= 4;
+    }
+
+    return p;
+}
+
+std::vector<AABB2i> GenerateTiles(const Point2i& extents, int32 tile_size, TileOrder order)
+{
+    BulbitAssert(tile_size > 0);
+
+    int32 num_tiles_x = (extents.x + tile_size - 1) / tile_size;
+    int32 num_tiles_y = (extents.y + tile_size - 1) / tile_size;
+
+    std::vector<Point2i> indices;
+    indices.reserve(num_tiles_x * num_tiles_y);
+
+    switch (order)
+    {
+    case TileOrder::scanline:
+    case TileOrder::spiral:
+    {
+        for (int32 y = 0; y < num_tiles_y; ++y)
+        {
+            for (int32 x = 0; x < num_tiles_x; ++x)
+            {
+                indices.emplace_back(x, y);
+            }
+        }
+
+        if (order == TileOrder::spiral)
+        {
+            // Twice the offsets from the center, so that even tile counts have integer distances too
+            auto offset = [=](const Point2i& tile) {
+                return Point2i(2 * tile.x - num_tiles_x + 1, 2 * tile.y - num_tiles_y + 1);
+            };
 
-    // Current thread also work on the job
-    while (!loop.Finished())
+            std::stable_sort(indices.begin(), indices.end(), [&](const Point2i& a, const Point2i& b) {
+                Point2i oa = offset(a);
+                Point2i ob = offset(b);
+
+                int32 ring_a = std::max(std::abs(oa.x), std::abs(oa.y));
+                int32 ring_b = std::max(std::abs(ob.x), std::abs(ob.y));
+                if (ring_a != ring_b)
+                {
+                    return ring_a < ring_b;
+                }
+
+                return std::atan2(Float(oa.y), Float(oa.x)) < std::atan2(Float(ob.y), Float(ob.x));
+            });
+        }
+    }
+    break;
+
+    case TileOrder::hilbert:
     {
-        thread_pool->WorkOrWait(&lock);
+        // Walk the curve over the enclosing power of two grid and skip the cells outside of the image
+        int32 n = 1;
+        while (n < std::max(num_tiles_x, num_tiles_y))
+        {
+            n *= 2;
+        }
+
+        for (int32 d = 0; d < n * n; ++d)
+        {
+            Point2i tile = HilbertCurve(n, d);
+            if (tile.x < num_tiles_x && tile.y < num_tiles_y)
+            {
+                indices.push_back(tile);
+            }
+        }
+    }
+    break;
+
+    default:
+        BulbitAssert(false);
+        break;
     }
+
+    std::vector<AABB2i> tiles;
+    tiles.reserve(indices.size());
+
+    for (const Point2i& tile : indices)
+    {
+        int32 x0 = tile.x * tile_size;
+        int32 x1 = std::min(x0 + tile_size, extents.x);
+        int32 y0 = tile.y * tile_size;
+        int32 y1 = std::min(y0 + tile_size, extents.y);
+
+        tiles.emplace_back(Point2i(x0, y0), Point2i(x1, y1));
+    }
+
+    return tiles;
+}
+
+void ParallelFor2D(const std::vector<AABB2i>& tiles, std::function<void(int32 index, AABB2i tile)> func, ThreadPool* thread_pool)
+{
+    if (tiles.empty())
+    {
+        return;
+    }
+
+    if (!thread_pool)
+    {
+        for (int32 i = 0; i < int32(tiles.size()); ++i)
+        {
+            func(i, tiles[i]);
+        }
+        return;
+    }
+
+    // No chunking, a tile is plenty of work for one task.
+    // Chunks of several tiles leave the last chunk of a frame running on one thread while the others are idle
+    ParallelForLoop loop(0, int32(tiles.size()), 1, [&](int32 begin, int32 end) {
+        for (int32 i = begin; i < end; ++i)
+        {
+            func(i, tiles[i]);
+        }
+    });
+    thread_pool->Submit(&loop, 0, int32(tiles.size()));
+    thread_pool->Wait(&loop);
 }
 
 } // namespace bulbit
@@ -0,0 +1,70 @@
+#include "bulbit/parallel_for.h"
+#include "bulbit/sampling.h"
+
+namespace bulbit
+{
+
+Float Distribution2D::BuildCDF(Float* cdf, int32* guide, const Float* func, int32 n)
+{
+    cdf[0] = 0;
+    for (int32 i = 1; i < n + 1; ++i)
+    {
+        cdf[i] = cdf[i - 1] + func[i - 1] / n;
+    }
+
+    Float integral = cdf[n];
+    if (integral == 0)
+    {
+        for (int32 i = 1; i < n + 1; ++i)
+        {
+            cdf[i] = Float(i) / Float(n);
+        }
+    }
+    else
+    {
+        // Normalization
+        for (int32 i = 1; i < n + 1; ++i)
+        {
+            cdf[i] /= integral;
+        }
+    }
+
+    // The interval i holds u = k / m for cdf[i] <= k / m < cdf[i + 1]
+    int32 m = GuideCount(n);
+    int32 k = 0;
+    for (int32 i = 0; i < n; ++i)
+    {
+        int32 k_end = std::min(int32(std::ceil(cdf[i + 1] * m)), m);
+        for (; k < k_end; ++k)
+        {
+            guide[k] = i;
+        }
+    }
+    for (; k < m; ++k)
+    {
+        guide[k] = n - 1;
+    }
+
+    return integral;
+}
+
+Distribution2D::Distribution2D(const Float* func, int32 nu, int32 nv)
+    : nu{ nu }
+    , nv{ nv }
+    , data(size_t(nv) * nu + size_t(nv) * (nu + 1) + nv + (nv + 1) + 1)
+    , guides(size_t(nv) * GuideCount(nu) + GuideCount(nv))
+{
+    Float* funcs = data.data();
+    Float* cdfs = funcs + size_t(nv) * nu;
+    Float* marginal_func = cdfs + size_t(nv) * (nu + 1);
+    Float* marginal_cdf = marginal_func + nv;
+
+    ParallelFor(0, nv, [&](int32 v) {
+        std::copy(&func[size_t(v) * nu], &func[size_t(v + 1) * nu], &funcs[size_t(v) * nu]);
+        marginal_func[v] = BuildCDF(&cdfs[size_t(v) * (nu + 1)], &guides[size_t(v) * GuideCount(nu)], &funcs[size_t(v) * nu], nu);
+    });
+
+    marginal_cdf[nv + 1] = BuildCDF(marginal_cdf, &guides[size_t(nv) * GuideCount(nu)], marginal_func, nv);
+}
+
+} // namespace bulbit
@@ -0,0 +1,255 @@
+#include "bulbit/stats.h"
+
+#include <fstream>
+#include <mutex>
+
+namespace bulbit
+{
+
+struct StatInfo
+{
+    const char* category;
+    const char* name;
+};
+
+static constexpr StatInfo stat_infos[int32(Stat::count)] = {
+    { "integrator", "camera_rays" },
+    { "integrator", "russian_roulette_terminations" },
+    { "accelerator", "closest_hit_queries" },
+    { "accelerator", "any_hit_queries" },
+    { "accelerator", "bvh_nodes_visited" },
+    { "accelerator", "bvh_primitive_tests" },
+    { "accelerator", "alpha_test_retries" },
+};
+
+static constexpr StatInfo histogram_infos[int32(StatHistogram::count)] = {
+    { "integrator", "path_length" },
+};
+
+static constexpr const char* categories[] = { "integrator", "accelerator" };
+
+Statistics Statistics::operator-(const Statistics& other) const
+{
+    Statistics difference;
+    for (int32 i = 0; i < int32(Stat::count); ++i)
+    {
+        difference.counters[i] = counters[i] - other.counters[i];
+    }
+
+    for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+    {
+        for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+        {
+            difference.histograms[i][j] = histograms[i][j] - other.histograms[i][j];
+        }
+    }
+
+    return difference;
+}
+
+#if defined(BULBIT_ENABLE_STATS)
+
+static std::mutex thread_stats_mutex;
+static std::vector<std::unique_ptr<ThreadStatistics>> thread_stats;
+
+ThreadStatistics* CreateThreadStatistics()
+{
+    std::lock_guard<std::mutex> lock(thread_stats_mutex);
+    thread_stats.push_back(std::make_unique<ThreadStatistics>());
+    return thread_stats.back().get();
+}
+
+Statistics GetStatistics()
+{
+    Statistics stats;
+
+    std::lock_guard<std::mutex> lock(thread_stats_mutex);
+    for (const std::unique_ptr<ThreadStatistics>& thread : thread_stats)
+    {
+        for (int32 i = 0; i < int32(Stat::count); ++i)
+        {
+            stats.counters[i] += thread->counters[i].load(std::memory_order_relaxed);
+        }
+
+        for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+        {
+            for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+            {
+                stats.histograms[i][j] += thread->histograms[i][j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return stats;
+}
+
+// Reading of the counters of ThreadStatistics or StatCounters
+static Statistics LoadStatistics(
+    const std::atomic<int64>* counters, const std::atomic<int64> (*histograms)[stat_histogram_bucket_count]
+)
+{
+    Statistics stats;
+    for (int32 i = 0; i < int32(Stat::count); ++i)
+    {
+        stats.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+
+    for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+    {
+        for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+        {
+            stats.histograms[i][j] = histograms[i][j].load(std::memory_order_relaxed);
+        }
+    }
+
+    return stats;
+}
+
+Statistics ThreadStatistics::Get() const
+{
+    return LoadStatistics(counters, histograms);
+}
+
+Statistics StatCounters::Get() const
+{
+    return LoadStatistics(counters, histograms);
+}
+
+// Adds the counts a thread made between two readings, several threads may add at once
+void StatCounters::Add(const Statistics& begin, const Statistics& end)
+{
+    for (int32 i = 0; i < int32(Stat::count); ++i)
+    {
+        if (int64 count = end.counters[i] - begin.counters[i])
+        {
+            counters[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+    {
+        for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+        {
+            if (int64 count = end.histograms[i][j] - begin.histograms[i][j])
+            {
+                histograms[i][j].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+// The counts of the thread go to the installed counters in spans, each ending when another scope takes over
+StatScope::StatScope(StatCounters* counters)
+{
+    ThreadStatistics& stats = GetThreadStatistics();
+    Statistics now = stats.Get();
+
+    previous = stats.scope_counters;
+    if (previous)
+    {
+        previous->Add(stats.scope_begin, now);
+    }
+
+    stats.scope_counters = counters;
+    stats.scope_begin = now;
+}
+
+StatScope::~StatScope()
+{
+    ThreadStatistics& stats = GetThreadStatistics();
+    Statistics now = stats.Get();
+
+    if (stats.scope_counters)
+    {
+        stats.scope_counters->Add(stats.scope_begin, now);
+    }
+
+    stats.scope_counters = previous;
+    stats.scope_begin = now;
+}
+
+#else
+
+Statistics GetStatistics()
+{
+    return Statistics{};
+}
+
+Statistics StatCounters::Get() const
+{
+    return Statistics{};
+}
+
+#endif
+
+static void WriteJSON(std::ostream& out, const Statistics& stats)
+{
+    out << "{\n";
+    for (size_t c = 0; c < std::size(categories); ++c)
+    {
+        out << std::format("    \"{}\": {{", categories[c]);
+
+        bool first = true;
+        for (int32 i = 0; i < int32(Stat::count); ++i)
+        {
+            if (std::string_view(stat_infos[i].category) == categories[c])
+            {
+                out << std::format("{}\n        \"{}\": {}", first ? "" : ",", stat_infos[i].name, stats.counters[i]);
+                first = false;
+            }
+        }
+
+        for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+        {
+            if (std::string_view(histogram_infos[i].category) == categories[c])
+            {
+                out << std::format("{}\n        \"{}\": [", first ? "" : ",", histogram_infos[i].name);
+                for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+                {
+                    out << std::format("{}{}", j > 0 ? ", " : "", stats.histograms[i][j]);
+                }
+                out << "]";
+                first = false;
+            }
+        }
+
+        out << std::format("\n    }}{}\n", c + 1 < std::size(categories) ? "," : "");
+    }
+    out << "}\n";
+}
+
+// One row per counter and per histogram bucket, the bucket column is empty for counters
+static void WriteCSV(std::ostream& out, const Statistics& stats)
+{
+    out << "category,name,bucket,value\n";
+    for (int32 i = 0; i < int32(Stat::count); ++i)
+    {
+        out << std::format("{},{},,{}\n", stat_infos[i].category, stat_infos[i].name, stats.counters[i]);
+    }
+
+    for (int32 i = 0; i < int32(StatHistogram::count); ++i)
+    {
+        for (int32 j = 0; j < stat_histogram_bucket_count; ++j)
+        {
+            out << std::format("{},{},{},{}\n", histogram_infos[i].category, histogram_infos[i].name, j, stats.histograms[i][j]);
+        }
+    }
+}
+
+bool WriteStatistics(const Statistics& stats, const std::filesystem::path& filename)
+{
+    std::ofstream out(filename);
+
+    if (filename.extension() == ".csv")
+    {
+        WriteCSV(out, stats);
+    }
+    else
+    {
+        WriteJSON(out, stats);
+    }
+
+    return bool(out);
+}
+
+} // namespace bulbit
@@ -0,0 +1,57 @@
+#include "bulbit/bulbit.h"
+
+using namespace bulbit;
+
+// Usage: film_merge <output> <film files..>
+// Sums the films written by the render processes of a frame. The output is a film again if its extension is .film,
+// otherwise the final image
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: film_merge <output> <film files..>" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Film> film;
+    for (int32 i = 2; i < argc; ++i)
+    {
+        std::unique_ptr<Film> part = ReadFilm(argv[i]);
+        if (!part)
+        {
+            std::cout << "Failed to read film: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        if (!film)
+        {
+            film = std::move(part);
+            continue;
+        }
+
+        if (part->resolution != film->resolution)
+        {
+            std::cout << "Resolution mismatch: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        film->Merge(*part);
+    }
+
+    std::filesystem::path output = argv[1];
+    if (output.extension() == ".film")
+    {
+        if (!WriteFilm(*film, output))
+        {
+            std::cout << "Failed to write film: " << output << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        WriteImage(film->ConvertToImage(), output);
+    }
+
+    std::cout << std::format("Merged {} films into {}", argc - 2, output.string()) << std::endl;
+    return 0;
+}